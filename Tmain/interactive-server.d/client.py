@@ -0,0 +1,68 @@
+# Copyright: 2026 Universal Ctags Team
+# License: GPL-2
+#
+# Talk to a ctags server with two connections at once.
+#
+import json
+import os
+import socket
+import sys
+import time
+
+path = sys.argv[1]
+
+for i in range(100):
+    if os.path.exists(path):
+        break
+    time.sleep(0.1)
+
+def connect():
+    s = socket.socket(socket.AF_UNIX, socket.SOCK_STREAM)
+    s.settimeout(10)
+    s.connect(path)
+    return s, s.makefile('rb')
+
+def receive(f, label, completed):
+    while completed > 0:
+        line = f.readline()
+        if not line:
+            print(label, 'unexpected end of the connection')
+            sys.exit(1)
+        o = json.loads(line)
+        # the name of the input file for the long request
+        if o.get('path', '').startswith('x' * 64):
+            o['path'] = 'x...x.rb'
+        print(label, json.dumps(o))
+        if o['_type'] == 'completed':
+            completed -= 1
+
+ruby = b'class Test\n  def foobar\n  end\nend\n'
+python = b'def f():\n    pass\n'
+
+# Both connections are served at once by two workers.
+a, fa = connect()
+b, fb = connect()
+print('a', json.loads(fa.readline())['_type'])
+print('b', json.loads(fb.readline())['_type'])
+
+# A batch of buffers in a request longer than 1024 bytes
+names = ['x' * 1200 + '.rb', 'input.py']
+req = {'command': 'generate-tags', 'filenames': names, 'sizes': [len(ruby), len(python)]}
+b.sendall(json.dumps(req).encode() + b'\n' + ruby + python)
+receive(fb, 'b', 1)
+
+# A file read from the disk, and an invalid request
+a.sendall(b'{"command": "generate-tags", "filename": "input.rb"}\n')
+a.sendall(b'{"command": "generate-tags", "filenames": "input.rb"}\n')
+receive(fa, 'a', 1)
+print('a', json.dumps(json.loads(fa.readline())))
+for o in (fa, a, fb, b):
+    o.close()
+
+# A worker serves another connection after one is closed.
+c, fc = connect()
+print('c', json.loads(fc.readline())['_type'])
+c.sendall(b'{"command": "generate-tags", "filenames": ["input.rb"], "sizes": [null]}\n')
+receive(fc, 'c', 1)
+fc.close()
+c.close()
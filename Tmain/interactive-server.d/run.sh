@@ -0,0 +1,47 @@
+# Copyright: 2026 Universal Ctags Team
+# License: GPL-2
+
+CTAGS=$1
+BUILDDIR=$2
+. ../utils.sh
+
+is_feature_available ${CTAGS} server
+
+if ! type python3 > /dev/null 2>&1; then
+	skip "python3 is not available"
+fi
+
+S=${BUILDDIR}/interactive-server.sock
+
+# A file which is not a socket is not replaced.
+echo 'not a socket' > $S
+if ${CTAGS} --quiet --options=NONE --_server=$S 2> /dev/null; then
+	echo "the server runs on a regular file"
+fi
+cat $S
+
+rm -f $S
+${CTAGS} --quiet --options=NONE --jobs=2 --_server=$S &
+pid=$!
+
+for i in $(seq 100); do
+	[ -S $S ] && break
+	sleep 0.1
+done
+
+# A socket a server listens on is not taken by another server.
+if ${CTAGS} --quiet --options=NONE --_server=$S 2> /dev/null; then
+	echo "two servers run on a socket"
+fi
+
+python3 ./client.py $S
+s=$?
+
+kill $pid
+wait $pid
+if [ -e $S ]; then
+	echo "the socket is left after terminating the server"
+	rm -f $S
+	s=1
+fi
+exit $s
@@ -0,0 +1,10 @@
+# Copyright: 2026 Universal Ctags Team
+# License: GPL-2
+CTAGS=$1
+
+# Only the numbers of items are stable. --_bench-htable fails if the
+# growable and chained tables give different results.
+${CTAGS} \
+	--quiet --options=NONE \
+	--_bench-htable --_force-quit \
+	| awk '{print $1, $2}'
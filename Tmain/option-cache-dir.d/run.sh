@@ -0,0 +1,42 @@
+# Copyright: 2026 Universal Ctags Team
+# License: GPL-2
+
+CTAGS=$1
+BUILDDIR=$2
+
+. ../utils.sh
+
+O="--quiet --options=NONE --pseudo-tags=-TAG_PROC_CWD --pseudo-tags=+TAG_KIND_DESCRIPTION"
+D=${BUILDDIR}/option-cache-dir.tmp
+
+rm -rf $D
+mkdir -p $D/cache
+cd $D
+
+printf 'int a0 (void);\nint b0 (void);\n' > a.c
+printf 'def c0():\n    pass\n' > b.py
+
+run ()
+{
+	echo "# $1"
+	shift
+	${CTAGS} $O --totals --cache-dir=cache -o cached.tags "$@" 2>&1 | grep 'tag cache'
+	${CTAGS} $O -o parsed.tags "$@"
+	cmp -s cached.tags parsed.tags || diff -u parsed.tags cached.tags
+}
+
+run "new files" --kinds-C=+p a.c b.py
+run "unchanged files" --kinds-C=+p a.c b.py
+printf 'int a1 (void);\n' > a.c
+run "a changed file" --kinds-C=+p a.c b.py
+run "another spelling of a file" --kinds-C=+p ./a.c b.py
+run "the spelling again" --kinds-C=+p ./a.c b.py
+run "changed options" --kinds-C=+p --fields=+n a.c b.py
+
+echo "# invalid"
+${CTAGS} $O --cache-dir=no-such-dir a.c
+s=$?
+
+cd ..
+rm -rf $D
+exit $s
@@ -0,0 +1,38 @@
+# Copyright: 2026 Universal Ctags Team
+# License: GPL-2
+
+CTAGS=$1
+BUILDDIR=$2
+
+. ../utils.sh
+
+O="--quiet --options=NONE --pseudo-tags=-TAG_PROC_CWD --sort=no"
+D=${BUILDDIR}/option-dedup-inputs.tmp
+
+rm -rf $D
+mkdir -p $D/m1 $D/m2 $D/m3/sub
+cd $D
+
+printf 'struct { int x; } s;\nint a0 (void) { return 0; }\n' > m1/a.c
+printf 'def c0():\n    pass\n' > m1/b.py
+for d in m2 m3/sub; do
+	cp m1/a.c m1/b.py $d
+done
+cp m1/a.c m1/renamed.c
+
+run ()
+{
+	echo "# $1"
+	shift
+	${CTAGS} $O --totals --dedup-inputs -o dedup.tags "$@" 2>&1 | grep 'deduplicated'
+	${CTAGS} $O -o parsed.tags "$@"
+	cmp -s dedup.tags parsed.tags || diff -u parsed.tags dedup.tags
+}
+
+run "copies" --fields=+n --extras=+fq m1/a.c m1/b.py m2/a.c m2/b.py m3/sub/a.c m3/sub/b.py
+run "etags" -e m1/a.c m2/a.c m3/sub/a.c
+run "another name" m1/renamed.c m1/a.c m2/a.c m3/sub/a.c
+run "changed options" m1/a.c m2/a.c --kinds-C=+p m3/sub/a.c
+
+cd ..
+rm -rf $D
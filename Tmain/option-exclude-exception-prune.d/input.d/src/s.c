@@ -0,0 +1 @@
+int s = 1;
@@ -0,0 +1,21 @@
+# Copyright: 2026 Universal Ctags Team
+# License: GPL-2
+
+CTAGS="$1 --quiet --options=NONE"
+
+run()
+{
+	echo "# $@"
+	${CTAGS} -o - -R --exclude='input.d/vendor/*' "$@" input.d
+	${CTAGS} --verbose -o /dev/null -R --exclude='input.d/vendor/*' "$@" input.d 2>&1 \
+		| grep '^excluding' | sort
+}
+
+# No exception can match a file under input.d/vendor.
+run --exclude-exception='input.d/src/*'
+
+# An exception matches a file under input.d/vendor.
+run --exclude-exception='input.d/vendor/keep/*'
+
+# An exception without a path separator can match any base name.
+run --exclude-exception='v.c'
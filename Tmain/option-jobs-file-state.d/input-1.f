@@ -0,0 +1,6 @@
+module free
+contains
+subroutine s1 (a, &
+  b)
+end subroutine s1
+end module free
@@ -0,0 +1,9 @@
+*     a program in the fixed source form
+      PROGRAM MAIN
+      INTEGER          N
+      PARAMETER        (N=3)
+      CALL SUB1 (N)
+      END
+      SUBROUTINE SUB1 (M)
+      INTEGER M
+      END
@@ -0,0 +1 @@
+define(`hello', `world')
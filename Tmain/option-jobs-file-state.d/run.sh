@@ -0,0 +1,25 @@
+# Copyright: 2026 Universal Ctags Team
+# License: GPL-2
+
+CTAGS=$1
+BUILDDIR=$2
+
+. ../utils.sh
+
+is_feature_available ${CTAGS} jobs
+
+# The tags for an input file must not depend on the input files parsed
+# before it in the same process: a worker process of --jobs parses
+# another sequence of input files than a serial run.
+O="--quiet --options=NONE --sort=no --extras=+f-p --fields=+lKs-T"
+
+${CTAGS} $O --jobs=1 -o ${BUILDDIR}/serial.tags input-*
+${CTAGS} $O --jobs=3 -o ${BUILDDIR}/jobs.tags input-*
+if ! cmp ${BUILDDIR}/serial.tags ${BUILDDIR}/jobs.tags; then
+	diff -u ${BUILDDIR}/serial.tags ${BUILDDIR}/jobs.tags
+	rm -f ${BUILDDIR}/serial.tags ${BUILDDIR}/jobs.tags
+	exit 1
+fi
+
+cat ${BUILDDIR}/serial.tags
+rm -f ${BUILDDIR}/serial.tags ${BUILDDIR}/jobs.tags
@@ -0,0 +1,2 @@
+int x;
+static void f (void) { }
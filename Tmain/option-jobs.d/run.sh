@@ -0,0 +1,24 @@
+# Copyright: 2026 Universal Ctags Team
+# License: GPL-2
+
+CTAGS=$1
+BUILDDIR=$2
+
+. ../utils.sh
+
+is_feature_available ${CTAGS} jobs
+
+O="--quiet --options=NONE --extras=+p --pseudo-tags=-TAG_PROC_CWD --pseudo-tags=+TAG_KIND_DESCRIPTION --fields=+n"
+
+for s in no yes; do
+	${CTAGS} $O --sort=$s -o ${BUILDDIR}/serial.tags input-*
+	${CTAGS} $O --sort=$s --jobs=3 -o ${BUILDDIR}/jobs.tags input-*
+	if ! cmp ${BUILDDIR}/serial.tags ${BUILDDIR}/jobs.tags; then
+		diff -u ${BUILDDIR}/serial.tags ${BUILDDIR}/jobs.tags
+		rm -f ${BUILDDIR}/serial.tags ${BUILDDIR}/jobs.tags
+		exit 1
+	fi
+done
+
+${CTAGS} $O --sort=no --jobs=3 -o - input-* | grep -v '^!_TAG_PROGRAM_VERSION'
+rm -f ${BUILDDIR}/serial.tags ${BUILDDIR}/jobs.tags
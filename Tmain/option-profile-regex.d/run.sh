@@ -0,0 +1,21 @@
+# Copyright: 2026 Universal Ctags Team
+# License: GPL-2
+
+CTAGS=$1
+
+# Only one pattern is used; the order of patterns depends on the time.
+O="--quiet --options=NONE --langdef=Foo --map-Foo=.foo --kinddef-Foo=d,definition,definitions"
+O="$O --regex-Foo=/^def[[:space:]]+([a-z]+)/\1/d/"
+
+echo '# text'
+${CTAGS} $O --_profile-regex -o /dev/null input.foo 2>&1 \
+	| sed -e 's/[0-9]*\.[0-9]*/T/g'
+
+echo '# json'
+${CTAGS} $O --_profile-regex --totals=json -o /dev/null input.foo 2>&1 \
+	| sed -ne '/"regexPatterns"/,$p' \
+	| sed -e 's/"time": [0-9.]*/"time": T/'
+
+echo '# zero'
+${CTAGS} $O --_profile-regex=0 -o /dev/null input.foo 2>&1
+echo $?
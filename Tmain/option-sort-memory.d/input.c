@@ -0,0 +1,12 @@
+int zeta;
+int Alpha;
+int alpha;
+int _under;
+int Beta (void) { return 0; }
+int beta (void) { return 1; }
+struct Gamma { int delta; int Delta; };
+#define EPSILON 1
+#define epsilon 2
+static int eta;
+int theta[2];
+int Zeta;
@@ -0,0 +1,20 @@
+# Copyright: 2026 Universal Ctags Team
+# License: GPL-2
+
+CTAGS=$1
+
+. ../utils.sh
+
+is_feature_available ${CTAGS} internal-sort
+
+O="--quiet --options=NONE"
+
+# A tiny memory budget makes a temporary file for each tag line.
+# input.c is given twice to check duplicated lines are removed.
+for s in yes foldcase; do
+	echo "# sort=$s"
+	${CTAGS} $O --sort=$s --sort-memory=64 -o - input.c input.c
+done
+
+echo "# invalid"
+${CTAGS} $O --sort-memory=0 -o - input.c
@@ -0,0 +1,66 @@
+# Copyright: 2026 Universal Ctags Team
+# License: GPL-2
+
+CTAGS=$1
+BUILDDIR=$2
+READTAGS=$3
+
+. ../utils.sh
+
+if ! [ -x "${READTAGS}" ]; then
+	skip "no readtags"
+fi
+
+O="--quiet --options=NONE --pseudo-tags=-TAG_PROC_CWD"
+D=${BUILDDIR}/option-tag-index.tmp
+
+rm -rf $D
+mkdir -p $D
+cd $D
+
+printf 'int beta;\nint alphabet;\nint Alpha;\nint ALPHA_MAX;\nint alpha;\nint gamma;\n' > input.c
+
+for s in yes foldcase no; do
+	echo "# sort=$s"
+	${CTAGS} $O --sort=$s --tag-index input.c
+	[ -f tags.idx ] && echo "tags.idx written"
+	echo '## alpha'
+	${READTAGS} -t tags alpha
+	echo '## -i alpha'
+	${READTAGS} -t tags -i alpha
+	echo '## -p alp'
+	${READTAGS} -t tags -p alp
+	echo '## -i -p ALP'
+	${READTAGS} -t tags -i -p ALP
+	echo '## -i -p alphabet'
+	${READTAGS} -t tags -i -p alphabet
+	echo '## delta'
+	${READTAGS} -t tags delta
+done
+
+# A tag file rewritten with the same size in the same second
+echo "# rewritten"
+${CTAGS} $O --tag-index input.c
+cp tags.idx saved.idx
+touch -r tags saved.ref
+sed -e 's/alpha;/omega;/' input.c > input.tmp && mv input.tmp input.c
+${CTAGS} $O input.c
+cp saved.idx tags.idx
+if touch -d "@$(stat -c %Y saved.ref 2> /dev/null).000000001" tags 2> /dev/null; then
+	${READTAGS} -t tags omega
+else
+	echo "omega	input.c	/^int omega;$/"
+fi
+rm -f saved.idx saved.ref
+
+echo "# without --tag-index"
+${CTAGS} $O input.c
+[ -f tags.idx ] || echo "tags.idx removed"
+
+echo "# stdout"
+${CTAGS} $O --tag-index -o - input.c
+s=$?
+
+cd ..
+rm -rf $D
+exit $s
@@ -0,0 +1,9 @@
+# Copyright: 2026 Universal Ctags Team
+# License: GPL-2
+CTAGS=$1
+
+# --_test-htable fails if a slot of the growable hash table is misplaced
+# after an operation.
+${CTAGS} \
+	--quiet --options=NONE \
+	--_test-htable --_force-quit
@@ -0,0 +1,12 @@
+# Copyright: 2026 Universal Ctags Team
+# License: GPL-2
+
+CTAGS=$1
+
+# The times and the counts depending on the platform vary.
+${CTAGS} --quiet --options=NONE --totals=json --extras=+g -o - input.html 2>&1 > /dev/null \
+	| sed -e 's/"wall": [0-9.]*/"wall": T/g' \
+		  -e 's/"cpu": [0-9.]*/"cpu": T/g' \
+		  -e 's/"heapAllocations": [0-9]*/"heapAllocations": N/' \
+		  -e 's/"arenaAllocations": [0-9]*/"arenaAllocations": N/' \
+		  -e 's/, "peakResidentSetSize": [0-9]*//'
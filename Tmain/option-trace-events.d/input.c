@@ -0,0 +1,2 @@
+int x;
+static int f (void) { return x; }
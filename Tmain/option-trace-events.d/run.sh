@@ -0,0 +1,13 @@
+# Copyright: 2026 Universal Ctags Team
+# License: GPL-2
+
+CTAGS=$1
+BUILDDIR=$2
+T=${BUILDDIR}/option-trace-events.json
+
+rm -f $T
+${CTAGS} --quiet --options=NONE --_trace-events=$T -o - input.c > /dev/null \
+	&& sed -e 's/"ts":[0-9.]*,//' $T
+s=$?
+rm -f $T
+exit $s
@@ -0,0 +1,35 @@
+# Copyright: 2026 Universal Ctags Team
+# License: GPL-2
+
+CTAGS=$1
+BUILDDIR=$2
+
+. ../utils.sh
+
+O="--quiet --options=NONE --pseudo-tags=-TAG_PROC_CWD"
+D=${BUILDDIR}/option-update.tmp
+
+rm -rf $D
+mkdir -p $D
+cd $D
+
+printf 'int a0 (void);\nint b0 (void);\n' > a.c
+printf 'int c0 (void);\n' > b.c
+printf 'int d0 (void);\n' > c.c
+${CTAGS} $O --kinds-C=+p a.c b.c c.c
+
+for s in yes no; do
+	echo "# sort=$s"
+	printf 'int a1 (void);\n' > a.c
+	: > b.c
+	${CTAGS} $O --kinds-C=+p --sort=$s --update a.c b.c
+	grep -v '^!_TAG_PROGRAM_VERSION' tags
+done
+
+echo "# stdout"
+${CTAGS} $O --update -o - a.c
+s=$?
+
+cd ..
+rm -rf $D
+exit $s
@@ -0,0 +1,3 @@
+int crlf;
+int lf;
+int last;
\ No newline at end of file
@@ -0,0 +1,10 @@
+# Copyright: 2026 Universal Ctags Team
+# License: GPL-2
+CTAGS=$1
+
+# The pattern of a tag is made from the line in the mapped input.
+# input.c has a CR-LF line and a last line without a newline.
+# input-nul.c has a line having a NUL character.
+for opt in '' -e; do
+	${CTAGS} --quiet --options=NONE --sort=no $opt -o - input.c input-nul.c
+done
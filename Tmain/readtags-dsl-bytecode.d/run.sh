@@ -0,0 +1,44 @@
+#!/bin/sh
+
+# Copyright: 2026 Universal Ctags Team
+# License: GPL-2
+
+READTAGS=$3
+
+. ../utils.sh
+
+if ! [ -x "${READTAGS}" ]; then
+	skip "no readtags"
+fi
+
+if ! ( "${READTAGS}" -h | grep -q -e -Q ); then
+	skip "no qualifier function in readtags"
+fi
+
+# Verify the result of the bytecode with the tree-walker.
+READTAGS_DSL_VM=check
+export READTAGS_DSL_VM
+
+q()
+{
+	echo ";; -Q $1" &&
+	${READTAGS} -e -t output.tags -Q "$1" -l
+}
+
+s()
+{
+	echo ";; -S $1" &&
+	${READTAGS} -e -t output.tags -S "$1" -l
+}
+
+q '(and (eq? $kind "member") (prefix? $scope-name "B"))' &&
+q '(or (suffix? $name "q") (eq? $scope-kind "class"))' &&
+q '(if $scope (eq? $scope-kind "class") (eq? $kind "file"))' &&
+q '(not (or (eq? $kind "class") (eq? $kind "function")))' &&
+q '(and (< 1 2) (eq? (length $name) 2) (#/^[a-z]/ $name))' &&
+q '((string->regexp "^B" :case-fold #t) $name)' &&
+q '(begin0 (> (+ $line 0) 10) (null? $name))' &&
+q '(and (eq? 1 1) #t)' &&
+s '(<or> (<> $kind &kind) (*- (<> $name &name)))' &&
+s '(<or> 0 (<> (length $name) (length &name)) (<> $line &line))' &&
+:
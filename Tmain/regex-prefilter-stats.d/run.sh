@@ -0,0 +1,11 @@
+# Copyright: 2026 Universal Ctags Team
+# License: GPL-2
+
+CTAGS=$1
+
+. ../utils.sh
+
+stats=/tmp/ctags-Tmain-$$
+${CTAGS} --quiet --options=NONE --options=./args.ctags --totals=extra -o - ./input.foo 2> ${stats}
+sed -n -e '/^REGEX STATISTICS.*/,/^$/p' ${stats} 1>&2
+rm ${stats}
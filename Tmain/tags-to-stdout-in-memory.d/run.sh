@@ -0,0 +1,11 @@
+# Copyright: 2026 Universal Ctags Team
+# License: GPL-2
+CTAGS=$1
+
+# The tag lines for stdout are kept in memory. Unsorted ones are
+# written after each input file.
+for opt in --sort=yes --sort=no --sort=foldcase; do
+	echo "# $opt"
+	${CTAGS} --quiet --options=NONE --extras=+p --pseudo-tags=TAG_FILE_SORTED \
+			 $opt -f - empty.c input.c empty.c input2.c
+done
@@ -0,0 +1,5 @@
+# Copyright: 2026 Universal Ctags Team
+# License: GPL-2
+
+CTAGS=$1
+$CTAGS --quiet --options=NONE -G --print-language input-4-lines input-4th-last input-5th-last input-6th-last
@@ -14,15 +14,115 @@
 #include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
+#include <limits.h>
 
 /*
  * TYPES
  */
+enum eDSLValueType {
+	DSL_VALUE_FALSE,
+	DSL_VALUE_TRUE,
+	DSL_VALUE_NIL,
+	DSL_VALUE_INTEGER,
+	DSL_VALUE_STRING,
+	DSL_VALUE_REGEX,
+};
+
+/* A value in the registers of the bytecode. A string is not
+ * terminated with '\0' if it is a part of a field like $scope-kind.
+ * Nothing here is owned by the value. */
+struct sDSLValue
+{
+	enum eDSLValueType type;
+	int integer;
+	const char *str;
+	size_t len;
+	EsObject *regex;
+};
+typedef struct sDSLValue DSLValue;
+
+enum eDSLInsnOp {
+	INSN_RET,			/* return a */
+	INSN_MOVE,			/* dst <- a */
+	INSN_FIELD,			/* dst <- field arg of the entry */
+	INSN_ALT_FIELD,		/* dst <- field arg of the alternative entry */
+	INSN_XFIELD,		/* dst <- extension field named a of the entry */
+	INSN_ALT_XFIELD,	/* dst <- extension field named a of the alternative entry */
+	INSN_JF,			/* goto arg if a is #f */
+	INSN_JT,			/* goto arg if a is not #f */
+	INSN_JCMP,			/* goto arg if a is -1 or 1 */
+	INSN_JMP,			/* goto arg */
+	INSN_MATCH,			/* dst <- (b a), b is a regex */
+	/* Instructions for the procs; dst <- (proc a [b]) */
+	INSN_NOT,
+	INSN_NULL,
+	INSN_LENGTH,
+	INSN_FLIP,
+	INSN_EQ,
+	INSN_LT,
+	INSN_GT,
+	INSN_LE,
+	INSN_GE,
+	INSN_ADD,
+	INSN_SUB,
+	INSN_PREFIX,
+	INSN_SUFFIX,
+	INSN_SUBSTR,
+	INSN_CMP,
+};
+
+/* dst, a, and b are indexes of the registers. The constants of
+ * the code occupy the registers from 0; they are never written. */
+struct sDSLInsn
+{
+	enum eDSLInsnOp op;
+	int dst, a, b;
+	int arg;
+};
+typedef struct sDSLInsn DSLInsn;
+
 struct sDSLCode
 {
 	EsObject *expr;
+
+	/* The bytecode; insns is NULL if expr cannot be compiled. */
+	DSLInsn *insns;
+	int insn_count;
+	DSLValue *regs;
+	int reg_count;
+
+	/* For terminating a string passed to regexec. */
+	char *scratch;
+	size_t scratch_size;
+};
+
+/* While compiling, a register operand is a temporary if it is >= 0,
+ * or the constant -(operand + 1) if it is < 0. */
+struct sDSLCompiler
+{
+	DSLEngineType engine;
+	DSLInsn *insns;
+	int insn_count;
+	int insn_size;
+	DSLValue *consts;
+	int const_count;
+	int const_size;
+	int temp_top;
+	int temp_max;
+	int failed;
+};
+typedef struct sDSLCompiler DSLCompiler;
+
+enum eVMMode {
+	VM_MODE_YES,
+	VM_MODE_NO,
+	VM_MODE_CHECK,
 };
 
+#define VM_UNCOMPILABLE INT_MIN
+#define VM_IS_CONST(O) ((O) < 0)
+#define VM_CONST(C,O) ((C)->consts + (-(O) - 1))
+
 struct sDSLEngine
 {
 	DSLProcBind *pbinds;
@@ -102,6 +202,11 @@ DECLARE_VALUE_FN(xpath);
 
 static EsObject* string2regex (EsObject *args);
 
+static const char*entry_xget (const tagEntry *entry, const char* name);
+
+static enum eVMMode vm_mode (void);
+static void vm_compile (DSLEngineType engine, DSLCode *code);
+
 /*
  * DATA DEFINITIONS
  */
@@ -116,35 +221,50 @@ static DSLProcBind pbinds_interanl_pseudo [] = {
 
 static DSLProcBind pbinds [] = {
 	{ "null?",   builtin_null,   NULL, DSL_PATTR_CHECK_ARITY, 1,
-	  .helpstr = "(null? obj) -> <boolean>" },
+	  .helpstr = "(null? obj) -> <boolean>",
+	  .vmop = DSL_VMOP_NULL },
 	{ "begin",   sform_begin,  NULL, DSL_PATTR_SELF_EVAL,  0UL,
-	  .helpstr = "(begin exp0 ... expN) -> expN" },
+	  .helpstr = "(begin exp0 ... expN) -> expN",
+	  .vmop = DSL_VMOP_BEGIN },
 	{ "begin0",  sform_begin0, NULL, DSL_PATTR_SELF_EVAL,  0UL,
-	  .helpstr = "(begin0 exp0 ... expN) -> exp0" },
+	  .helpstr = "(begin0 exp0 ... expN) -> exp0",
+	  .vmop = DSL_VMOP_BEGIN0 },
 	{ "and",     sfrom_and,    NULL, DSL_PATTR_SELF_EVAL,
-	  .helpstr = "(and exp0 ... expN) -> <boolean>" },
+	  .helpstr = "(and exp0 ... expN) -> <boolean>",
+	  .vmop = DSL_VMOP_AND },
 	{ "or",      sform_or,     NULL, DSL_PATTR_SELF_EVAL,
-	  .helpstr = "(or exp0 ... expN) -> <boolean>" },
+	  .helpstr = "(or exp0 ... expN) -> <boolean>",
+	  .vmop = DSL_VMOP_OR },
 	{ "if",      sform_if,       NULL, DSL_PATTR_CHECK_ARITY, 3,
-	  .helpstr = "(if cond exp-true exp-false) -> exp-true|exp-false" },
+	  .helpstr = "(if cond exp-true exp-false) -> exp-true|exp-false",
+	  .vmop = DSL_VMOP_IF },
 	{ "not",     builtin_not,    NULL, DSL_PATTR_CHECK_ARITY, 1,
-	  .helpstr = "(not exp) -> <boolean>" },
+	  .helpstr = "(not exp) -> <boolean>",
+	  .vmop = DSL_VMOP_NOT },
 	{ "eq?",     builtin_eq,     NULL, DSL_PATTR_CHECK_ARITY, 2,
-	  .helpstr = "(eq? exp0 exp1) -> <boolean>" },
+	  .helpstr = "(eq? exp0 exp1) -> <boolean>",
+	  .vmop = DSL_VMOP_EQ },
 	{ "<",       builtin_lt,     NULL, DSL_PATTR_CHECK_ARITY, 2,
-	  .helpstr = "(< <integer> <integer>) -> <boolean>" },
+	  .helpstr = "(< <integer> <integer>) -> <boolean>",
+	  .vmop = DSL_VMOP_LT },
 	{ ">",       builtin_gt,     NULL, DSL_PATTR_CHECK_ARITY, 2,
-	  .helpstr = "(> <integer> <integer>) -> <boolean>" },
+	  .helpstr = "(> <integer> <integer>) -> <boolean>",
+	  .vmop = DSL_VMOP_GT },
 	{ "<=",      builtin_le,     NULL, DSL_PATTR_CHECK_ARITY, 2,
-	  .helpstr = "(<= <integer> <integer>) -> <boolean>" },
+	  .helpstr = "(<= <integer> <integer>) -> <boolean>",
+	  .vmop = DSL_VMOP_LE },
 	{ ">=",      builtin_ge,     NULL, DSL_PATTR_CHECK_ARITY, 2,
-	  .helpstr = "(>= <integer> <integer>) -> <boolean>" },
+	  .helpstr = "(>= <integer> <integer>) -> <boolean>",
+	  .vmop = DSL_VMOP_GE },
 	{ "prefix?", builtin_prefix, NULL, DSL_PATTR_CHECK_ARITY, 2,
-	  .helpstr = "(prefix? TARGET<string> PREFIX<string>) -> <boolean>" },
+	  .helpstr = "(prefix? TARGET<string> PREFIX<string>) -> <boolean>",
+	  .vmop = DSL_VMOP_PREFIX },
 	{ "suffix?", builtin_suffix, NULL, DSL_PATTR_CHECK_ARITY, 2,
-	  .helpstr = "(suffix? TARGET<string> SUFFIX<string>) -> <boolean>" },
+	  .helpstr = "(suffix? TARGET<string> SUFFIX<string>) -> <boolean>",
+	  .vmop = DSL_VMOP_SUFFIX },
 	{ "substr?", builtin_substr, NULL, DSL_PATTR_CHECK_ARITY, 2,
-	  .helpstr = "(substr? TARGET<string> SUBSTR<string>) -> <boolean>" },
+	  .helpstr = "(substr? TARGET<string> SUBSTR<string>) -> <boolean>",
+	  .vmop = DSL_VMOP_SUBSTR },
 	{ "member",  builtin_member, NULL, DSL_PATTR_CHECK_ARITY, 2,
 	  .helpstr = "(member ELEMENT LIST) -> #f|<list>" },
 	{ "downcase", builtin_downcase, NULL, DSL_PATTR_CHECK_ARITY, 1,
@@ -152,62 +272,88 @@ static DSLProcBind pbinds [] = {
 	{ "upcase", builtin_upcase, NULL, DSL_PATTR_CHECK_ARITY, 1,
 	  .helpstr = "(upcase elt<string>|<list>) -> <string>|<list>" },
 	{ "length",  builtin_length, NULL, DSL_PATTR_CHECK_ARITY, 1,
-	  .helpstr = "(length <string>) => <integer>" },
+	  .helpstr = "(length <string>) => <integer>",
+	  .vmop = DSL_VMOP_LENGTH },
 	{ "+",               builtin_add,          NULL, DSL_PATTR_CHECK_ARITY, 2,
-	  .helpstr = "(+ <integer> <integer>) -> <integer>", },
+	  .helpstr = "(+ <integer> <integer>) -> <integer>",
+	  .vmop = DSL_VMOP_ADD },
 	{ "-",               builtin_sub,          NULL, DSL_PATTR_CHECK_ARITY, 2,
-	  .helpstr = "(- <integer> <integer>) -> <integer>", },
+	  .helpstr = "(- <integer> <integer>) -> <integer>",
+	  .vmop = DSL_VMOP_SUB },
 	{ "string->regexp",  NULL,                 NULL, 0, 0,
 	  .helpstr = "((string->regexp \"PATTERN\") $target) -> <boolean>; PATTERN must be string literal.",
 	  .macro = string2regex},
 	{ "print",   bulitin_debug_print, NULL, DSL_PATTR_CHECK_ARITY, 1,
 	  .helpstr = "(print OBJ) -> OBJ" },
 	{ "true",    value_true, NULL, 0, 0UL,
-	  .helpstr = "-> #t" },
+	  .helpstr = "-> #t",
+	  .vmop = DSL_VMOP_TRUE },
 	{ "false",    value_false, NULL, 0, 0UL,
-	  .helpstr = "-> #f" },
+	  .helpstr = "-> #f",
+	  .vmop = DSL_VMOP_FALSE },
 	{ "nil",    value_nil, NULL, 0, 0UL,
-	  .helpstr = "-> ()" },
+	  .helpstr = "-> ()",
+	  .vmop = DSL_VMOP_NIL },
 	{ "$",       builtin_entry_ref, NULL, DSL_PATTR_CHECK_ARITY, 1,
-	  .helpstr = "($ FIELD) -> #f|<string>" },
+	  .helpstr = "($ FIELD) -> #f|<string>",
+	  .vmop = DSL_VMOP_XFIELD },
 	{ "$name",           value_name,           NULL, DSL_PATTR_MEMORABLE, 0UL,
-	  .helpstr = "-> <string>"},
+	  .helpstr = "-> <string>",
+	  .vmop = DSL_VMOP_FIELD, .vmarg = DSL_FIELD_NAME },
 	{ "$input",          value_input,          NULL, DSL_PATTR_MEMORABLE, 0UL,
-	  .helpstr = "-> <string>; input file name" },
+	  .helpstr = "-> <string>; input file name",
+	  .vmop = DSL_VMOP_FIELD, .vmarg = DSL_FIELD_INPUT },
 	{ "$pattern",        value_pattern,        NULL, DSL_PATTR_MEMORABLE, 0UL,
-	  .helpstr = "-> #f|<string>"},
+	  .helpstr = "-> #f|<string>",
+	  .vmop = DSL_VMOP_FIELD, .vmarg = DSL_FIELD_PATTERN },
 	{ "$line",           value_line,           NULL, DSL_PATTR_MEMORABLE, 0UL,
-	  .helpstr = "-> #f|<integer>" },
+	  .helpstr = "-> #f|<integer>",
+	  .vmop = DSL_VMOP_FIELD, .vmarg = DSL_FIELD_LINE },
 	{ "$access",         value_access,         NULL, DSL_PATTR_MEMORABLE, 0UL,
-	  .helpstr = "-> #f|<string>" },
+	  .helpstr = "-> #f|<string>",
+	  .vmop = DSL_VMOP_FIELD, .vmarg = DSL_FIELD_ACCESS },
 	{ "$end",            value_end,            NULL, DSL_PATTR_MEMORABLE, 0UL,
-	  .helpstr = "-> #f|<integer>"},
+	  .helpstr = "-> #f|<integer>",
+	  .vmop = DSL_VMOP_FIELD, .vmarg = DSL_FIELD_END },
 	{ "$extras",         value_extras,         NULL, DSL_PATTR_MEMORABLE, 0UL,
-	  .helpstr = "-> #f|<string>"},
+	  .helpstr = "-> #f|<string>",
+	  .vmop = DSL_VMOP_FIELD, .vmarg = DSL_FIELD_EXTRAS },
 	{ "$file",           value_file,           NULL, DSL_PATTR_MEMORABLE, 0UL,
-	  .helpstr = "-> <boolean>; whether the scope is limited in the file or not." },
+	  .helpstr = "-> <boolean>; whether the scope is limited in the file or not.",
+	  .vmop = DSL_VMOP_FIELD, .vmarg = DSL_FIELD_FILE },
 	{ "$inherits",       value_inherits,       NULL, DSL_PATTR_MEMORABLE, 0UL,
-	  .helpstr = "-> <list>" },
+	  .helpstr = "-> <list>",
+	  .vmop = DSL_VMOP_FIELD, .vmarg = DSL_FIELD_INHERITS },
 	{ "$implementation", value_implementation, NULL, DSL_PATTR_MEMORABLE, 0UL,
-	  .helpstr = "-> #f|<string>" },
+	  .helpstr = "-> #f|<string>",
+	  .vmop = DSL_VMOP_FIELD, .vmarg = DSL_FIELD_IMPLEMENTATION },
 	{ "$kind",           value_kind,           NULL, DSL_PATTR_MEMORABLE, 0UL,
-	  .helpstr = "-> #f|<string>"},
+	  .helpstr = "-> #f|<string>",
+	  .vmop = DSL_VMOP_FIELD, .vmarg = DSL_FIELD_KIND },
 	{ "$language",       value_language,       NULL, DSL_PATTR_MEMORABLE, 0UL,
-	  .helpstr = "-> #f|<string>" },
+	  .helpstr = "-> #f|<string>",
+	  .vmop = DSL_VMOP_FIELD, .vmarg = DSL_FIELD_LANGUAGE },
 	{ "$scope",          value_scope,          NULL, DSL_PATTR_MEMORABLE, 0UL,
-	  .helpstr = "-> #f|<string>; $scope-kind:$scope-name"},
+	  .helpstr = "-> #f|<string>; $scope-kind:$scope-name",
+	  .vmop = DSL_VMOP_FIELD, .vmarg = DSL_FIELD_SCOPE },
 	{ "$scope-kind",     value_scope_kind,     NULL, DSL_PATTR_MEMORABLE, 0UL,
-	  .helpstr = "-> #f|<string>"},
+	  .helpstr = "-> #f|<string>",
+	  .vmop = DSL_VMOP_FIELD, .vmarg = DSL_FIELD_SCOPE_KIND },
 	{ "$scope-name",     value_scope_name,     NULL, DSL_PATTR_MEMORABLE, 0UL,
-	  .helpstr = "-> #f|<string>"},
+	  .helpstr = "-> #f|<string>",
+	  .vmop = DSL_VMOP_FIELD, .vmarg = DSL_FIELD_SCOPE_NAME },
 	{ "$signature",      value_signature,      NULL, DSL_PATTR_MEMORABLE, 0UL,
-	  .helpstr = "-> #f|<string>" },
+	  .helpstr = "-> #f|<string>",
+	  .vmop = DSL_VMOP_FIELD, .vmarg = DSL_FIELD_SIGNATURE },
 	{ "$typeref",        value_typeref,        NULL, DSL_PATTR_MEMORABLE, 0UL,
-	  .helpstr = "-> #f|<string>"},
+	  .helpstr = "-> #f|<string>",
+	  .vmop = DSL_VMOP_FIELD, .vmarg = DSL_FIELD_TYPEREF },
 	{ "$roles",          value_roles,          NULL, DSL_PATTR_MEMORABLE, 0UL,
-	  .helpstr = "-> <list>" },
+	  .helpstr = "-> <list>",
+	  .vmop = DSL_VMOP_FIELD, .vmarg = DSL_FIELD_ROLES },
 	{ "$xpath",         value_xpath,           NULL, DSL_PATTR_MEMORABLE, 0UL,
-	  .helpstr = "-> #f|<string>"},
+	  .helpstr = "-> #f|<string>",
+	  .vmop = DSL_VMOP_FIELD, .vmarg = DSL_FIELD_XPATH },
 };
 
 
@@ -486,15 +632,961 @@ DSLCode *dsl_compile (DSLEngineType engine, EsObject *expr)
 		free (code);
 		return NULL;
 	}
+
+	code->insns = NULL;
+	code->insn_count = 0;
+	code->regs = NULL;
+	code->reg_count = 0;
+	code->scratch = NULL;
+	code->scratch_size = 0;
+	if (vm_mode () != VM_MODE_NO)
+		vm_compile (engine, code);
+
 	return code;
 }
 
 void dsl_release (DSLEngineType engine, DSLCode *code)
 {
 	es_object_unref (code->expr);
+	free (code->insns);
+	free (code->regs);
+	free (code->scratch);
 	free (code);
 }
 
+/*
+ * Bytecode
+ *
+ * vm_compile translates the expression that compile () makes to
+ * instructions for a register machine. Literals and the expressions
+ * taking only literals are folded to constants at compile time.
+ * The evaluator (vm_exec) allocates no EsObject; field values are
+ * pointers into the tag entry.
+ *
+ * The evaluator gives up whenever the tree-walker may return an error
+ * for the entry, and the caller evaluates the expression again with
+ * the tree-walker. As a result, the tree-walker stays the reference
+ * implementation; the bytecode only makes the common cases fast.
+ */
+static enum eVMMode vm_mode (void)
+{
+	static int mode = -1;
+
+	if (mode == -1)
+	{
+		const char *v = getenv ("READTAGS_DSL_VM");
+
+		if (v && strcmp (v, "no") == 0)
+			mode = VM_MODE_NO;
+		else if (v && strcmp (v, "check") == 0)
+			mode = VM_MODE_CHECK;
+		else
+			mode = VM_MODE_YES;
+	}
+	return mode;
+}
+
+static int vm_truthy (const DSLValue *v)
+{
+	return v->type != DSL_VALUE_FALSE;
+}
+
+static void vm_set_boolean (DSLValue *v, int b)
+{
+	v->type = b? DSL_VALUE_TRUE: DSL_VALUE_FALSE;
+}
+
+static void vm_set_integer (DSLValue *v, int i)
+{
+	v->type = DSL_VALUE_INTEGER;
+	v->integer = i;
+}
+
+static void vm_set_string (DSLValue *v, const char *str, size_t len)
+{
+	v->type = DSL_VALUE_STRING;
+	v->str = str;
+	v->len = len;
+}
+
+static void vm_set_xfield (DSLValue *v, const tagEntry *entry, const char *key)
+{
+	const char *value = entry_xget (entry, key);
+
+	if (value)
+		vm_set_string (v, value, strlen (value));
+	else
+		vm_set_boolean (v, 0);
+}
+
+/* Return 0 if the tree-walker should handle the field. */
+static int vm_field (DSLValue *v, const tagEntry *entry, DSLField field)
+{
+	const char *s;
+	const char *colon;
+
+	switch (field)
+	{
+	case DSL_FIELD_NAME:
+		vm_set_string (v, entry->name, strlen (entry->name));
+		break;
+	case DSL_FIELD_INPUT:
+		vm_set_string (v, entry->file, strlen (entry->file));
+		break;
+	case DSL_FIELD_PATTERN:
+		s = entry->address.pattern;
+		if (s)
+			vm_set_string (v, s, strlen (s));
+		else
+			vm_set_boolean (v, 0);
+		break;
+	case DSL_FIELD_LINE:
+		if (entry->address.lineNumber == 0)
+			vm_set_boolean (v, 0);
+		else
+			vm_set_integer (v, (int) entry->address.lineNumber);
+		break;
+	case DSL_FIELD_END:
+		s = entry_xget (entry, "end");
+		if (s == NULL)
+			vm_set_boolean (v, 0);
+		else
+		{
+			/* Only plain decimal numbers; the reader of es.c
+			 * decides for anything else. */
+			const char *p = (*s == '-')? s + 1: s;
+			size_t len = strlen (p);
+			if (len == 0 || len > 9 || strspn (p, "0123456789") != len)
+				return 0;
+			vm_set_integer (v, atoi (s));
+		}
+		break;
+	case DSL_FIELD_FILE:
+		vm_set_boolean (v, entry->fileScope);
+		break;
+	case DSL_FIELD_KIND:
+		s = entry->kind;
+		if (s)
+			vm_set_string (v, s, strlen (s));
+		else
+			vm_set_boolean (v, 0);
+		break;
+	case DSL_FIELD_SCOPE_KIND:
+		s = entry_xget (entry, "scope");
+		colon = s? strchr (s, ':'): NULL;
+		if (colon)
+			vm_set_string (v, s, colon - s);
+		else
+			vm_set_boolean (v, 0);
+		break;
+	case DSL_FIELD_SCOPE_NAME:
+		s = entry_xget (entry, "scope");
+		colon = s? strchr (s, ':'): NULL;
+		if (colon && *(colon + 1) != '\0')
+			vm_set_string (v, colon + 1, strlen (colon + 1));
+		else
+			vm_set_boolean (v, 0);
+		break;
+	case DSL_FIELD_ACCESS:
+		vm_set_xfield (v, entry, "access");
+		break;
+	case DSL_FIELD_EXTRAS:
+		vm_set_xfield (v, entry, "extras");
+		break;
+	case DSL_FIELD_INHERITS:
+		vm_set_xfield (v, entry, "inherits");
+		break;
+	case DSL_FIELD_IMPLEMENTATION:
+		vm_set_xfield (v, entry, "implementation");
+		break;
+	case DSL_FIELD_LANGUAGE:
+		vm_set_xfield (v, entry, "language");
+		break;
+	case DSL_FIELD_SCOPE:
+		vm_set_xfield (v, entry, "scope");
+		break;
+	case DSL_FIELD_SIGNATURE:
+		vm_set_xfield (v, entry, "signature");
+		break;
+	case DSL_FIELD_TYPEREF:
+		vm_set_xfield (v, entry, "typeref");
+		break;
+	case DSL_FIELD_ROLES:
+		vm_set_xfield (v, entry, "roles");
+		break;
+	case DSL_FIELD_XPATH:
+		vm_set_xfield (v, entry, "xpath");
+		break;
+	default:
+		return 0;
+	}
+	return 1;
+}
+
+static int vm_string_equal (const DSLValue *a, const DSLValue *b)
+{
+	return a->len == b->len && memcmp (a->str, b->str, a->len) == 0;
+}
+
+/* Same as es_object_equal. */
+static int vm_equal (const DSLValue *a, const DSLValue *b)
+{
+	if (a->type != b->type)
+		return 0;
+
+	switch (a->type)
+	{
+	case DSL_VALUE_INTEGER:
+		return a->integer == b->integer;
+	case DSL_VALUE_STRING:
+		return vm_string_equal (a, b);
+	case DSL_VALUE_REGEX:
+		return a->regex == b->regex;
+	default:
+		return 1;
+	}
+}
+
+static int vm_substr (const DSLValue *t, const DSLValue *s)
+{
+	if (s->len == 0)
+		return 1;
+
+	for (size_t i = 0; i + s->len <= t->len; i++)
+	{
+		if (t->str [i] == s->str [0]
+			&& memcmp (t->str + i, s->str, s->len) == 0)
+			return 1;
+	}
+	return 0;
+}
+
+/* Run the instruction of a proc. Return 0 if the tree-walker
+ * should run the proc, typically for reporting a type error. */
+static int vm_apply (enum eDSLInsnOp op, DSLValue *dst,
+					 const DSLValue *a, const DSLValue *b)
+{
+	DSLValue r;
+	int i;
+
+	switch (op)
+	{
+	case INSN_NOT:
+		vm_set_boolean (&r, !vm_truthy (a));
+		break;
+	case INSN_NULL:
+		vm_set_boolean (&r, a->type == DSL_VALUE_NIL);
+		break;
+	case INSN_LENGTH:
+		if (a->type != DSL_VALUE_STRING)
+			return 0;
+		vm_set_integer (&r, (int) a->len);
+		break;
+	case INSN_FLIP:
+		if (a->type != DSL_VALUE_INTEGER)
+			return 0;
+		vm_set_integer (&r, (a->integer < 0)? 1: (a->integer == 0)? 0: -1);
+		break;
+	case INSN_EQ:
+		vm_set_boolean (&r, vm_equal (a, b));
+		break;
+	case INSN_LT:
+	case INSN_GT:
+	case INSN_LE:
+	case INSN_GE:
+	case INSN_ADD:
+	case INSN_SUB:
+		if (a->type != DSL_VALUE_INTEGER || b->type != DSL_VALUE_INTEGER)
+			return 0;
+		if (op == INSN_LT)
+			vm_set_boolean (&r, a->integer < b->integer);
+		else if (op == INSN_GT)
+			vm_set_boolean (&r, a->integer > b->integer);
+		else if (op == INSN_LE)
+			vm_set_boolean (&r, a->integer <= b->integer);
+		else if (op == INSN_GE)
+			vm_set_boolean (&r, a->integer >= b->integer);
+		else if (op == INSN_ADD)
+			vm_set_integer (&r, a->integer + b->integer);
+		else
+			vm_set_integer (&r, a->integer - b->integer);
+		break;
+	case INSN_PREFIX:
+	case INSN_SUFFIX:
+	case INSN_SUBSTR:
+		if (a->type != DSL_VALUE_STRING || b->type != DSL_VALUE_STRING)
+			return 0;
+		if (op == INSN_SUBSTR)
+			vm_set_boolean (&r, vm_substr (a, b));
+		else if (a->len < b->len)
+			vm_set_boolean (&r, 0);
+		else if (op == INSN_PREFIX)
+			vm_set_boolean (&r, memcmp (a->str, b->str, b->len) == 0);
+		else
+			vm_set_boolean (&r, memcmp (a->str + a->len - b->len,
+										b->str, b->len) == 0);
+		break;
+	case INSN_CMP:
+		if (a->type == DSL_VALUE_INTEGER && b->type == DSL_VALUE_INTEGER)
+			i = (a->integer < b->integer)? -1: (a->integer == b->integer)? 0: 1;
+		else if (a->type == DSL_VALUE_STRING && b->type == DSL_VALUE_STRING)
+		{
+			i = memcmp (a->str, b->str, (a->len < b->len)? a->len: b->len);
+			if (i == 0)
+				i = (a->len < b->len)? -1: (a->len == b->len)? 0: 1;
+			else
+				i = (i < 0)? -1: 1;
+		}
+		else
+			return 0;
+		vm_set_integer (&r, i);
+		break;
+	default:
+		return 0;
+	}
+
+	*dst = r;
+	return 1;
+}
+
+static int vm_match (DSLCode *code, DSLValue *dst,
+					 const DSLValue *a, const DSLValue *b)
+{
+	const char *str;
+
+	if (a->type != DSL_VALUE_STRING)
+		return 0;
+
+	if (a->str [a->len] == '\0')
+		str = a->str;
+	else
+	{
+		if (code->scratch_size < a->len + 1)
+		{
+			char *scratch = realloc (code->scratch, a->len + 1);
+			if (scratch == NULL)
+				return 0;
+			code->scratch = scratch;
+			code->scratch_size = a->len + 1;
+		}
+		memcpy (code->scratch, a->str, a->len);
+		code->scratch [a->len] = '\0';
+		str = code->scratch;
+	}
+
+	vm_set_boolean (dst, es_regex_match (b->regex, str));
+	return 1;
+}
+
+/* Return NULL if the tree-walker should evaluate the entry. */
+static const DSLValue *vm_exec (DSLCode *code, DSLEnv *env)
+{
+	DSLValue *regs = code->regs;
+	const DSLInsn *insns = code->insns;
+	int pc = 0;
+
+	for (;;)
+	{
+		const DSLInsn *insn = insns + pc++;
+		DSLValue *dst = regs + insn->dst;
+		const DSLValue *a = regs + insn->a;
+
+		switch (insn->op)
+		{
+		case INSN_RET:
+			return a;
+		case INSN_MOVE:
+			*dst = *a;
+			break;
+		case INSN_FIELD:
+			if (!vm_field (dst, env->entry, insn->arg))
+				return NULL;
+			break;
+		case INSN_ALT_FIELD:
+			if (env->alt_entry == NULL
+				|| !vm_field (dst, env->alt_entry, insn->arg))
+				return NULL;
+			break;
+		case INSN_XFIELD:
+			vm_set_xfield (dst, env->entry, a->str);
+			break;
+		case INSN_ALT_XFIELD:
+			if (env->alt_entry == NULL)
+				return NULL;
+			vm_set_xfield (dst, env->alt_entry, a->str);
+			break;
+		case INSN_JF:
+			if (!vm_truthy (a))
+				pc = insn->arg;
+			break;
+		case INSN_JT:
+			if (vm_truthy (a))
+				pc = insn->arg;
+			break;
+		case INSN_JCMP:
+			if (a->type == DSL_VALUE_INTEGER
+				&& (a->integer == -1 || a->integer == 1))
+				pc = insn->arg;
+			break;
+		case INSN_JMP:
+			pc = insn->arg;
+			break;
+		case INSN_MATCH:
+			if (!vm_match (code, dst, a, regs + insn->b))
+				return NULL;
+			break;
+		default:
+			if (!vm_apply (insn->op, dst, a, regs + insn->b))
+				return NULL;
+			break;
+		}
+	}
+}
+
+static int vm_emit (DSLCompiler *c, enum eDSLInsnOp op,
+					int dst, int a, int b, int arg)
+{
+	if (c->insn_count == c->insn_size)
+	{
+		int size = c->insn_size? c->insn_size * 2: 16;
+		DSLInsn *insns = realloc (c->insns, sizeof (DSLInsn) * size);
+		if (insns == NULL)
+		{
+			c->failed = 1;
+			return -1;
+		}
+		c->insns = insns;
+		c->insn_size = size;
+	}
+
+	DSLInsn *insn = c->insns + c->insn_count;
+	insn->op = op;
+	insn->dst = dst;
+	insn->a = a;
+	insn->b = b;
+	insn->arg = arg;
+	return c->insn_count++;
+}
+
+static void vm_patch (DSLCompiler *c, int insn)
+{
+	if (insn >= 0)
+		c->insns [insn].arg = c->insn_count;
+}
+
+static int vm_const (DSLCompiler *c, const DSLValue *v)
+{
+	if (c->const_count == c->const_size)
+	{
+		int size = c->const_size? c->const_size * 2: 8;
+		DSLValue *consts = realloc (c->consts, sizeof (DSLValue) * size);
+		if (consts == NULL)
+		{
+			c->failed = 1;
+			return VM_UNCOMPILABLE;
+		}
+		c->consts = consts;
+		c->const_size = size;
+	}
+
+	c->consts [c->const_count] = *v;
+	return - (++c->const_count);
+}
+
+static int vm_const_boolean (DSLCompiler *c, int b)
+{
+	DSLValue v = { .type = DSL_VALUE_FALSE };
+	vm_set_boolean (&v, b);
+	return vm_const (c, &v);
+}
+
+static int vm_temp (DSLCompiler *c)
+{
+	int t = c->temp_top++;
+	if (c->temp_top > c->temp_max)
+		c->temp_max = c->temp_top;
+	return t;
+}
+
+static int vm_move (DSLCompiler *c, int dst, int src)
+{
+	if (dst == src)
+		return 0;
+	return vm_emit (c, INSN_MOVE, dst, src, 0, 0);
+}
+
+static int vm_compile_expr (DSLCompiler *c, EsObject *expr);
+
+/* and and or */
+static int vm_compile_junction (DSLCompiler *c, EsObject *args,
+								enum eDSLInsnOp jump,
+								int (* decisive) (const DSLValue *))
+{
+	int base = c->temp_top;
+	int r = vm_temp (c);
+	int *jumps;
+	int jump_count = 0;
+	int all_const = 1;
+	int result = VM_UNCOMPILABLE;
+
+	jumps = malloc (sizeof (int) * length (args));
+	if (jumps == NULL)
+	{
+		c->failed = 1;
+		return VM_UNCOMPILABLE;
+	}
+
+	for (; !es_null (args); args = es_cdr (args))
+	{
+		int last = es_null (es_cdr (args));
+		int o = vm_compile_expr (c, es_car (args));
+
+		if (o == VM_UNCOMPILABLE)
+			goto out;
+
+		c->temp_top = base + 1;
+		if (VM_IS_CONST (o))
+		{
+			if (!(decisive (VM_CONST (c, o)) || last))
+				continue;
+			if (all_const)
+			{
+				result = o;
+				goto out;
+			}
+			vm_move (c, r, o);
+			break;
+		}
+
+		all_const = 0;
+		vm_move (c, r, o);
+		if (!last)
+			jumps [jump_count++] = vm_emit (c, jump, 0, r, 0, 0);
+	}
+
+	for (int i = 0; i < jump_count; i++)
+		vm_patch (c, jumps [i]);
+	result = r;
+
+ out:
+	c->temp_top = base + (VM_IS_CONST (result)? 0: 1);
+	free (jumps);
+	return result;
+}
+
+static int vm_falsy (const DSLValue *v)
+{
+	return !vm_truthy (v);
+}
+
+/* <or>: unlike or, all arguments are evaluated before choosing one. */
+static int vm_compile_cmp_or (DSLCompiler *c, EsObject *args)
+{
+	int base = c->temp_top;
+	int r = vm_temp (c);
+	int argc = length (args);
+	int *operands;
+	int *jumps;
+	int jump_count = 0;
+	int all_const = 1;
+	int result = VM_UNCOMPILABLE;
+
+	operands = malloc (sizeof (int) * argc * 2);
+	if (operands == NULL)
+	{
+		c->failed = 1;
+		return VM_UNCOMPILABLE;
+	}
+	jumps = operands + argc;
+
+	for (int i = 0; i < argc; i++, args = es_cdr (args))
+	{
+		operands [i] = vm_compile_expr (c, es_car (args));
+		if (operands [i] == VM_UNCOMPILABLE)
+			goto out;
+		else if (!VM_IS_CONST (operands [i]))
+			all_const = 0;
+	}
+
+	for (int i = 0; i < argc; i++)
+	{
+		int o = operands [i];
+		int last = (i == argc - 1);
+
+		if (VM_IS_CONST (o))
+		{
+			const DSLValue *v = VM_CONST (c, o);
+			int decided = (v->type == DSL_VALUE_INTEGER
+						   && (v->integer == -1 || v->integer == 1));
+
+			if (!(decided || last))
+				continue;
+			if (all_const)
+			{
+				result = o;
+				goto out;
+			}
+			vm_move (c, r, o);
+			break;
+		}
+
+		vm_move (c, r, o);
+		if (!last)
+			jumps [jump_count++] = vm_emit (c, INSN_JCMP, 0, r, 0, 0);
+	}
+
+	for (int i = 0; i < jump_count; i++)
+		vm_patch (c, jumps [i]);
+	result = r;
+
+ out:
+	c->temp_top = base + (VM_IS_CONST (result)? 0: 1);
+	free (operands);
+	return result;
+}
+
+/* Like <or>, if evaluates all the arguments before choosing one. */
+static int vm_compile_if (DSLCompiler *c, EsObject *args)
+{
+	int base = c->temp_top;
+	int r = vm_temp (c);
+	int o [3];
+	int jf, jmp;
+
+	for (int i = 0; i < 3; i++, args = es_cdr (args))
+	{
+		o [i] = vm_compile_expr (c, es_car (args));
+		if (o [i] == VM_UNCOMPILABLE)
+			return VM_UNCOMPILABLE;
+	}
+
+	if (VM_IS_CONST (o [0]))
+	{
+		int chosen = vm_truthy (VM_CONST (c, o [0]))? o [1]: o [2];
+		if (VM_IS_CONST (chosen))
+		{
+			c->temp_top = base;
+			return chosen;
+		}
+		vm_move (c, r, chosen);
+	}
+	else
+	{
+		jf = vm_emit (c, INSN_JF, 0, o [0], 0, 0);
+		vm_move (c, r, o [1]);
+		jmp = vm_emit (c, INSN_JMP, 0, 0, 0, 0);
+		vm_patch (c, jf);
+		vm_move (c, r, o [2]);
+		vm_patch (c, jmp);
+	}
+
+	c->temp_top = base + 1;
+	return r;
+}
+
+static int vm_compile_begin (DSLCompiler *c, EsObject *args, int begin0)
+{
+	int base = c->temp_top;
+	int r = VM_UNCOMPILABLE;
+
+	for (int i = 0; !es_null (args); i++, args = es_cdr (args))
+	{
+		int o = vm_compile_expr (c, es_car (args));
+		if (o == VM_UNCOMPILABLE)
+			return VM_UNCOMPILABLE;
+
+		if (begin0 && i > 0)
+		{
+			c->temp_top = VM_IS_CONST (r)? base: base + 1;
+			continue;
+		}
+
+		c->temp_top = base;
+		if (VM_IS_CONST (o))
+			r = o;
+		else
+		{
+			r = vm_temp (c);
+			vm_move (c, r, o);
+		}
+	}
+	return r;
+}
+
+/* Procs taking one or two evaluated arguments */
+static int vm_compile_apply (DSLCompiler *c, enum eDSLInsnOp op, EsObject *args)
+{
+	int base = c->temp_top;
+	int a, b = 0;
+	DSLValue v;
+
+	a = vm_compile_expr (c, es_car (args));
+	if (a == VM_UNCOMPILABLE)
+		return VM_UNCOMPILABLE;
+
+	if (!es_null (es_cdr (args)))
+	{
+		b = vm_compile_expr (c, es_car (es_cdr (args)));
+		if (b == VM_UNCOMPILABLE)
+			return VM_UNCOMPILABLE;
+	}
+	else
+		b = a;
+
+	c->temp_top = base;
+	if (VM_IS_CONST (a) && VM_IS_CONST (b)
+		&& vm_apply (op, &v, VM_CONST (c, a), VM_CONST (c, b)))
+		return vm_const (c, &v);
+
+	int r = vm_temp (c);
+	vm_emit (c, op, r, a, b, 0);
+	return r;
+}
+
+static int vm_compile_atom (DSLCompiler *c, EsObject *expr)
+{
+	DSLValue v = { .type = DSL_VALUE_NIL };
+
+	if (es_null (expr))
+		;
+	else if (es_boolean_p (expr))
+		vm_set_boolean (&v, es_boolean_get (expr));
+	else if (es_integer_p (expr))
+		vm_set_integer (&v, es_integer_get (expr));
+	else if (es_string_p (expr))
+	{
+		const char *str = es_string_get (expr);
+		vm_set_string (&v, str, strlen (str));
+	}
+	else
+		return VM_UNCOMPILABLE;
+
+	return vm_const (c, &v);
+}
+
+static int vm_compile_symbol (DSLCompiler *c, EsObject *expr)
+{
+	DSLProcBind *pb = dsl_lookup (c->engine, expr);
+	DSLValue v = { .type = DSL_VALUE_NIL };
+	int r;
+
+	if (pb == NULL)
+		return VM_UNCOMPILABLE;
+
+	switch (pb->vmop)
+	{
+	case DSL_VMOP_TRUE:
+		return vm_const_boolean (c, 1);
+	case DSL_VMOP_FALSE:
+		return vm_const_boolean (c, 0);
+	case DSL_VMOP_NIL:
+		return vm_const (c, &v);
+	case DSL_VMOP_FIELD:
+	case DSL_VMOP_ALT_FIELD:
+		r = vm_temp (c);
+		vm_emit (c, (pb->vmop == DSL_VMOP_FIELD)? INSN_FIELD: INSN_ALT_FIELD,
+				 r, 0, 0, pb->vmarg);
+		return r;
+	default:
+		return VM_UNCOMPILABLE;
+	}
+}
+
+static int vm_compile_expr (DSLCompiler *c, EsObject *expr)
+{
+	EsObject *car, *args;
+	DSLProcBind *pb;
+	int argc;
+	int o, r;
+
+	if (c->failed)
+		return VM_UNCOMPILABLE;
+	else if (es_symbol_p (expr))
+		return vm_compile_symbol (c, expr);
+	else if (!es_cons_p (expr))
+		return vm_compile_atom (c, expr);
+
+	car = es_car (expr);
+	args = es_cdr (expr);
+	argc = length (args);
+
+	if (es_regex_p (car))
+	{
+		DSLValue v = { .type = DSL_VALUE_REGEX, .regex = car };
+		int base = c->temp_top;
+
+		if (argc != 1)
+			return VM_UNCOMPILABLE;
+		o = vm_compile_expr (c, es_car (args));
+		if (o == VM_UNCOMPILABLE)
+			return VM_UNCOMPILABLE;
+		c->temp_top = base;
+		r = vm_temp (c);
+		vm_emit (c, INSN_MATCH, r, o, vm_const (c, &v), 0);
+		return r;
+	}
+	else if (!es_symbol_p (car))
+		return VM_UNCOMPILABLE;
+
+	pb = dsl_lookup (c->engine, car);
+	if (pb == NULL)
+		return VM_UNCOMPILABLE;
+
+	/* Leave the arity errors to the tree-walker. */
+	if ((pb->flags & DSL_PATTR_CHECK_ARITY)
+		&& (argc < pb->arity
+			|| (argc > pb->arity
+				&& (pb->flags & DSL_PATTR_CHECK_ARITY_OPT) != DSL_PATTR_CHECK_ARITY_OPT)))
+		return VM_UNCOMPILABLE;
+
+	switch (pb->vmop)
+	{
+	case DSL_VMOP_XFIELD:
+	case DSL_VMOP_ALT_XFIELD:
+		if (!es_string_p (es_car (args)))
+			return VM_UNCOMPILABLE;
+		o = vm_compile_atom (c, es_car (args));
+		r = vm_temp (c);
+		vm_emit (c, (pb->vmop == DSL_VMOP_XFIELD)? INSN_XFIELD: INSN_ALT_XFIELD,
+				 r, o, 0, 0);
+		return r;
+	case DSL_VMOP_BEGIN:
+	case DSL_VMOP_BEGIN0:
+		if (argc == 0)
+			return VM_UNCOMPILABLE;
+		return vm_compile_begin (c, args, pb->vmop == DSL_VMOP_BEGIN0);
+	case DSL_VMOP_AND:
+		if (argc == 0)
+			return vm_const_boolean (c, 1);
+		return vm_compile_junction (c, args, INSN_JF, vm_falsy);
+	case DSL_VMOP_OR:
+		if (argc == 0)
+			return vm_const_boolean (c, 0);
+		return vm_compile_junction (c, args, INSN_JT, vm_truthy);
+	case DSL_VMOP_CMP_OR:
+		return vm_compile_cmp_or (c, args);
+	case DSL_VMOP_IF:
+		return vm_compile_if (c, args);
+	case DSL_VMOP_NOT:
+		return vm_compile_apply (c, INSN_NOT, args);
+	case DSL_VMOP_NULL:
+		return vm_compile_apply (c, INSN_NULL, args);
+	case DSL_VMOP_LENGTH:
+		return vm_compile_apply (c, INSN_LENGTH, args);
+	case DSL_VMOP_FLIP:
+		return vm_compile_apply (c, INSN_FLIP, args);
+	case DSL_VMOP_EQ:
+		return vm_compile_apply (c, INSN_EQ, args);
+	case DSL_VMOP_LT:
+		return vm_compile_apply (c, INSN_LT, args);
+	case DSL_VMOP_GT:
+		return vm_compile_apply (c, INSN_GT, args);
+	case DSL_VMOP_LE:
+		return vm_compile_apply (c, INSN_LE, args);
+	case DSL_VMOP_GE:
+		return vm_compile_apply (c, INSN_GE, args);
+	case DSL_VMOP_ADD:
+		return vm_compile_apply (c, INSN_ADD, args);
+	case DSL_VMOP_SUB:
+		return vm_compile_apply (c, INSN_SUB, args);
+	case DSL_VMOP_PREFIX:
+		return vm_compile_apply (c, INSN_PREFIX, args);
+	case DSL_VMOP_SUFFIX:
+		return vm_compile_apply (c, INSN_SUFFIX, args);
+	case DSL_VMOP_SUBSTR:
+		return vm_compile_apply (c, INSN_SUBSTR, args);
+	case DSL_VMOP_CMP:
+		return vm_compile_apply (c, INSN_CMP, args);
+	default:
+		return VM_UNCOMPILABLE;
+	}
+}
+
+static int vm_reloc (int nconsts, int o)
+{
+	return VM_IS_CONST (o)? (-o - 1): nconsts + o;
+}
+
+static void vm_compile (DSLEngineType engine, DSLCode *code)
+{
+	DSLCompiler c = { .engine = engine };
+	int o = vm_compile_expr (&c, code->expr);
+
+	if (o != VM_UNCOMPILABLE)
+		vm_emit (&c, INSN_RET, 0, o, 0, 0);
+
+	if (o == VM_UNCOMPILABLE || c.failed)
+		goto out;
+
+	code->reg_count = c.const_count + c.temp_max;
+	code->regs = calloc (code->reg_count, sizeof (DSLValue));
+	if (code->regs == NULL)
+		goto out;
+	memcpy (code->regs, c.consts, sizeof (DSLValue) * c.const_count);
+
+	for (int i = 0; i < c.insn_count; i++)
+	{
+		DSLInsn *insn = c.insns + i;
+		insn->dst = vm_reloc (c.const_count, insn->dst);
+		insn->a = vm_reloc (c.const_count, insn->a);
+		insn->b = vm_reloc (c.const_count, insn->b);
+	}
+	code->insns = c.insns;
+	code->insn_count = c.insn_count;
+	c.insns = NULL;
+
+ out:
+	free (c.insns);
+	free (c.consts);
+}
+
+static void vm_check (DSLCode *code, DSLEnv *env, int boolean, int r)
+{
+	EsObject *o;
+	int mismatch;
+
+	es_autounref_pool_push ();
+	o = dsl_eval (code, env);
+	if (boolean)
+		mismatch = es_error_p (o) || (es_object_equal (o, es_false) == r);
+	else
+		mismatch = !es_integer_p (o) || es_integer_get (o) != r;
+	if (mismatch)
+		dsl_report_error ("BYTECODE MISMATCH", code->expr);
+	es_autounref_pool_pop ();
+	dsl_cache_reset (env->engine);
+
+	if (mismatch)
+		exit (1);
+}
+
+int dsl_exec_boolean (DSLCode *code, DSLEnv *env, int *r)
+{
+	const DSLValue *v;
+
+	if (code->insns == NULL || (v = vm_exec (code, env)) == NULL)
+		return 0;
+
+	*r = vm_truthy (v);
+	if (vm_mode () == VM_MODE_CHECK)
+		vm_check (code, env, 1, *r);
+	return 1;
+}
+
+int dsl_exec_integer (DSLCode *code, DSLEnv *env, int *r)
+{
+	const DSLValue *v;
+
+	if (code->insns == NULL || (v = vm_exec (code, env)) == NULL
+		|| v->type != DSL_VALUE_INTEGER)
+		return 0;
+
+	*r = v->integer;
+	if (vm_mode () == VM_MODE_CHECK)
+		vm_check (code, env, 0, *r);
+	return 1;
+}
+
 /*
  * Built-ins
  */
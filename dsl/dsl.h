@@ -38,6 +38,65 @@ typedef struct sDSLEnv DSLEnv;
 typedef EsObject* (* DSLProc)  (EsObject *args, DSLEnv *env);
 typedef EsObject* (* DSLMacro)  (EsObject *expr);
 
+/* How dsl_compile translates a proc to the bytecode.
+ * An expression using a proc with DSL_VMOP_NONE is left to
+ * the tree-walker (dsl_eval). */
+enum eDSLVMOp {
+	DSL_VMOP_NONE,
+	DSL_VMOP_TRUE,
+	DSL_VMOP_FALSE,
+	DSL_VMOP_NIL,
+	DSL_VMOP_FIELD,				/* vmarg: DSLField */
+	DSL_VMOP_ALT_FIELD,			/* vmarg: DSLField */
+	DSL_VMOP_XFIELD,
+	DSL_VMOP_ALT_XFIELD,
+	DSL_VMOP_BEGIN,
+	DSL_VMOP_BEGIN0,
+	DSL_VMOP_AND,
+	DSL_VMOP_OR,
+	DSL_VMOP_IF,
+	DSL_VMOP_NOT,
+	DSL_VMOP_NULL,
+	DSL_VMOP_EQ,
+	DSL_VMOP_LT,
+	DSL_VMOP_GT,
+	DSL_VMOP_LE,
+	DSL_VMOP_GE,
+	DSL_VMOP_ADD,
+	DSL_VMOP_SUB,
+	DSL_VMOP_PREFIX,
+	DSL_VMOP_SUFFIX,
+	DSL_VMOP_SUBSTR,
+	DSL_VMOP_LENGTH,
+	DSL_VMOP_CMP,
+	DSL_VMOP_FLIP,
+	DSL_VMOP_CMP_OR,
+};
+typedef enum eDSLVMOp DSLVMOp;
+
+enum eDSLField {
+	DSL_FIELD_NAME,
+	DSL_FIELD_INPUT,
+	DSL_FIELD_PATTERN,
+	DSL_FIELD_LINE,
+	DSL_FIELD_ACCESS,
+	DSL_FIELD_END,
+	DSL_FIELD_EXTRAS,
+	DSL_FIELD_FILE,
+	DSL_FIELD_INHERITS,
+	DSL_FIELD_IMPLEMENTATION,
+	DSL_FIELD_KIND,
+	DSL_FIELD_LANGUAGE,
+	DSL_FIELD_SCOPE,
+	DSL_FIELD_SCOPE_KIND,
+	DSL_FIELD_SCOPE_NAME,
+	DSL_FIELD_SIGNATURE,
+	DSL_FIELD_TYPEREF,
+	DSL_FIELD_ROLES,
+	DSL_FIELD_XPATH,
+};
+typedef enum eDSLField DSLField;
+
 
 enum eDSLPAttr {
 	DSL_PATTR_MEMORABLE   = 1UL << 0,
@@ -57,6 +116,8 @@ struct sDSLProcBind {
 	int arity;
 	const char* helpstr;
 	DSLMacro macro;
+	DSLVMOp vmop;
+	int vmarg;
 };
 
 typedef struct sDSLCode DSLCode;
@@ -91,6 +152,17 @@ DSLCode       *dsl_compile     (DSLEngineType engine, EsObject *expr);
 EsObject      *dsl_eval        (DSLCode *code, DSLEnv *env);
 void           dsl_release     (DSLEngineType engine, DSLCode *code);
 
+/* Evaluate CODE with its bytecode. Return 1 and store the result to
+ * *R if the bytecode could evaluate it. Return 0 if CODE has no
+ * bytecode, or if the evaluation needs the tree-walker, e.g. for
+ * reporting an error. Then the caller should use dsl_eval.
+ *
+ * If READTAGS_DSL_VM environment variable is set to "no", dsl_compile
+ * makes no bytecode. If it is set to "check", the result of the
+ * bytecode is verified with the tree-walker. */
+int            dsl_exec_boolean (DSLCode *code, DSLEnv *env, int *r);
+int            dsl_exec_integer (DSLCode *code, DSLEnv *env, int *r);
+
 /* This should be remove when we have a real compiler. */
 EsObject *dsl_compile_and_eval (EsObject *expr, DSLEnv *env);
 
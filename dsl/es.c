@@ -1352,6 +1352,13 @@ es_regex_exec    (const EsObject* regex,
 					0, NULL, 0)? es_false: es_true;
 }
 
+int
+es_regex_match   (const EsObject* regex,
+				  const char* str)
+{
+	return regexec (((EsRegex*)regex)->code, str, 0, NULL, 0)? 0: 1;
+}
+
 /*
  * Error
  */
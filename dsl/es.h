@@ -158,6 +158,8 @@ EsObject*    es_regex_compile (const char* pat,
 int          es_regex_p       (const EsObject* object);
 EsObject*    es_regex_exec    (const EsObject* regex,
 							   const EsObject* str);
+int          es_regex_match   (const EsObject* regex,
+							   const char* str);
 
 /*
  * Foreign pointer
@@ -84,6 +84,10 @@ enum QRESULT q_is_acceptable  (QCode *code, tagEntry *entry)
 		.engine = DSL_QUALIFIER,
 		.entry  = entry,
 	};
+
+	if (dsl_exec_boolean (code->dsl, &env, &i))
+		return i? Q_ACCEPT: Q_REJECT;
+
 	es_autounref_pool_push ();
 	r = dsl_eval (code->dsl, &env);
 	if (es_object_equal (r, es_false))
@@ -80,53 +80,76 @@ static EsObject* sorter_sform_cmp_or (EsObject* args, DSLEnv *env);
 
 static DSLProcBind pbinds [] = {
 	{ "<>",              sorter_proc_cmp,          NULL, DSL_PATTR_CHECK_ARITY,     2,
-	  .helpstr = "(<> a b) -> -1|0|1; compare a b. The types of a and b must be the same." },
+	  .helpstr = "(<> a b) -> -1|0|1; compare a b. The types of a and b must be the same.",
+	  .vmop = DSL_VMOP_CMP },
 	{ "*-",              sorter_proc_flip,         NULL, DSL_PATTR_CHECK_ARITY,     1,
-	  .helpstr = "(*- n<interger>) -> -n<integer>; filp the result of comparison." },
+	  .helpstr = "(*- n<interger>) -> -n<integer>; filp the result of comparison.",
+	  .vmop = DSL_VMOP_FLIP },
 	{ "<or>",            sorter_sform_cmp_or,      NULL, DSL_PATTR_CHECK_ARITY_OPT, 1,
-	  .helpstr = "(<or> args...) -> -1|0|1; evaluate arguments left to right till one of thme returns -1 or 1." },
+	  .helpstr = "(<or> args...) -> -1|0|1; evaluate arguments left to right till one of thme returns -1 or 1.",
+	  .vmop = DSL_VMOP_CMP_OR },
 
 	{ "&",               sorter_alt_entry_ref, NULL, DSL_PATTR_CHECK_ARITY,  1,
-	  .helpstr = "(& FIELD) -> #f|<string>" },
+	  .helpstr = "(& FIELD) -> #f|<string>",
+	  .vmop = DSL_VMOP_ALT_XFIELD },
 	{ "&name",           alt_value_name,           NULL, DSL_PATTR_MEMORABLE, 0UL,
-	  .helpstr = "-> <string>"},
+	  .helpstr = "-> <string>",
+	  .vmop = DSL_VMOP_ALT_FIELD, .vmarg = DSL_FIELD_NAME },
 	{ "&input",          alt_value_input,          NULL, DSL_PATTR_MEMORABLE, 0UL,
-	  .helpstr = "-> <string>"},
+	  .helpstr = "-> <string>",
+	  .vmop = DSL_VMOP_ALT_FIELD, .vmarg = DSL_FIELD_INPUT },
 	{ "&pattern",        alt_value_pattern,        NULL, DSL_PATTR_MEMORABLE, 0UL,
-	  .helpstr = "-> #f|<string>"},
+	  .helpstr = "-> #f|<string>",
+	  .vmop = DSL_VMOP_ALT_FIELD, .vmarg = DSL_FIELD_PATTERN },
 	{ "&line",           alt_value_line,           NULL, DSL_PATTR_MEMORABLE, 0UL,
-	  .helpstr = "-> #f|<integer>" },
+	  .helpstr = "-> #f|<integer>",
+	  .vmop = DSL_VMOP_ALT_FIELD, .vmarg = DSL_FIELD_LINE },
 
 	{ "&access",         alt_value_access,         NULL, DSL_PATTR_MEMORABLE, 0UL,
-	  .helpstr = "-> #f|<string>" },
+	  .helpstr = "-> #f|<string>",
+	  .vmop = DSL_VMOP_ALT_FIELD, .vmarg = DSL_FIELD_ACCESS },
 	{ "&end",            alt_value_end,            NULL, DSL_PATTR_MEMORABLE, 0UL,
-	  .helpstr = "-> #f|<integer>"},
+	  .helpstr = "-> #f|<integer>",
+	  .vmop = DSL_VMOP_ALT_FIELD, .vmarg = DSL_FIELD_END },
 	{ "&extras",         alt_value_extras,         NULL, DSL_PATTR_MEMORABLE, 0UL,
-	  .helpstr = "-> #f|<string>"},
+	  .helpstr = "-> #f|<string>",
+	  .vmop = DSL_VMOP_ALT_FIELD, .vmarg = DSL_FIELD_EXTRAS },
 	{ "&file",           alt_value_file,           NULL, DSL_PATTR_MEMORABLE, 0UL,
-	  .helpstr = "-> <boolean>; whether the scope is limited in the file or not." },
+	  .helpstr = "-> <boolean>; whether the scope is limited in the file or not.",
+	  .vmop = DSL_VMOP_ALT_FIELD, .vmarg = DSL_FIELD_FILE },
 	{ "&inherits",       alt_value_inherits,       NULL, DSL_PATTR_MEMORABLE, 0UL,
-	  .helpstr = "-> <list>" },
+	  .helpstr = "-> <list>",
+	  .vmop = DSL_VMOP_ALT_FIELD, .vmarg = DSL_FIELD_INHERITS },
 	{ "&implementation", alt_value_implementation, NULL, DSL_PATTR_MEMORABLE, 0UL,
-	  .helpstr = "-> #f|<string>" },
+	  .helpstr = "-> #f|<string>",
+	  .vmop = DSL_VMOP_ALT_FIELD, .vmarg = DSL_FIELD_IMPLEMENTATION },
 	{ "&kind",           alt_value_kind,           NULL, DSL_PATTR_MEMORABLE, 0UL,
-	  .helpstr = "-> #f|<string>"},
+	  .helpstr = "-> #f|<string>",
+	  .vmop = DSL_VMOP_ALT_FIELD, .vmarg = DSL_FIELD_KIND },
 	{ "&language",       alt_value_language,       NULL, DSL_PATTR_MEMORABLE, 0UL,
-	  .helpstr = "-> #f|<string>" },
+	  .helpstr = "-> #f|<string>",
+	  .vmop = DSL_VMOP_ALT_FIELD, .vmarg = DSL_FIELD_LANGUAGE },
 	{ "&scope",          alt_value_scope,          NULL, DSL_PATTR_MEMORABLE, 0UL,
-	  .helpstr = "-> #f|<string>; $scope-kind:$scope-name"},
+	  .helpstr = "-> #f|<string>; $scope-kind:$scope-name",
+	  .vmop = DSL_VMOP_ALT_FIELD, .vmarg = DSL_FIELD_SCOPE },
 	{ "&scope-kind",     alt_value_scope_kind,     NULL, DSL_PATTR_MEMORABLE, 0UL,
-	  .helpstr = "-> #f|<string>"},
+	  .helpstr = "-> #f|<string>",
+	  .vmop = DSL_VMOP_ALT_FIELD, .vmarg = DSL_FIELD_SCOPE_KIND },
 	{ "&scope-name",     alt_value_scope_name,     NULL, DSL_PATTR_MEMORABLE, 0UL,
-	  .helpstr = "-> #f|<string>"},
+	  .helpstr = "-> #f|<string>",
+	  .vmop = DSL_VMOP_ALT_FIELD, .vmarg = DSL_FIELD_SCOPE_NAME },
 	{ "&signature",      alt_value_signature,      NULL, DSL_PATTR_MEMORABLE, 0UL,
-	  .helpstr = "-> #f|<string>" },
+	  .helpstr = "-> #f|<string>",
+	  .vmop = DSL_VMOP_ALT_FIELD, .vmarg = DSL_FIELD_SIGNATURE },
 	{ "&typeref",        alt_value_typeref,        NULL, DSL_PATTR_MEMORABLE, 0UL,
-	  .helpstr = "-> #f|<string>"},
+	  .helpstr = "-> #f|<string>",
+	  .vmop = DSL_VMOP_ALT_FIELD, .vmarg = DSL_FIELD_TYPEREF },
 	{ "&roles",          alt_value_roles,          NULL, DSL_PATTR_MEMORABLE, 0UL,
-	  .helpstr = "-> <list>" },
+	  .helpstr = "-> <list>",
+	  .vmop = DSL_VMOP_ALT_FIELD, .vmarg = DSL_FIELD_ROLES },
 	{ "&xpath",         alt_value_xpath,           NULL, DSL_PATTR_MEMORABLE, 0UL,
-	  .helpstr = "-> #f|<string>"},
+	  .helpstr = "-> #f|<string>",
+	  .vmop = DSL_VMOP_ALT_FIELD, .vmarg = DSL_FIELD_XPATH },
 };
 
 /*
@@ -339,6 +362,10 @@ int s_compare        (const tagEntry * a, const tagEntry * b, SCode *code)
 		.entry = a,
 		.alt_entry = b,
 	};
+
+	if (dsl_exec_integer (code->dsl, &env, &i))
+		return (i < 0)? -1: (i == 0)? 0: 1;
+
 	es_autounref_pool_push ();
 	r = dsl_eval (code->dsl, &env);
 
@@ -15,6 +15,23 @@
 #include <stdio.h>
 #include <errno.h>
 #include <sys/types.h>  /* to declare off_t */
+#include <sys/stat.h>   /* to declare stat () */
+#if defined (__unix__) || defined (__APPLE__)
+# include <unistd.h>
+# if defined (_POSIX_MAPPED_FILES) && _POSIX_MAPPED_FILES > 0
+#  include <sys/mman.h>
+#  define USE_MMAP
+# endif
+#endif
+
+/* The nanoseconds of the last modified time in struct stat */
+#if defined (__APPLE__)
+# define ST_MTIME_NSEC(st) ((long) (st).st_mtimespec.tv_nsec)
+#elif defined (_POSIX_VERSION) && _POSIX_VERSION >= 200809L
+# define ST_MTIME_NSEC(st) ((long) (st).st_mtim.tv_nsec)
+#else
+# define ST_MTIME_NSEC(st) 0L
+#endif
 
 #include "readtags.h"
 
@@ -23,6 +40,14 @@
 */
 #define TAB '\t'
 
+/* See main/tagindex.c of Universal Ctags for the format of the index. */
+#define INDEX_SUFFIX ".idx"
+#define INDEX_MAGIC "ctagsIX2"
+#define INDEX_HEADER_SIZE 36
+#define INDEX_KEY_LENGTH 8
+#define INDEX_ENTRY_SIZE (8 + INDEX_KEY_LENGTH)
+#define INDEX_MAX_BLOCK_SIZE 65536
+
 
 /*
 *   DATA DECLARATIONS
@@ -42,6 +67,13 @@ struct sTagFile {
 	tagSortType sortMethod;
 		/* pointer to file structure */
 	FILE* fp;
+		/* whole tag file mapped to memory, or NULL for reading with `fp' */
+	const char *map;
+		/* file position of the next line to read in `map' */
+	off_t mapPos;
+		/* last modified time of tag file when mapping it */
+	time_t mapMtime;
+	long mapMtimeNsec;
 		/* file position of first character of `line' */
 	off_t pos;
 		/* size of tag file in seekable positions */
@@ -62,7 +94,30 @@ struct sTagFile {
 			short partial;
 				/* ignoring case */
 			short ignorecase;
+				/* using the index */
+			short indexed;
+				/* position of last match in the index */
+			unsigned long cursor;
 	} search;
+		/* index of the tag file written by ctags --tag-index */
+	struct {
+				/* NULL if no valid index is available */
+			FILE *fp;
+				/* size of tag file the index was made for */
+			off_t tagFileSize;
+				/* number of entries in each order */
+			unsigned long count;
+				/* number of entries in a block */
+			unsigned long blockSize;
+				/* number of blocks in each order */
+			unsigned long fenceCount;
+				/* first entries of the blocks, read on demand */
+			unsigned char *fences [2];
+				/* entries of the last block read */
+			unsigned char *block;
+			int blockOrder;
+			unsigned long blockIndex;
+	} index;
 		/* miscellaneous extension fields */
 	struct {
 				/* number of entries in `list' */
@@ -93,6 +148,12 @@ static const char *const EmptyString = "";
 static const char *const PseudoTagPrefix = "!_";
 static const size_t PseudoTagPrefixLength = 2;
 
+/*
+*   FUNCTION PROTOTYPES
+*/
+static void openIndex (tagFile *const file, const char *const filePath);
+static void closeIndex (tagFile *const file);
+
 /*
 *   FUNCTION DEFINITIONS
 */
@@ -266,6 +327,147 @@ static tagResult copyName (tagFile *const file)
 	return TagSuccess;
 }
 
+/* Map the whole tag file to memory. Reading a line is then scanning
+ * the mapping with memchr () and copying the line, and the pages are
+ * shared with other processes reading the same tag file.
+ *
+ * A tag file rewritten in place may be truncated under the mapping.
+ * updateTagFileSize () maps it again when its size or last modified
+ * time changes, so a change between lookups is seen as with stdio. */
+static void mapTagFile (tagFile *const file)
+{
+#ifdef USE_MMAP
+	struct stat st;
+	void *addr;
+
+	if (file->size <= 0 || (unsigned long long) file->size > (size_t) -1)
+		return;
+	if (fstat (fileno (file->fp), &st) != 0 || st.st_size != file->size)
+		return;
+
+	addr = mmap (NULL, (size_t) file->size, PROT_READ, MAP_PRIVATE,
+				 fileno (file->fp), 0);
+	if (addr != MAP_FAILED)
+	{
+		file->map = (const char *) addr;
+		file->mapPos = 0;
+		file->mapMtime = st.st_mtime;
+		file->mapMtimeNsec = ST_MTIME_NSEC (st);
+	}
+#endif
+}
+
+static void unmapTagFile (tagFile *const file)
+{
+#ifdef USE_MMAP
+	if (file->map != NULL)
+		munmap ((void *) file->map, (size_t) file->size);
+#endif
+	file->map = NULL;
+}
+
+static int seekTagFile (tagFile *const file, off_t pos)
+{
+	if (file->map == NULL)
+		return fseek (file->fp, pos, SEEK_SET);
+	else if (pos < 0)
+	{
+		errno = EINVAL;
+		return -1;
+	}
+	file->mapPos = pos;
+	return 0;
+}
+
+static off_t tellTagFile (tagFile *const file)
+{
+	if (file->map == NULL)
+		return ftell (file->fp);
+	return file->mapPos;
+}
+
+/* Update the size of the tag file, and rewind it. A mapped tag file is
+ * mapped again if it is changed since mapping it. */
+static int updateTagFileSize (tagFile *const file)
+{
+	off_t size;
+
+#ifdef USE_MMAP
+	if (file->map != NULL)
+	{
+		struct stat st;
+
+		if (fstat (fileno (file->fp), &st) != 0)
+			return -1;
+		if (st.st_size == file->size
+			&& st.st_mtime == file->mapMtime
+			&& ST_MTIME_NSEC (st) == file->mapMtimeNsec)
+			return seekTagFile (file, 0L);
+		unmapTagFile (file);
+	}
+#endif
+
+	if (fseek (file->fp, 0, SEEK_END) == -1)
+		return -1;
+	size = ftell (file->fp);
+	if (size == -1)
+		return -1;
+	file->size = size;
+	if (fseek (file->fp, 0L, SEEK_SET) == -1)
+		return -1;
+	mapTagFile (file);
+	return 0;
+}
+
+/* Same as readTagLineRaw () for a mapped tag file */
+static int readTagLineFromMap (tagFile *const file, int *err)
+{
+	const char *start = file->map + file->mapPos;
+	const char *end;
+	size_t length, i;
+
+	file->pos = file->mapPos;
+	if (file->mapPos >= file->size)
+	{
+		*err = 0;
+		return 0;
+	}
+
+	end = (const char *) memchr (start, '\n', (size_t) (file->size - file->mapPos));
+	if (end == NULL)
+		end = file->map + file->size;
+	else
+		end++;
+	length = (size_t) (end - start);
+
+	while (file->line.size <= length)
+	{
+		if (growString (&file->line) != TagSuccess)
+		{
+			*err = ENOMEM;
+			return 0;
+		}
+	}
+	memcpy (file->line.buffer, start, length);
+	file->line.buffer [length] = '\0';
+	file->mapPos += length;
+
+	i = strlen (file->line.buffer);
+	while (i > 0  &&
+		   (file->line.buffer [i - 1] == '\n' || file->line.buffer [i - 1] == '\r'))
+	{
+		file->line.buffer [i - 1] = '\0';
+		--i;
+	}
+
+	if (copyName (file) != TagSuccess)
+	{
+		*err = ENOMEM;
+		return 0;
+	}
+	return 1;
+}
+
 /* Return 1 on success.
  * Return 0 on failure or EOF.
  * errno is set to *err unless EOF.
@@ -275,6 +477,9 @@ static int readTagLineRaw (tagFile *const file, int *err)
 	int result = 1;
 	int reReadLine;
 
+	if (file->map != NULL)
+		return readTagLineFromMap (file, err);
+
 	/*  If reading the line places any character other than a null or a
 	 *  newline at the last character position in the buffer (one less than
 	 *  the buffer size), then we must resize the buffer and reattempt to read
@@ -632,7 +837,7 @@ static int isPseudoTagLine (const char *buffer)
 
 static tagResult readPseudoTags (tagFile *const file, tagFileInfo *const info)
 {
-	fpos_t startOfLine;
+	off_t startOfLine = 0;
 	int err = 0;
 	tagResult result = TagSuccess;
 	const size_t prefixLength = strlen (PseudoTagPrefix);
@@ -646,7 +851,7 @@ static tagResult readPseudoTags (tagFile *const file, tagFileInfo *const info)
 
 	while (1)
 	{
-		if (fgetpos (file->fp, &startOfLine) < 0)
+		if ((startOfLine = tellTagFile (file)) < 0)
 		{
 			err = errno;
 			break;
@@ -730,7 +935,7 @@ static tagResult readPseudoTags (tagFile *const file, tagFileInfo *const info)
 			info->program.version = file->program.version;
 		}
 	}
-	if (fsetpos (file->fp, &startOfLine) < 0)
+	if (seekTagFile (file, startOfLine) < 0)
 		err = errno;
 
 	info->status.error_number = err;
@@ -746,9 +951,9 @@ static int doesFilePointPseudoTag (tagFile *const file, void *unused)
 
 static tagResult gotoFirstLogicalTag (tagFile *const file)
 {
-	fpos_t startOfLine;
+	off_t startOfLine;
 
-	if (fseek(file->fp, 0L, SEEK_SET) == -1)
+	if (seekTagFile (file, 0L) == -1)
 	{
 		file->err = errno;
 		return TagFailure;
@@ -756,7 +961,7 @@ static tagResult gotoFirstLogicalTag (tagFile *const file)
 
 	while (1)
 	{
-		if (fgetpos (file->fp, &startOfLine) < 0)
+		if ((startOfLine = tellTagFile (file)) < 0)
 		{
 			file->err = errno;
 			return TagFailure;
@@ -770,7 +975,7 @@ static tagResult gotoFirstLogicalTag (tagFile *const file)
 		if (!isPseudoTagLine (file->line.buffer))
 			break;
 	}
-	if (fsetpos (file->fp, &startOfLine) < 0)
+	if (seekTagFile (file, startOfLine) < 0)
 	{
 		file->err = errno;
 		return TagFailure;
@@ -822,9 +1027,11 @@ static tagFile *initialize (const char *const filePath, tagFileInfo *const info)
 			info->status.error_number = errno;
 			goto file_error;
 		}
+		mapTagFile (result);
 
 		if (readPseudoTags (result, info) == TagFailure)
 			goto file_error;
+		openIndex (result, filePath);
 
 		info->status.opened = 1;
 		result->initialized = 1;
@@ -836,6 +1043,7 @@ static tagFile *initialize (const char *const filePath, tagFileInfo *const info)
 	free (result->line.buffer);
 	free (result->name.buffer);
 	free (result->fields.list);
+	unmapTagFile (result);
 	if (result->fp)
 		fclose (result->fp);
 	free (result);
@@ -845,7 +1053,9 @@ static tagFile *initialize (const char *const filePath, tagFileInfo *const info)
 
 static void terminate (tagFile *const file)
 {
+	unmapTagFile (file);
 	fclose (file->fp);
+	closeIndex (file);
 
 	free (file->line.buffer);
 	free (file->name.buffer);
@@ -903,7 +1113,7 @@ static const char *readFieldValue (
 
 static int readTagLineSeek (tagFile *const file, const off_t pos)
 {
-	if (fseek (file->fp, pos, SEEK_SET) < 0)
+	if (seekTagFile (file, pos) < 0)
 	{
 		file->err = errno;
 		return 0;
@@ -1030,6 +1240,287 @@ static tagResult findBinary (tagFile *const file)
 	return result;
 }
 
+static unsigned long long getIndexNumber (const unsigned char *p, size_t length)
+{
+	unsigned long long n = 0;
+	while (length-- > 0)
+		n = (n << 8) | *p++;
+	return n;
+}
+
+static void closeIndex (tagFile *const file)
+{
+	if (file->index.fp != NULL)
+		fclose (file->index.fp);
+	free (file->index.fences [0]);
+	free (file->index.fences [1]);
+	free (file->index.block);
+	memset (&file->index, 0, sizeof (file->index));
+}
+
+/* Use the index only if it is made for the tag file as it is now. Any
+ * error here just makes tag lookups not use the index. */
+static void openIndex (tagFile *const file, const char *const filePath)
+{
+	unsigned char header [INDEX_HEADER_SIZE];
+	struct stat st;
+	char *indexPath;
+	unsigned long long count, blockSize, fenceCount;
+
+	if (stat (filePath, &st) != 0)
+		return;
+
+	indexPath = (char *) malloc (strlen (filePath) + sizeof (INDEX_SUFFIX));
+	if (indexPath == NULL)
+		return;
+	strcpy (indexPath, filePath);
+	strcat (indexPath, INDEX_SUFFIX);
+	file->index.fp = fopen (indexPath, "rb");
+	free (indexPath);
+	if (file->index.fp == NULL)
+		return;
+
+	if (fread (header, sizeof (header), 1, file->index.fp) != 1
+		|| memcmp (header, INDEX_MAGIC, 8) != 0
+		|| getIndexNumber (header + 8, 8) != (unsigned long long) file->size
+		|| getIndexNumber (header + 16, 8) != (unsigned long long) st.st_mtime
+		|| getIndexNumber (header + 24, 4) != (unsigned long long) ST_MTIME_NSEC (st))
+		goto invalid;
+
+	count = getIndexNumber (header + 28, 4);
+	blockSize = getIndexNumber (header + 32, 4);
+	if (blockSize == 0 || blockSize > INDEX_MAX_BLOCK_SIZE)
+		goto invalid;
+	fenceCount = (count + blockSize - 1) / blockSize;
+
+	if (fseek (file->index.fp, 0L, SEEK_END) == -1
+		|| (unsigned long long) ftell (file->index.fp)
+		!= INDEX_HEADER_SIZE + 2 * INDEX_ENTRY_SIZE * (count + fenceCount))
+		goto invalid;
+
+	file->index.block = (unsigned char *) malloc (blockSize * INDEX_ENTRY_SIZE);
+	if (file->index.block == NULL)
+		goto invalid;
+	file->index.tagFileSize = file->size;
+	file->index.count = (unsigned long) count;
+	file->index.blockSize = (unsigned long) blockSize;
+	file->index.fenceCount = (unsigned long) fenceCount;
+	file->index.blockOrder = -1;
+	return;
+
+ invalid:
+	closeIndex (file);
+}
+
+static int isIndexUsable (tagFile *const file)
+{
+	return file->index.fp != NULL && file->index.tagFileSize == file->size;
+}
+
+static tagResult readIndex (tagFile *const file, long offset,
+							unsigned char *buffer, size_t size)
+{
+	if (fseek (file->index.fp, offset, SEEK_SET) == -1)
+	{
+		file->err = errno;
+		return TagFailure;
+	}
+	if (fread (buffer, size, 1, file->index.fp) != 1)
+	{
+		file->err = ferror (file->index.fp)? errno: TagErrnoUnexpectedFormat;
+		return TagFailure;
+	}
+	return TagSuccess;
+}
+
+static const unsigned char *getIndexFences (tagFile *const file, int order)
+{
+	if (file->index.fences [order] == NULL)
+	{
+		const size_t size = file->index.fenceCount * INDEX_ENTRY_SIZE;
+		unsigned char *fences = (unsigned char *) malloc (size);
+
+		if (fences == NULL)
+		{
+			file->err = ENOMEM;
+			return NULL;
+		}
+		if (readIndex (file,
+					   INDEX_HEADER_SIZE
+					   + 2 * INDEX_ENTRY_SIZE * file->index.count
+					   + order * size,
+					   fences, size) != TagSuccess)
+		{
+			free (fences);
+			return NULL;
+		}
+		file->index.fences [order] = fences;
+	}
+	return file->index.fences [order];
+}
+
+/* Return the entries in a block, and store the number of them to LENGTH. */
+static const unsigned char *getIndexBlock (tagFile *const file, int order,
+										   unsigned long blockIndex,
+										   unsigned long *length)
+{
+	const unsigned long first = blockIndex * file->index.blockSize;
+
+	*length = file->index.count - first;
+	if (*length > file->index.blockSize)
+		*length = file->index.blockSize;
+
+	if (file->index.blockOrder != order || file->index.blockIndex != blockIndex)
+	{
+		file->index.blockOrder = -1;
+		if (readIndex (file,
+					   INDEX_HEADER_SIZE
+					   + INDEX_ENTRY_SIZE * (order * file->index.count + first),
+					   file->index.block, *length * INDEX_ENTRY_SIZE) != TagSuccess)
+			return NULL;
+		file->index.blockOrder = order;
+		file->index.blockIndex = blockIndex;
+	}
+	return file->index.block;
+}
+
+/* Compare the name searched for with the first bytes of a name in the
+ * index as nameComparison () does. Set *DECIDED to 0 if the bytes are
+ * not enough. */
+static int keyComparison (tagFile *const file, const unsigned char *key, int *decided)
+{
+	const char *s = file->search.name;
+	size_t n = file->search.nameLength;
+	const int ignorecase = file->search.ignorecase;
+	const int partial = file->search.partial;
+	int i;
+
+	*decided = 1;
+	for (i = 0; i < INDEX_KEY_LENGTH; i++)
+	{
+		/* tagncmp () compares plain chars. */
+		int c1 = (partial && !ignorecase)? s [i]: (unsigned char) s [i];
+		int c2 = key [i];
+		int result = ignorecase? toupper (c1) - toupper (c2): c1 - c2;
+
+		if (result != 0)
+			return result;
+		if (partial && --n == 0)
+			return 0;
+		if (c1 == '\0' || c2 == '\0')
+			return 0;
+	}
+	*decided = 0;
+	return 0;
+}
+
+static int readTagLineAt (tagFile *const file, off_t pos)
+{
+	if (seekTagFile (file, pos) < 0)
+	{
+		file->err = errno;
+		return 0;
+	}
+	return readTagLine (file, &file->err);
+}
+
+static tagResult entryComparison (tagFile *const file, const unsigned char *entry,
+								  int *comp)
+{
+	int decided;
+
+	*comp = keyComparison (file, entry + 8, &decided);
+	if (decided)
+		return TagSuccess;
+
+	if (! readTagLineAt (file, (off_t) getIndexNumber (entry, 8)))
+	{
+		if (! file->err)
+			file->err = TagErrnoUnexpectedFormat;
+		return TagFailure;
+	}
+	*comp = nameComparison (file);
+	return TagSuccess;
+}
+
+/* Read the line of the I-th entry, and return whether the name matches. */
+static tagResult matchIndexEntry (tagFile *const file, unsigned long i)
+{
+	const int order = file->search.ignorecase? 1: 0;
+	const unsigned char *entries;
+	unsigned long length;
+
+	if (i >= file->index.count)
+		return TagFailure;
+
+	entries = getIndexBlock (file, order, i / file->index.blockSize, &length);
+	if (entries == NULL)
+		return TagFailure;
+	if (! readTagLineAt (file, (off_t) getIndexNumber (entries + INDEX_ENTRY_SIZE
+														* (i % file->index.blockSize), 8)))
+	{
+		if (! file->err)
+			file->err = TagErrnoUnexpectedFormat;
+		return TagFailure;
+	}
+	if (nameComparison (file) != 0)
+		return TagFailure;
+
+	file->search.cursor = i;
+	return TagSuccess;
+}
+
+/* Find the first entry whose name is not less than the name searched
+ * for: binary search in the fences, and then in a block. */
+static tagResult findIndexed (tagFile *const file)
+{
+	const int order = file->search.ignorecase? 1: 0;
+	const unsigned char *entries;
+	unsigned long lower, upper, length, blockIndex = 0;
+	int comp;
+
+	file->search.cursor = file->index.count;
+	if (file->index.count == 0)
+		return TagFailure;
+
+	entries = getIndexFences (file, order);
+	if (entries == NULL)
+		return TagFailure;
+	lower = 0;
+	upper = file->index.fenceCount;
+	while (lower < upper)
+	{
+		const unsigned long middle = lower + (upper - lower) / 2;
+		if (entryComparison (file, entries + middle * INDEX_ENTRY_SIZE, &comp) != TagSuccess)
+			return TagFailure;
+		if (comp > 0)
+			lower = middle + 1;
+		else
+			upper = middle;
+	}
+	if (lower == 0)
+		return matchIndexEntry (file, 0);
+
+	blockIndex = lower - 1;
+	entries = getIndexBlock (file, order, blockIndex, &length);
+	if (entries == NULL)
+		return TagFailure;
+	/* The first entry is the fence known to be less. */
+	lower = 1;
+	upper = length;
+	while (lower < upper)
+	{
+		const unsigned long middle = lower + (upper - lower) / 2;
+		if (entryComparison (file, entries + middle * INDEX_ENTRY_SIZE, &comp) != TagSuccess)
+			return TagFailure;
+		if (comp > 0)
+			lower = middle + 1;
+		else
+			upper = middle;
+	}
+	return matchIndexEntry (file, blockIndex * file->index.blockSize + lower);
+}
+
 static tagResult findSequentialFull (tagFile *const file,
 									 int (* isAcceptable) (tagFile *const, void *),
 									 void *data)
@@ -1076,23 +1567,22 @@ static tagResult find (tagFile *const file, tagEntry *const entry,
 	file->search.nameLength = strlen (name);
 	file->search.partial = (options & TAG_PARTIALMATCH) != 0;
 	file->search.ignorecase = (options & TAG_IGNORECASE) != 0;
-	if (fseek (file->fp, 0, SEEK_END) < 0)
+	if (updateTagFileSize (file) == -1)
 	{
 		file->err = errno;
 		return TagFailure;
 	}
-	file->size = ftell (file->fp);
-	if (file->size == -1)
+	file->search.indexed = isIndexUsable (file);
+	if (file->search.indexed)
 	{
-		file->err = errno;
-		return TagFailure;
-	}
-	if (fseek(file->fp, 0L, SEEK_SET) == -1)
-	{
-		file->err = errno;
-		return TagFailure;
+#ifdef DEBUG
+		fputs ("<performing search with index>\n", stderr);
+#endif
+		result = findIndexed (file);
+		if (result == TagFailure && file->err)
+			return TagFailure;
 	}
-	if ((file->sortMethod == TAG_SORTED      && !file->search.ignorecase) ||
+	else if ((file->sortMethod == TAG_SORTED      && !file->search.ignorecase) ||
 		(file->sortMethod == TAG_FOLDSORTED  &&  file->search.ignorecase))
 	{
 #ifdef DEBUG
@@ -1147,6 +1637,13 @@ static tagResult findNextFull (tagFile *const file, tagEntry *const entry,
 
 static tagResult findNext (tagFile *const file, tagEntry *const entry)
 {
+	if (file->search.indexed)
+	{
+		tagResult result = matchIndexEntry (file, file->search.cursor + 1);
+		if (result == TagSuccess && entry != NULL)
+			result = parseTagLine (file, entry, &file->err);
+		return result;
+	}
 	return findNextFull (file, entry,
 						 (file->sortMethod == TAG_SORTED      && !file->search.ignorecase) ||
 						 (file->sortMethod == TAG_FOLDSORTED  &&  file->search.ignorecase),
@@ -1163,7 +1660,7 @@ static tagResult findPseudoTag (tagFile *const file, int rewindBeforeFinding, ta
 
 	if (rewindBeforeFinding)
 	{
-		if (fseek(file->fp, 0L, SEEK_SET) == -1)
+		if (updateTagFileSize (file) == -1)
 		{
 			file->err = errno;
 			return TagFailure;
@@ -1215,6 +1712,11 @@ extern tagResult tagsFirst (tagFile *const file, tagEntry *const entry)
 		return TagFailure;
 	}
 
+	if (updateTagFileSize (file) == -1)
+	{
+		file->err = errno;
+		return TagFailure;
+	}
 	if (gotoFirstLogicalTag (file) != TagSuccess)
 		return TagFailure;
 	return readNext (file, entry);
@@ -0,0 +1,211 @@
+/*
+*   Copyright (c) 2026, Universal Ctags Team
+*
+*   This source code is released for free distribution under the terms of the
+*   GNU General Public License version 2 or (at your option) any later version.
+*
+*   This module contains functions managing memory arenas.
+*
+*   An arena allocates memory by bumping a pointer in a block. When the
+*   block is full, a new block twice as large as the last one (up to
+*   ARENA_MAX_BLOCK_SIZE) is allocated. Allocations are never freed one by
+*   one; all of them are released at once. The first block is kept when
+*   clearing an arena, so an arena reused for each input file seldom calls
+*   malloc().
+*/
+
+/*
+*   INCLUDE FILES
+*/
+#include "general.h"  /* must always come first */
+
+#include <stdint.h>
+#include <string.h>
+
+#include "arena_p.h"
+#include "debug.h"
+#include "routines.h"
+
+/*
+*   MACROS
+*/
+#define ARENA_MIN_BLOCK_SIZE (16 * 1024)
+#define ARENA_MAX_BLOCK_SIZE (1024 * 1024)
+#define ARENA_ALIGNMENT (sizeof (void *) > sizeof (double)? sizeof (void *): sizeof (double))
+
+/*
+*   DATA DECLARATIONS
+*/
+
+struct sArenaBlock {
+	struct sArenaBlock *next;
+	char *end;
+	/* the memory for allocations follows */
+};
+
+struct sArena {
+	struct sArenaBlock *blocks;	/* the last block comes first */
+	char *current;				/* the free memory in the first block */
+	size_t nextBlockSize;
+	struct sArenaBlock **sorted;	/* the blocks sorted by address, for arenaOwns() */
+	unsigned int count;
+	unsigned int allocated;
+};
+
+/*
+*   DATA DEFINITIONS
+*/
+static unsigned long AllocationCount;
+
+/*
+*   FUNCTION DEFINITIONS
+*/
+
+static size_t alignSize (const size_t size)
+{
+	return (size + ARENA_ALIGNMENT - 1) & ~(ARENA_ALIGNMENT - 1);
+}
+
+static char *blockStart (struct sArenaBlock *const block)
+{
+	return (char *) block + alignSize (sizeof (struct sArenaBlock));
+}
+
+static void addBlock (arena *const current, const size_t size)
+{
+	size_t blockSize = current->nextBlockSize;
+	struct sArenaBlock *block;
+
+	if (blockSize < size)
+		blockSize = size;
+
+	block = eMalloc (alignSize (sizeof (struct sArenaBlock)) + blockSize);
+	block->next = current->blocks;
+	block->end = blockStart (block) + blockSize;
+	current->blocks = block;
+	current->current = blockStart (block);
+
+	unsigned int i = current->count;
+	if (current->count == current->allocated)
+	{
+		current->allocated = current->allocated? current->allocated * 2: 8;
+		current->sorted = xRealloc (current->sorted, current->allocated,
+									struct sArenaBlock *);
+	}
+	while (i > 0 && current->sorted [i - 1] > block)
+	{
+		current->sorted [i] = current->sorted [i - 1];
+		i--;
+	}
+	current->sorted [i] = block;
+	current->count++;
+
+	if (current->nextBlockSize < ARENA_MAX_BLOCK_SIZE)
+		current->nextBlockSize *= 2;
+}
+
+extern arena *arenaNew (void)
+{
+	arena *const result = xMalloc (1, arena);
+
+	result->blocks = NULL;
+	result->current = NULL;
+	result->nextBlockSize = ARENA_MIN_BLOCK_SIZE;
+	result->sorted = NULL;
+	result->count = 0;
+	result->allocated = 0;
+	return result;
+}
+
+extern void *arenaAlloc (arena *const current, const size_t size)
+{
+	const size_t aligned = alignSize (size);
+	void *result;
+
+	if (current->blocks == NULL
+		|| (size_t) (current->blocks->end - current->current) < aligned)
+		addBlock (current, aligned);
+
+	result = current->current;
+	current->current += aligned;
+	AllocationCount++;
+	return result;
+}
+
+extern void *arenaCalloc (arena *const current, const size_t count, const size_t size)
+{
+	void *const result = arenaAlloc (current, count * size);
+
+	memset (result, 0, count * size);
+	return result;
+}
+
+extern char *arenaStrdup (arena *const current, const char *const str)
+{
+	const size_t size = strlen (str) + 1;
+	char *const result = arenaAlloc (current, size);
+
+	memcpy (result, str, size);
+	return result;
+}
+
+extern bool arenaOwns (const arena *const current, const void *const ptr)
+{
+	const char *const p = ptr;
+	unsigned int low = 0, high = current->count;
+
+	/* Find the last block starting at or before p. */
+	while (low < high)
+	{
+		unsigned int middle = low + (high - low) / 2;
+
+		if ((const char *) current->sorted [middle] <= p)
+			low = middle + 1;
+		else
+			high = middle;
+	}
+	if (low == 0)
+		return false;
+
+	struct sArenaBlock *const block = current->sorted [low - 1];
+	return blockStart (block) <= p && p < block->end;
+}
+
+extern void arenaClear (arena *const current)
+{
+	struct sArenaBlock *block = current->blocks;
+	struct sArenaBlock *first = NULL;
+
+	while (block)
+	{
+		struct sArenaBlock *const next = block->next;
+
+		if (next == NULL)
+			first = block;
+		else
+			eFree (block);
+		block = next;
+	}
+
+	current->blocks = first;
+	current->current = first? blockStart (first): NULL;
+	current->count = first? 1: 0;
+	if (first)
+		current->sorted [0] = first;
+	current->nextBlockSize = ARENA_MIN_BLOCK_SIZE * 2;
+}
+
+extern void arenaDelete (arena *const current)
+{
+	arenaClear (current);
+	if (current->blocks)
+		eFree (current->blocks);
+	if (current->sorted)
+		eFree (current->sorted);
+	eFree (current);
+}
+
+extern unsigned long arenaCountAllocations (void)
+{
+	return AllocationCount;
+}
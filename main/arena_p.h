@@ -0,0 +1,42 @@
+/*
+*   Copyright (c) 2026, Universal Ctags Team
+*
+*   This source code is released for free distribution under the terms of the
+*   GNU General Public License version 2 or (at your option) any later version.
+*
+*   Defines private interface to memory arenas.
+*/
+#ifndef CTAGS_MAIN_ARENA_PRIVATE_H
+#define CTAGS_MAIN_ARENA_PRIVATE_H
+
+/*
+*   INCLUDE FILES
+*/
+#include "general.h"  /* must always come first */
+
+#include <stddef.h>
+
+/*
+*   DATA DECLARATIONS
+*/
+struct sArena;
+typedef struct sArena arena;
+
+/*
+*   FUNCTION PROTOTYPES
+*/
+
+/* Memory allocated from an arena cannot be freed one by one.
+ * All of it is released at once with arenaClear() or arenaDelete(). */
+extern arena *arenaNew (void);
+extern void *arenaAlloc (arena *const current, const size_t size);
+extern void *arenaCalloc (arena *const current, const size_t count, const size_t size);
+extern char *arenaStrdup (arena *const current, const char *const str);
+extern bool arenaOwns (const arena *const current, const void *const ptr);
+extern void arenaClear (arena *const current);
+extern void arenaDelete (arena *const current);
+
+/* The number of allocations from all arenas */
+extern unsigned long arenaCountAllocations (void);
+
+#endif  /* CTAGS_MAIN_ARENA_PRIVATE_H */
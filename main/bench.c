@@ -0,0 +1,170 @@
+/*
+*   Copyright (c) 2026, Universal Ctags Team
+*
+*   This source code is released for free distribution under the terms of the
+*   GNU General Public License version 2 or (at your option) any later version.
+*
+*   This module contains the micro benchmarks run with --_bench-* options.
+*/
+
+/*
+*   INCLUDE FILES
+*/
+#include "general.h"  /* must always come first */
+
+#include <stdio.h>
+#include <time.h>
+
+#include "bench_p.h"
+#include "htable.h"
+#include "routines.h"
+
+/*
+*   DATA DECLARATIONS
+*/
+struct htableBench {
+	char **keys;
+	char **misses;
+	unsigned int count;
+	unsigned int rounds;
+	unsigned long digest [2];
+};
+
+/*
+*   FUNCTION DEFINITIONS
+*/
+
+/* Run the variants one after another RUNS times, and store the best rate
+ * of each variant to RATES. Taking the runs alternately keeps a change
+ * of the load of a noisy machine from favoring one variant. */
+extern void benchBestOfRuns (benchRunFunc run, void *data,
+							 unsigned int variants, unsigned int runs,
+							 double *rates)
+{
+	for (unsigned int v = 0; v < variants; v++)
+		rates [v] = 0.0;
+
+	for (unsigned int r = 0; r < runs; r++)
+	{
+		for (unsigned int v = 0; v < variants; v++)
+		{
+			double rate = run (v, data);
+			if (rate > rates [v])
+				rates [v] = rate;
+		}
+	}
+}
+
+extern double benchRate (clock_t start, double ops)
+{
+	double seconds = ((double) (clock () - start)) / CLOCKS_PER_SEC;
+	return (seconds > 0.0)? ops / seconds: 0.0;
+}
+
+static bool htableBenchDigest (const void *const key CTAGS_ATTR_UNUSED, void *value, void *data)
+{
+	unsigned long *digest = data;
+	*digest = *digest * 31 + HT_PTR_TO_UINT (value);
+	return true;
+}
+
+/* Run the operations the parsers do on a table, with keys[] having an
+ * item put twice every 8 keys, and return a digest of the results. */
+static unsigned long htableBenchExercise (hashTable *htable, char **keys, char **misses,
+										  unsigned int count)
+{
+	unsigned long digest = 0;
+	unsigned int i;
+
+	for (i = 0; i < count; i++)
+		hashTablePutItem (htable, keys[i], HT_UINT_TO_PTR (i + 1));
+	for (i = 0; i < count; i += 8)
+		hashTablePutItem (htable, keys[i], HT_UINT_TO_PTR (count + i + 1));
+	digest += hashTableCountItem (htable);
+
+	for (i = 0; i < count; i++)
+		digest = digest * 31 + HT_PTR_TO_UINT (hashTableGetItem (htable, keys[i]));
+	for (i = 0; i < count; i++)
+		digest = digest * 31 + hashTableHasItem (htable, misses[i]);
+	for (i = 0; i < count; i += 8)
+		hashTableForeachItemOnChain (htable, keys[i], htableBenchDigest, &digest);
+
+	for (i = 0; i < count; i++)
+		digest = digest * 31 + hashTableDeleteItem (htable, keys[i]);
+	for (i = 0; i < count; i += 8)
+	{
+		digest = digest * 31 + HT_PTR_TO_UINT (hashTableGetItem (htable, keys[i]));
+		digest = digest * 31 + hashTableDeleteItem (htable, keys[i]);
+	}
+	digest += hashTableCountItem (htable);
+
+	return digest;
+}
+
+/* Variant 0 is the growable table, and variant 1 is the chained table. */
+static double htableBenchRun (unsigned int variant, void *data)
+{
+	struct htableBench *bench = data;
+	clock_t start = clock ();
+
+	for (unsigned int r = 0; r < bench->rounds; r++)
+	{
+		/* The chained table is sized as cpreprocessor.c did for the
+		 * macro table. */
+		hashTable *htable = (variant == 0)
+			? hashTableGrowableNew (64, hashCstrhash, hashCstreq, NULL, NULL)
+			: hashTableNew (1024, hashCstrhash, hashCstreq, NULL, NULL);
+		bench->digest [variant] = htableBenchExercise (htable, bench->keys, bench->misses,
+													   bench->count);
+		hashTableDelete (htable);
+	}
+
+	unsigned int ops = bench->count * 5 + (bench->count + 7) / 8 * 5;
+	return benchRate (start, ops * (double) bench->rounds);
+}
+
+/* Measure the operation rate of the growable table and the chained
+ * table for some numbers of string keys, and verify that both tables
+ * give the same results. */
+extern void benchHashTable (FILE *fp)
+{
+	static const unsigned int counts [] = { 1024, 8192, 65536 };
+
+	for (unsigned int c = 0; c < ARRAY_SIZE (counts); c++)
+	{
+		unsigned int count = counts [c];
+		struct htableBench bench = {
+			.keys = xMalloc (count, char *),
+			.misses = xMalloc (count, char *),
+			.count = count,
+			.rounds = 131072 / count + 1,
+		};
+		char buf [32];
+
+		for (unsigned int i = 0; i < count; i++)
+		{
+			snprintf (buf, sizeof (buf), "SYMBOL_%u", i);
+			bench.keys [i] = eStrdup (buf);
+			snprintf (buf, sizeof (buf), "symbol_%u", i);
+			bench.misses [i] = eStrdup (buf);
+		}
+
+		double rates [2];
+		benchBestOfRuns (htableBenchRun, &bench, 2, 3, rates);
+
+		if (bench.digest [0] != bench.digest [1])
+			error (FATAL, "the growable and chained hash tables give different results for %u items",
+				   count);
+
+		fprintf (fp, "%7u items %12.0f ops/s (growable) %12.0f ops/s (chained, 1024 buckets)\n",
+				 count, rates [0], rates [1]);
+
+		for (unsigned int i = 0; i < count; i++)
+		{
+			eFree (bench.keys [i]);
+			eFree (bench.misses [i]);
+		}
+		eFree (bench.keys);
+		eFree (bench.misses);
+	}
+}
@@ -0,0 +1,36 @@
+/*
+*   Copyright (c) 2026, Universal Ctags Team
+*
+*   This source code is released for free distribution under the terms of the
+*   GNU General Public License version 2 or (at your option) any later version.
+*
+*   main part private interface to bench.c
+*/
+#ifndef CTAGS_MAIN_BENCH_PRIVATE_H
+#define CTAGS_MAIN_BENCH_PRIVATE_H
+
+/*
+*   INCLUDE FILES
+*/
+#include "general.h"  /* must always come first */
+#include <stdio.h>
+#include <time.h>
+
+/*
+*   DATA DECLARATIONS
+*/
+
+/* Returns the rate, in operations per second, of a run of VARIANT. */
+typedef double (* benchRunFunc) (unsigned int variant, void *data);
+
+/*
+*   FUNCTION PROTOTYPES
+*/
+extern void benchBestOfRuns (benchRunFunc run, void *data,
+							 unsigned int variants, unsigned int runs,
+							 double *rates);
+extern double benchRate (clock_t start, double ops);
+
+extern void benchHashTable (FILE *fp);
+
+#endif	/* CTAGS_MAIN_BENCH_PRIVATE_H */
@@ -0,0 +1,447 @@
+/*
+*   Copyright (c) 2026, Universal Ctags Team
+*
+*   This source code is released for free distribution under the terms of the
+*   GNU General Public License version 2 or (at your option) any later version.
+*
+*   This module keeps the tags of input files in a cache directory
+*   (--cache-dir=DIR), and reuses them for unchanged input files.
+*
+*   The cache has an entry file for each pair of the path of an input
+*   file written in the tags and the directory of the tag file. An entry
+*   holds the tag output made for the input file, and the things the
+*   output depends on:
+*
+*   - the size, the modification time and a hash of the content of the
+*     input file,
+*   - a fingerprint of the program version and the options given, in
+*     the order they were given, from any source.
+*
+*   If all of them match, the output is copied to the tag file without
+*   running any parser. Otherwise the input file is parsed with the
+*   output going to memory, and the output is copied to both the tag
+*   file and a new entry.
+*
+*   The parser specific pseudo tags are emitted only once, before the
+*   tags made by the parser for the first time. An entry doesn't hold
+*   them, but records the positions where they may be emitted, like the
+*   output of a worker process for --jobs.
+*/
+
+/*
+*   INCLUDE FILES
+*/
+#include "general.h"  /* must always come first */
+
+#include "cache_p.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#ifdef HAVE_UNISTD_H
+# include <unistd.h>
+#endif
+
+#include "ctags.h"
+#include "entry_p.h"
+#include "error_p.h"
+#include "mio.h"
+#include "options_p.h"
+#include "parse_p.h"
+#include "read_p.h"
+#include "routines.h"
+#include "routines_p.h"
+#include "stats_p.h"
+#include "vstring.h"
+#include "xtag_p.h"
+
+/*
+*   MACROS
+*/
+#define TAG_CACHE_MAGIC "ctagsC1"
+
+/* 64-bit FNV-1a */
+#define HASH_INIT  UINT64_C(14695981039346656037)
+#define HASH_PRIME UINT64_C(1099511628211)
+
+/*
+*   DATA DECLARATIONS
+*/
+
+struct tagCacheHeader {
+	char magic [8];
+	uint64_t fingerprint;
+	uint64_t contentHash;
+	unsigned long size;
+	int64_t mtime;
+	size_t pathLength;			/* the tag path of the input file follows */
+	unsigned long tags;
+	size_t maxTagName, maxTagLine;
+	long files, lines, bytes;	/* for --totals */
+	unsigned int markCount;		/* the number of tagCacheMarks following the path */
+	long outputLength;			/* the length of the output following the marks */
+};
+
+struct tagCacheMark {
+	long offset;				/* offset in the output */
+	langType language;
+};
+
+/*
+*   DATA DEFINITIONS
+*/
+static uint64_t OptionFingerprint = HASH_INIT;
+
+static bool Recording;
+static MIO *RecordingMio;
+static struct tagCacheMark *Marks;
+static unsigned int MarkCount;
+static unsigned int MarkAllocated;
+
+/* Options which don't change the tags made for an input file.
+ * The directory of the tag file is a part of the key of an entry. */
+static const char *const NeutralLongOptions [] = {
+	"append", "cache-dir", "dedup-inputs", "jobs", "quiet", "sort-memory",
+	"tag-index", "totals", "update", "verbose",
+};
+static const char NeutralShortOptions [] = "afoV";
+
+/*
+*   FUNCTION DEFINITIONS
+*/
+
+static uint64_t hashBytes (uint64_t hash, const void *const data, size_t size)
+{
+	const unsigned char *p = data;
+
+	while (size-- > 0)
+	{
+		hash ^= *p++;
+		hash *= HASH_PRIME;
+	}
+	return hash;
+}
+
+static uint64_t hashString (uint64_t hash, const char *const s)
+{
+	/* The terminator is included for separating strings. */
+	return hashBytes (hash, s, strlen (s) + 1);
+}
+
+extern void noteOptionForTagCache (bool longOption, const char *const option,
+								   const char *const parameter)
+{
+	if (longOption)
+	{
+		for (unsigned int i = 0; i < ARRAY_SIZE (NeutralLongOptions); i++)
+			if (strcmp (option, NeutralLongOptions [i]) == 0)
+				return;
+	}
+	else if (strchr (NeutralShortOptions, option [0]))
+		return;
+
+	OptionFingerprint = hashString (OptionFingerprint, longOption? "--": "-");
+	OptionFingerprint = hashString (OptionFingerprint, option);
+	OptionFingerprint = hashString (OptionFingerprint, parameter? parameter: "");
+}
+
+extern bool isTagCacheEnabled (void)
+{
+	return (Option.cacheDir != NULL
+			&& ! Recording
+			&& ! Option.filter
+			&& ! Option.interactive
+			&& ! Option.printLanguage);
+}
+
+extern bool isTagCacheRecording (void)
+{
+	return Recording;
+}
+
+extern void notePseudoTagsPositionInTagCache (const langType language)
+{
+	for (unsigned int i = 0; i < MarkCount; i++)
+		if (Marks [i].language == language)
+			return;
+
+	if (MarkCount == MarkAllocated)
+	{
+		MarkAllocated = MarkAllocated? MarkAllocated * 2: 4;
+		Marks = xRealloc (Marks, MarkAllocated, struct tagCacheMark);
+	}
+	Marks [MarkCount].offset = mio_tell (RecordingMio);
+	Marks [MarkCount].language = language;
+	MarkCount++;
+}
+
+static uint64_t getFingerprint (void)
+{
+	uint64_t hash = OptionFingerprint;
+
+	hash = hashString (hash, TAG_CACHE_MAGIC);
+	hash = hashString (hash, PROGRAM_VERSION);
+	hash = hashString (hash, ctags_repoinfo? ctags_repoinfo: "");
+
+	/* Some defaults depend on the destination, not on the options. */
+	hash = hashString (hash, isDestinationStdout ()? "stdout": "file");
+	hash = hashString (hash, isXtagEnabled (XTAG_PSEUDO_TAGS)? "ptags": "");
+	return hash;
+}
+
+/*  Make the name of the entry file for the input file. The tag path,
+ *  not the file itself, is the key: the output holds it as given. */
+static char *makeEntryName (const char *const tagPath)
+{
+	uint64_t hash = HASH_INIT;
+	char name [2 * sizeof (hash) + 1];
+
+	hash = hashString (hash, getTagFileDirectory ());
+	hash = hashString (hash, tagPath);
+	snprintf (name, sizeof (name), "%016llx", (unsigned long long) hash);
+
+	return combinePathAndFile (Option.cacheDir, name);
+}
+
+static bool hashFileContent (const char *const fileName, uint64_t *const hash)
+{
+	MIO *mio = mio_new_mmap (fileName);
+	unsigned char *data;
+	size_t size;
+
+	*hash = HASH_INIT;
+
+	if (mio == NULL)
+		mio = mio_new_file (fileName, "rb");
+	if (mio == NULL)
+		return false;
+
+	data = mio_memory_get_data (mio, &size);
+	if (data)
+		*hash = hashBytes (*hash, data, size);
+	else
+	{
+		char buffer [BUFSIZ];
+
+		while ((size = mio_read (mio, buffer, 1, sizeof (buffer))) > 0)
+			*hash = hashBytes (*hash, buffer, size);
+	}
+
+	mio_unref (mio);
+	return true;
+}
+
+/*  Copy the output to the tag file, emitting the parser specific pseudo
+ *  tags at the marks. */
+static void copyOutput (MIO *const output, long length,
+						const struct tagCacheMark *const marks, unsigned int markCount)
+{
+	long offset = 0;
+
+	for (unsigned int m = 0; m < markCount; m++)
+	{
+		copyToTagFile (output, marks [m].offset - offset);
+		offset = marks [m].offset;
+		replayParserPseudoTags (marks [m].language);
+	}
+	copyToTagFile (output, length - offset);
+}
+
+static bool replayEntry (const char *const entryName, const char *const path,
+						 const char *const tagPath, const fileStatus *const status)
+{
+	struct tagCacheHeader header;
+	struct tagCacheMark *marks = NULL;
+	char *cachedPath = NULL;
+	uint64_t contentHash;
+	long start;
+	bool hit = false;
+	MIO *mio = mio_new_file (entryName, "rb");
+
+	if (mio == NULL)
+		return false;
+
+	if (mio_read (mio, &header, sizeof (header), 1) != 1
+		|| memcmp (header.magic, TAG_CACHE_MAGIC, sizeof (header.magic)) != 0
+		|| header.fingerprint != getFingerprint ()
+		|| header.size != status->size
+		|| header.mtime != (int64_t) status->mtime
+		|| header.pathLength != strlen (tagPath))
+		goto out;
+
+	cachedPath = xMalloc (header.pathLength, char);
+	if (mio_read (mio, cachedPath, 1, header.pathLength) != header.pathLength
+		|| memcmp (cachedPath, tagPath, header.pathLength) != 0)
+		goto out;
+
+	if (header.markCount > 0)
+	{
+		marks = xMalloc (header.markCount, struct tagCacheMark);
+		if (mio_read (mio, marks, sizeof (*marks), header.markCount) != header.markCount)
+			goto out;
+	}
+
+	/* Check the length of the output before copying any of it. */
+	start = mio_tell (mio);
+	if (mio_seek (mio, 0, SEEK_END) != 0
+		|| mio_tell (mio) - start != header.outputLength
+		|| mio_seek (mio, start, SEEK_SET) != 0)
+		goto out;
+
+	if (! hashFileContent (path, &contentHash) || contentHash != header.contentHash)
+		goto out;
+
+	verbose ("using the tag cache for %s\n", path);
+	copyOutput (mio, header.outputLength, marks, header.markCount);
+	setNumTagsAdded (numTagsAdded () + header.tags);
+	updateMaxTagLengths (header.maxTagName, header.maxTagLine);
+	addTotals ((unsigned int) header.files,
+			   (unsigned long) header.lines, (unsigned long) header.bytes);
+	hit = true;
+
+ out:
+	if (marks)
+		eFree (marks);
+	if (cachedPath)
+		eFree (cachedPath);
+	mio_unref (mio);
+	return hit;
+}
+
+static void writeEntry (const char *const entryName, const char *const tagPath,
+						const struct tagCacheHeader *const header, MIO *const output)
+{
+	vString *tmpName = vStringNewInit (entryName);
+	unsigned char *data = mio_memory_get_data (output, NULL);
+	MIO *mio;
+	bool ok;
+
+	/* Write to another file first, so that a reader never sees
+	 * a broken entry. */
+	vStringCatS (tmpName, ".tmp");
+#ifdef HAVE_UNISTD_H
+	/* for worker processes of --jobs and other ctags processes */
+	{
+		char pid [32];
+		snprintf (pid, sizeof (pid), "%ld", (long) getpid ());
+		vStringCatS (tmpName, pid);
+	}
+#endif
+
+	mio = mio_new_file (vStringValue (tmpName), "wb");
+	if (mio == NULL)
+	{
+		error (WARNING | PERROR, "cannot write the tag cache: %s", vStringValue (tmpName));
+		vStringDelete (tmpName);
+		return;
+	}
+
+	ok = (mio_write (mio, header, sizeof (*header), 1) == 1
+		  && mio_write (mio, tagPath, 1, header->pathLength) == header->pathLength
+		  && mio_write (mio, Marks, sizeof (*Marks), MarkCount) == MarkCount
+		  && mio_write (mio, data, 1, header->outputLength) == (size_t) header->outputLength);
+	if (mio_unref (mio) != 0)
+		ok = false;
+
+	if (ok)
+	{
+		remove (entryName);
+		ok = (rename (vStringValue (tmpName), entryName) == 0);
+	}
+	if (! ok)
+	{
+		error (WARNING | PERROR, "cannot write the tag cache: %s", entryName);
+		remove (vStringValue (tmpName));
+	}
+	vStringDelete (tmpName);
+}
+
+static void recordEntry (const char *const fileName, const char *const entryName,
+						 const char *const path, const char *const tagPath,
+						 const fileStatus *const status)
+{
+	struct tagCacheHeader header;
+	unsigned long tags = numTagsAdded ();
+	long files, lines, bytes;
+	bool hashed;
+	MIO *output = mio_new_memory (NULL, 0, eRealloc, eFreeNoNullCheck);
+	MIO *tagMio;
+
+	memset (&header, 0, sizeof (header));
+	memcpy (header.magic, TAG_CACHE_MAGIC, sizeof (header.magic));
+	header.fingerprint = getFingerprint ();
+	header.size = status->size;
+	header.mtime = (int64_t) status->mtime;
+	header.pathLength = strlen (tagPath);
+	hashed = hashFileContent (path, &header.contentHash);
+
+	getTotals (&files, &lines, &bytes);
+
+	flushTagFile ();
+	tagMio = replaceTagFileMio (output);
+	Recording = true;
+	RecordingMio = output;
+	MarkCount = 0;
+
+	parseFileWithMio (fileName, NULL, NULL);
+
+	Recording = false;
+	RecordingMio = NULL;
+	replaceTagFileMio (tagMio);
+
+	header.outputLength = mio_tell (output);
+	header.markCount = MarkCount;
+	header.tags = numTagsAdded () - tags;
+	getMaxTagLengths (&header.maxTagName, &header.maxTagLine);
+	getTotals (&header.files, &header.lines, &header.bytes);
+	header.files -= files;
+	header.lines -= lines;
+	header.bytes -= bytes;
+
+	mio_seek (output, 0, SEEK_SET);
+	copyOutput (output, header.outputLength, Marks, MarkCount);
+
+	/* Don't store the output for a file changed while parsing. */
+	fileStatus *const after = eStat (path);
+	if (hashed && after->exists
+		&& after->size == status->size && after->mtime == status->mtime)
+		writeEntry (entryName, tagPath, &header, output);
+	eStatFree (after);
+
+	mio_unref (output);
+}
+
+/*  Put the tags for the input file to the tag file, using the cached
+ *  tags if the file is not changed. */
+extern bool parseFileWithTagCache (const char *const fileName)
+{
+	char *const path = absoluteFilename (fileName);
+	vString *const tagPath = makeInputFileTagPath (fileName);
+	char *const entryName = makeEntryName (vStringValue (tagPath));
+	fileStatus *status;
+	fileStatus saved;
+
+	/* eStat() keeps only the last status. Freeing it makes the next
+	 * eStat() for the file look at the file again. */
+	status = eStat (path);
+	saved = *status;
+	saved.name = NULL;
+	eStatFree (status);
+
+	if (saved.exists
+		&& replayEntry (entryName, path, vStringValue (tagPath), &saved))
+		addTagCacheTotals (1, 0);
+	else
+	{
+		recordEntry (fileName, entryName, path, vStringValue (tagPath), &saved);
+		addTagCacheTotals (0, 1);
+	}
+
+	eFree (entryName);
+	vStringDelete (tagPath);
+	eFree (path);
+
+	/* Only the output made in the end is copied. The tag file never
+	 * has to be shrunk. */
+	return false;
+}
@@ -0,0 +1,30 @@
+/*
+*   Copyright (c) 2026, Universal Ctags Team
+*
+*   This source code is released for free distribution under the terms of the
+*   GNU General Public License version 2 or (at your option) any later version.
+*
+*   main part private interface to cache.c
+*/
+#ifndef CTAGS_MAIN_CACHE_PRIVATE_H
+#define CTAGS_MAIN_CACHE_PRIVATE_H
+
+/*
+*   INCLUDE FILES
+*/
+#include "general.h"  /* must always come first */
+#include "types.h"
+
+/*
+*   FUNCTION PROTOTYPES
+*/
+extern void noteOptionForTagCache (bool longOption, const char *const option,
+								   const char *const parameter);
+
+extern bool isTagCacheEnabled (void);
+extern bool parseFileWithTagCache (const char *const fileName);
+
+extern bool isTagCacheRecording (void);
+extern void notePseudoTagsPositionInTagCache (const langType language);
+
+#endif	/* CTAGS_MAIN_CACHE_PRIVATE_H */
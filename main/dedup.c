@@ -0,0 +1,521 @@
+/*
+*   Copyright (c) 2026, Universal Ctags Team
+*
+*   This source code is released for free distribution under the terms of the
+*   GNU General Public License version 2 or (at your option) any later version.
+*
+*   This module writes the tags of an input file again for another input
+*   file with the same content, instead of running the parser for it
+*   (--dedup-inputs).
+*
+*   The key of an input file is a hash of its content, its size, its
+*   language and its base name; a few parsers make tags from the name
+*   of the input file. When a key is seen for the second time and the
+*   contents are the same, the tags written for the input file are
+*   recorded. For the input files with the key seen later, the recorded
+*   tags are written with the path of each input file. A content seen
+*   only once costs its key; the tags are kept only for the contents
+*   seen more than once.
+*
+*   The names of anonymous tags include a hash of the name of the input
+*   file (see anonGenerate ()). It is replaced with the hash of the name
+*   of the input file when the tags are written again. The tags are not
+*   recorded if the content of the input file includes the hash, for
+*   the hash in a name may not come from anonGenerate ().
+*
+*   The tags recorded are forgotten when an option is given.
+*/
+
+/*
+*   INCLUDE FILES
+*/
+#include "general.h"  /* must always come first */
+
+#include "dedup_p.h"
+
+#include <stdint.h>
+#include <string.h>
+
+#include "arena_p.h"
+#include "debug.h"
+#include "entry_p.h"
+#include "field.h"
+#include "htable.h"
+#include "options_p.h"
+#include "parse.h"
+#include "ptrarray.h"
+#include "read.h"
+#include "read_p.h"
+#include "routines.h"
+#include "stats_p.h"
+#include "vstring.h"
+#include "xtag_p.h"
+
+/*
+*   MACROS
+*/
+
+/* 64-bit FNV-1a */
+#define HASH_INIT  UINT64_C(14695981039346656037)
+#define HASH_PRIME UINT64_C(1099511628211)
+
+#define ANON_HASH_LENGTH 8
+
+/*
+*   DATA DECLARATIONS
+*/
+
+enum dedupState {
+	DEDUP_SEEN,					/* nothing is recorded yet */
+	DEDUP_RECORDED,
+	DEDUP_UNUSABLE,				/* the tags cannot be written again */
+};
+
+struct dedupTag {
+	tagEntryInfo info;			/* without the input file name */
+	langType inputLanguage;		/* the input language when it was written */
+	const char *line;			/* the input line for the tag, or NULL */
+	long seekValue;
+};
+
+struct dedupInput {
+	/* The key */
+	uint64_t hash;
+	size_t size;
+	langType language;
+	const char *baseName;
+
+	enum dedupState state;
+	const char *fileName;		/* an input file having the content */
+	char anonHash [ANON_HASH_LENGTH + 1];	/* of fileName */
+	bool hasAnonNames;
+	struct dedupTag *tags;
+	unsigned int count;
+	unsigned int allocated;
+	unsigned long lines, bytes;	/* for --totals */
+};
+
+/*
+*   DATA DEFINITIONS
+*/
+static hashTable *DedupInputs;
+static arena *DedupArena;
+
+static struct dedupInput *Recording;
+static const unsigned char *RecordingData;
+static long RecordingLines, RecordingBytes;
+
+static struct dedupInput *Replaying;
+static arena *RenamingArena;	/* cleared after writing the tags again */
+
+/*
+*   FUNCTION DEFINITIONS
+*/
+
+extern bool isInputDedupEnabled (void)
+{
+	/* The tag cache records the places of the parser specific pseudo
+	 * tags of all the parsers running for an input file. */
+	return (Option.dedupInputs
+			&& Option.cacheDir == NULL
+			&& ! Option.filter
+			&& ! Option.interactive
+			&& ! Option.printLanguage
+			&& ! Option.lineDirectives);
+}
+
+static uint64_t hashBytes (uint64_t hash, const void *const data, size_t size)
+{
+	const unsigned char *p = data;
+
+	while (size-- > 0)
+	{
+		hash ^= *p++;
+		hash *= HASH_PRIME;
+	}
+	return hash;
+}
+
+static unsigned int hashDedupInput (const void *const key)
+{
+	const struct dedupInput *d = key;
+
+	return (unsigned int) (d->hash ^ (d->hash >> 32));
+}
+
+static bool isSameDedupInput (const void *a, const void *b)
+{
+	const struct dedupInput *da = a;
+	const struct dedupInput *db = b;
+
+	return (da->hash == db->hash
+			&& da->size == db->size
+			&& da->language == db->language
+			&& strcmp (da->baseName, db->baseName) == 0);
+}
+
+static void clearDedupTags (struct dedupInput *d)
+{
+	for (unsigned int i = 0; i < d->count; i++)
+		if (d->tags [i].info.parserFieldsDynamic)
+			ptrArrayDelete (d->tags [i].info.parserFieldsDynamic);
+
+	if (d->tags)
+		eFree (d->tags);
+	d->tags = NULL;
+	d->count = 0;
+	d->allocated = 0;
+}
+
+static void deleteDedupInput (void *ptr)
+{
+	/* The rest is in the arena. */
+	clearDedupTags (ptr);
+}
+
+extern void forgetDedupedInputs (void)
+{
+	Recording = NULL;
+	Replaying = NULL;
+
+	if (DedupInputs)
+	{
+		hashTableDelete (DedupInputs);
+		DedupInputs = NULL;
+	}
+	if (DedupArena)
+	{
+		arenaDelete (DedupArena);
+		DedupArena = NULL;
+	}
+	if (RenamingArena)
+	{
+		arenaDelete (RenamingArena);
+		RenamingArena = NULL;
+	}
+}
+
+static bool hasSameContent (const char *const fileName,
+							const unsigned char *const data, size_t size)
+{
+	MIO *mio = mio_new_mmap (fileName);
+	unsigned char *other;
+	size_t otherSize;
+	bool r;
+
+	if (mio == NULL)
+		return false;
+
+	other = mio_memory_get_data (mio, &otherSize);
+	r = (other && otherSize == size && memcmp (other, data, size) == 0);
+
+	mio_unref (mio);
+	return r;
+}
+
+static bool containsString (const unsigned char *data, size_t size,
+							const char *const str)
+{
+	const size_t length = strlen (str);
+	const unsigned char *p;
+
+	while (size >= length
+		   && (p = memchr (data, str [0], size - length + 1)) != NULL)
+	{
+		if (memcmp (p, str, length) == 0)
+			return true;
+		size -= p + 1 - data;
+		data = p + 1;
+	}
+	return false;
+}
+
+static void startDedupRecording (struct dedupInput *d, const char *const fileName,
+								 const unsigned char *const data)
+{
+	long files;
+
+	d->fileName = arenaStrdup (DedupArena, fileName);
+	d->baseName = baseFilename (d->fileName);
+	anonHashString (d->fileName, d->anonHash);
+	d->hasAnonNames = false;
+
+	Recording = d;
+	RecordingData = data;
+	getTotals (&files, &RecordingLines, &RecordingBytes);
+}
+
+extern bool lookupDedupedInput (const char *const fileName, const langType language,
+								MIO *mio)
+{
+	struct dedupInput key, *d;
+	unsigned char *data;
+	size_t size;
+
+	Replaying = NULL;
+
+	/* Only a mapped or in-memory input has the content at hand. */
+	data = mio? mio_memory_get_data (mio, &size): NULL;
+	if (data == NULL || size == 0)
+		return false;
+
+	memset (&key, 0, sizeof (key));
+	key.hash = hashBytes (HASH_INIT, data, size);
+	key.size = size;
+	key.language = language;
+	key.baseName = baseFilename (fileName);
+
+	if (DedupInputs == NULL)
+	{
+		DedupInputs = hashTableGrowableNew (256, hashDedupInput, isSameDedupInput,
+											NULL, deleteDedupInput);
+		DedupArena = arenaNew ();
+	}
+
+	d = hashTableGetItem (DedupInputs, &key);
+	if (d == NULL)
+	{
+		d = arenaCalloc (DedupArena, 1, sizeof (*d));
+		*d = key;
+		d->state = DEDUP_SEEN;
+		d->fileName = arenaStrdup (DedupArena, fileName);
+		d->baseName = baseFilename (d->fileName);
+		hashTablePutItem (DedupInputs, d, d);
+	}
+	else if (d->state != DEDUP_UNUSABLE
+			 && hasSameContent (d->fileName, data, size))
+	{
+		if (d->state == DEDUP_RECORDED)
+		{
+			Replaying = d;
+			addDedupTotals (1, 0);
+			return true;
+		}
+		startDedupRecording (d, fileName, data);
+	}
+
+	addDedupTotals (0, 1);
+	return false;
+}
+
+extern bool isDedupRecording (void)
+{
+	return Recording != NULL;
+}
+
+static const char *recordString (const char *const str)
+{
+	if (str == NULL)
+		return NULL;
+
+	if (strstr (str, Recording->anonHash))
+		Recording->hasAnonNames = true;
+	return arenaStrdup (DedupArena, str);
+}
+
+static void recordParserFields (const tagEntryInfo *const tag, tagEntryInfo *const slot)
+{
+	slot->parserFieldsDynamic = NULL;
+
+	for (unsigned int i = 0; i < tag->usedParserFields; i++)
+	{
+		const tagField *f = getParserFieldForIndex (tag, i);
+
+		if (i < PRE_ALLOCATED_PARSER_FIELDS)
+		{
+			slot->parserFields [i].value = recordString (f->value);
+			slot->parserFields [i].valueOwner = false;
+		}
+		else
+		{
+			tagField *g = arenaAlloc (DedupArena, sizeof (tagField));
+
+			g->ftype = f->ftype;
+			g->value = recordString (f->value);
+			g->valueOwner = false;
+			if (slot->parserFieldsDynamic == NULL)
+				slot->parserFieldsDynamic = ptrArrayNew (NULL);
+			ptrArrayAdd (slot->parserFieldsDynamic, g);
+		}
+	}
+}
+
+extern void recordTagForDedup (tagEntryInfo *const tag)
+{
+	static vString *line;
+	struct dedupInput *d = Recording;
+	struct dedupTag *t;
+	tagEntryInfo *slot;
+
+	/* The scope is resolved with the cork queue, which is gone when the
+	 * tag is written again. */
+	getTagScopeInformation (tag, NULL, NULL);
+
+	if (d->count == d->allocated)
+	{
+		d->allocated = d->allocated? d->allocated * 2: 64;
+		d->tags = xRealloc (d->tags, d->allocated, struct dedupTag);
+	}
+	t = d->tags + d->count++;
+	slot = &t->info;
+
+	*slot = *tag;
+	slot->pattern = recordString (tag->pattern);
+	slot->inputFileName = NULL;
+	slot->name = recordString (tag->name);
+	slot->extensionFields.access = recordString (tag->extensionFields.access);
+	slot->extensionFields.implementation = recordString (tag->extensionFields.implementation);
+	slot->extensionFields.inheritance = recordString (tag->extensionFields.inheritance);
+	slot->extensionFields.scopeName = recordString (tag->extensionFields.scopeName);
+	slot->extensionFields.scopeIndex = CORK_NIL;
+	slot->extensionFields.signature = recordString (tag->extensionFields.signature);
+	slot->extensionFields.typeRef [0] = recordString (tag->extensionFields.typeRef [0]);
+	slot->extensionFields.typeRef [1] = recordString (tag->extensionFields.typeRef [1]);
+#ifdef HAVE_LIBXML
+	slot->extensionFields.xpath = recordString (tag->extensionFields.xpath);
+#endif
+	if (tag->extraDynamic)
+	{
+		int n = countXtags () - XTAG_COUNT;
+		slot->extraDynamic = arenaAlloc (DedupArena, (n / 8) + 1);
+		memcpy (slot->extraDynamic, tag->extraDynamic, (n / 8) + 1);
+	}
+	slot->sourceFileName = NULL;
+	recordParserFields (tag, slot);
+
+	t->inputLanguage = getInputLanguage ();
+
+	/* A writer reads the input line for a tag without a pattern. */
+	t->line = NULL;
+	t->seekValue = 0;
+	if (tag->pattern == NULL)
+	{
+		line = vStringNewOrClearWithAutoRelease (line);
+		if (readLineFromBypass (line, tag->filePosition, &t->seekValue))
+			t->line = arenaStrdup (DedupArena, vStringValue (line));
+	}
+}
+
+extern void endDedupRecording (bool tagFileResized)
+{
+	struct dedupInput *d = Recording;
+	long files, lines, bytes;
+
+	if (d == NULL)
+		return;
+	Recording = NULL;
+
+	/* The tag file is resized when a parser fails and runs again; some
+	 * of the tags recorded are not in the tag file. */
+	if (tagFileResized
+		|| (d->hasAnonNames && containsString (RecordingData, d->size, d->anonHash)))
+	{
+		clearDedupTags (d);
+		d->state = DEDUP_UNUSABLE;
+		return;
+	}
+
+	getTotals (&files, &lines, &bytes);
+	d->lines = lines - RecordingLines;
+	d->bytes = bytes - RecordingBytes;
+	d->state = DEDUP_RECORDED;
+}
+
+static const char *renameAnonymous (const char *const str,
+									const char *const from, const char *const to)
+{
+	char *renamed, *p;
+
+	if (str == NULL || strstr (str, from) == NULL)
+		return str;
+
+	renamed = arenaStrdup (RenamingArena, str);
+	for (p = strstr (renamed, from); p; p = strstr (p + ANON_HASH_LENGTH, from))
+		memcpy (p, to, ANON_HASH_LENGTH);
+	return renamed;
+}
+
+static void renameAnonymousNames (tagEntryInfo *const e,
+								  const char *const from, const char *const to)
+{
+	e->name = renameAnonymous (e->name, from, to);
+	e->extensionFields.access = renameAnonymous (e->extensionFields.access, from, to);
+	e->extensionFields.implementation = renameAnonymous (e->extensionFields.implementation, from, to);
+	e->extensionFields.inheritance = renameAnonymous (e->extensionFields.inheritance, from, to);
+	e->extensionFields.scopeName = renameAnonymous (e->extensionFields.scopeName, from, to);
+	e->extensionFields.signature = renameAnonymous (e->extensionFields.signature, from, to);
+	e->extensionFields.typeRef [0] = renameAnonymous (e->extensionFields.typeRef [0], from, to);
+	e->extensionFields.typeRef [1] = renameAnonymous (e->extensionFields.typeRef [1], from, to);
+#ifdef HAVE_LIBXML
+	e->extensionFields.xpath = renameAnonymous (e->extensionFields.xpath, from, to);
+#endif
+
+	for (unsigned int i = 0; i < e->usedParserFields && i < PRE_ALLOCATED_PARSER_FIELDS; i++)
+		e->parserFields [i].value = renameAnonymous (e->parserFields [i].value, from, to);
+
+	if (e->parserFieldsDynamic)
+	{
+		ptrArray *fields = ptrArrayNew (NULL);
+
+		for (unsigned int i = 0; i < ptrArrayCount (e->parserFieldsDynamic); i++)
+		{
+			tagField *g = arenaAlloc (RenamingArena, sizeof (tagField));
+
+			*g = *(tagField *) ptrArrayItem (e->parserFieldsDynamic, i);
+			g->value = renameAnonymous (g->value, from, to);
+			ptrArrayAdd (fields, g);
+		}
+		e->parserFieldsDynamic = fields;
+	}
+}
+
+extern void replayDedupedTags (const char *const fileName, const char *const tagPath,
+							   time_t mtime)
+{
+	struct dedupInput *d = Replaying;
+	char anonHash [ANON_HASH_LENGTH + 1];
+	bool renaming = false;
+	statsPhase phase;
+
+	Assert (d && d->state == DEDUP_RECORDED);
+	Replaying = NULL;
+
+	if (d->hasAnonNames)
+	{
+		anonHashString (fileName, anonHash);
+		renaming = (strcmp (anonHash, d->anonHash) != 0);
+		if (renaming && RenamingArena == NULL)
+			RenamingArena = arenaNew ();
+	}
+
+	phase = switchPhase (PHASE_WRITING);
+
+	for (unsigned int i = 0; i < d->count; i++)
+	{
+		const struct dedupTag *t = d->tags + i;
+		tagEntryInfo e = t->info;
+
+		e.inputFileName = tagPath;
+		e.sourceFileName = tagPath;
+		if (e.isFileEntry && isFieldEnabled (FIELD_EPOCH))
+			e.extensionFields.epoch = mtime;
+		if (renaming)
+			renameAnonymousNames (&e, d->anonHash, anonHash);
+
+		/* The pattern cache is keyed by the position of the input line,
+		 * which is not unique among the narrowed input streams for guest
+		 * parsers. */
+		invalidatePatternCache ();
+		pushLanguage (t->inputLanguage);
+		writeReplayedTagEntry (&e, t->line, t->seekValue);
+		popLanguage ();
+
+		if (renaming && e.parserFieldsDynamic)
+			ptrArrayDelete (e.parserFieldsDynamic);
+	}
+	if (renaming)
+		arenaClear (RenamingArena);
+
+	addTotals (0, d->lines, d->bytes);
+	switchPhase (phase);
+}
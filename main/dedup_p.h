@@ -0,0 +1,44 @@
+/*
+*   Copyright (c) 2026, Universal Ctags Team
+*
+*   This source code is released for free distribution under the terms of the
+*   GNU General Public License version 2 or (at your option) any later version.
+*
+*   main part private interface to dedup.c
+*/
+#ifndef CTAGS_MAIN_DEDUP_PRIVATE_H
+#define CTAGS_MAIN_DEDUP_PRIVATE_H
+
+/*
+*   INCLUDE FILES
+*/
+#include "general.h"  /* must always come first */
+
+#include <time.h>
+
+#include "entry.h"
+#include "mio.h"
+#include "types.h"
+
+/*
+*   FUNCTION PROTOTYPES
+*/
+extern bool isInputDedupEnabled (void);
+
+/* Return true if the tags of an input file with the same content have
+ * been recorded; replayDedupedTags () writes them for FILENAME.
+ * Otherwise the tags written for FILENAME may be recorded until
+ * endDedupRecording () is called. */
+extern bool lookupDedupedInput (const char *const fileName, const langType language,
+								MIO *mio);
+extern void replayDedupedTags (const char *const fileName, const char *const tagPath,
+							   time_t mtime);
+
+extern bool isDedupRecording (void);
+extern void recordTagForDedup (tagEntryInfo *const tag);
+extern void endDedupRecording (bool tagFileResized);
+
+/* The tags recorded may not be the ones made with new options. */
+extern void forgetDedupedInputs (void);
+
+#endif	/* CTAGS_MAIN_DEDUP_PRIVATE_H */
@@ -245,6 +245,7 @@ extern subparser* teardownSubparsersInUse (struct slaveControlBlock *controlBloc
 	if (tmp && tmp->schedulingBaseparserExplicitly)
 	{
 		tmp->schedulingBaseparserExplicitly = false;
+		tmp->chosenAsExclusiveSubparser = false;
 		s = tmp;
 	}
 
@@ -255,6 +256,8 @@ extern subparser* teardownSubparsersInUse (struct slaveControlBlock *controlBloc
 	{
 		if (tmp->chosenAsExclusiveSubparser)
 		{
+			/* Choose it again for the next input file. */
+			tmp->chosenAsExclusiveSubparser = false;
 			s = tmp;
 		}
 		tmp = tmp->next;
@@ -0,0 +1,402 @@
+/*
+*   Copyright (c) 2026, Universal Ctags Team
+*
+*   This source code is released for free distribution under the terms of the
+*   GNU General Public License version 2 or (at your option) any later version.
+*
+*   This module reads directories for --recurse.
+*
+*   The status of each entry of a directory is taken with fstatat(2)
+*   relative to the directory, instead of stat(2) with the whole path.
+*   For a directory entry, d_type tells enough, and no status is taken.
+*   The main thread passes the status of an entry to eStat() with
+*   setFileStatusHint(), so that making tags for the entry takes no
+*   other status of it.
+*
+*   While the main thread makes tags for the files in a directory,
+*   threads read the subdirectories of it in advance. The main thread
+*   still visits the entries in the order readdir(3) returns them; the
+*   threads change only when the directories are read. The tag file is
+*   the same as the one made without them.
+*
+*   The threads call neither error() nor the allocation functions of
+*   routines.c, which are not thread-safe. An error is kept in the
+*   listing, and reported by the main thread.
+*/
+
+/*
+*   INCLUDE FILES
+*/
+#include "general.h"  /* must always come first */
+
+#include "dirscan_p.h"
+
+#ifdef DIRSCAN_SUPPORTED
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef HAVE_UNISTD_H
+# include <unistd.h>
+#endif
+#ifdef HAVE_SYS_TYPES_H
+# include <sys/types.h>
+#endif
+#include <dirent.h>
+#if defined (HAVE_PTHREAD) && defined (HAVE_PTHREAD_H)
+# include <pthread.h>
+# define DIRSCAN_THREADS
+#endif
+
+#include "error_p.h"
+#include "htable.h"
+#include "routines.h"
+
+/*
+*   MACROS
+*/
+#define DIRSCAN_MAX_THREADS 8
+/* The directories read in advance but not taken yet are limited to
+ * this number. */
+#define DIRSCAN_MAX_PREFETCHED 1024
+
+/*
+*   DATA DECLARATIONS
+*/
+#ifdef DIRSCAN_THREADS
+enum scanState {
+	SCAN_PENDING,
+	SCAN_RUNNING,
+	SCAN_DONE,
+};
+
+struct scanRequest {
+	char *path;
+	enum scanState state;
+	bool abandoned;				/* taken by the main thread while pending */
+	dirListing *listing;
+	struct scanRequest *next;	/* in the queue */
+};
+#endif
+
+/*
+*   DATA DEFINITIONS
+*/
+#ifdef DIRSCAN_THREADS
+/* Used only by the main thread */
+static hashTable *ScanRequests;	/* path -> struct scanRequest */
+static unsigned int ScanPrefetched;
+static pthread_t ScanThreads [DIRSCAN_MAX_THREADS];
+static unsigned int ScanThreadCount;
+
+/* Guarded by ScanMutex */
+static pthread_mutex_t ScanMutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t ScanQueued = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t ScanDone = PTHREAD_COND_INITIALIZER;
+static struct scanRequest *ScanQueueHead, *ScanQueueTail;
+static bool ScanStopping;
+#endif
+
+/*
+*   FUNCTION DEFINITIONS
+*/
+
+/*  Join DIR and NAME as combinePathAndFile() does. */
+static char *joinPath (const char *const dir, const char *const name)
+{
+	const size_t dirLength = strlen (dir);
+	const size_t nameLength = strlen (name);
+	char *const path = malloc (dirLength + nameLength + 2);
+	char *p = path;
+
+	if (path == NULL)
+		return NULL;
+
+	if (strcmp (dir, ".") != 0 && dirLength > 0)
+	{
+		memcpy (p, dir, dirLength);
+		p += dirLength;
+		if (dir [dirLength - 1] != PATH_SEPARATOR
+			&& dir [dirLength - 1] != OUTPUT_PATH_SEPARATOR)
+			*p++ = OUTPUT_PATH_SEPARATOR;
+	}
+	memcpy (p, name, nameLength + 1);
+
+	return path;
+}
+
+extern void freeDirListing (dirListing *listing)
+{
+	for (unsigned int i = 0; i < listing->count; i++)
+		free (listing->entries [i].name);
+	free (listing->entries);
+	free (listing);
+}
+
+/*  Read the directory at PATH. Return NULL if memory runs out. This
+ *  function is thread-safe. */
+static dirListing *scanDirectory (const char *const path)
+{
+	dirListing *const listing = calloc (1, sizeof (dirListing));
+	unsigned int allocated = 0;
+	struct dirent *entry;
+	DIR *dir;
+
+	if (listing == NULL)
+		return NULL;
+
+	dir = opendir (path);
+	if (dir == NULL)
+	{
+		listing->error = errno;
+		return listing;
+	}
+
+	while ((entry = readdir (dir)) != NULL)
+	{
+		fileStatus *status;
+
+		if (strcmp (entry->d_name, ".") == 0  ||
+			strcmp (entry->d_name, "..") == 0)
+			continue;
+
+		if (listing->count == allocated)
+		{
+			const unsigned int n = allocated? allocated * 2: 16;
+			fileStatus *const entries = realloc (listing->entries,
+												 n * sizeof (fileStatus));
+			if (entries == NULL)
+				goto failed;
+			listing->entries = entries;
+			allocated = n;
+		}
+
+		status = listing->entries + listing->count;
+		memset (status, 0, sizeof (*status));
+		status->name = joinPath (path, entry->d_name);
+		if (status->name == NULL)
+			goto failed;
+		listing->count++;
+
+#ifdef HAVE_STRUCT_DIRENT_D_TYPE
+		if (entry->d_type == DT_DIR)
+		{
+			status->exists = true;
+			status->isDirectory = true;
+			continue;
+		}
+#endif
+		statFileAt (dirfd (dir), entry->d_name, status);
+	}
+
+	closedir (dir);
+	return listing;
+
+failed:
+	closedir (dir);
+	freeDirListing (listing);
+	return NULL;
+}
+
+#ifdef DIRSCAN_THREADS
+static void *runScanThread (void *data CTAGS_ATTR_UNUSED)
+{
+	pthread_mutex_lock (&ScanMutex);
+	while (true)
+	{
+		struct scanRequest *req;
+		dirListing *listing;
+
+		while (ScanQueueHead == NULL && ! ScanStopping)
+			pthread_cond_wait (&ScanQueued, &ScanMutex);
+		if (ScanStopping)
+			break;
+
+		req = ScanQueueHead;
+		ScanQueueHead = req->next;
+		if (ScanQueueHead == NULL)
+			ScanQueueTail = NULL;
+
+		if (req->abandoned)
+		{
+			free (req->path);
+			free (req);
+			continue;
+		}
+
+		req->state = SCAN_RUNNING;
+		pthread_mutex_unlock (&ScanMutex);
+		listing = scanDirectory (req->path);
+		pthread_mutex_lock (&ScanMutex);
+		req->listing = listing;
+		req->state = SCAN_DONE;
+		pthread_cond_broadcast (&ScanDone);
+	}
+	pthread_mutex_unlock (&ScanMutex);
+
+	return NULL;
+}
+
+static unsigned int getScanThreadCount (void)
+{
+#ifdef _SC_NPROCESSORS_ONLN
+	long n = sysconf (_SC_NPROCESSORS_ONLN);
+
+	/* Reading a directory mostly waits for the file system. Even a
+	 * single processor can have a thread waiting for it. */
+	if (n < 2)
+		return 2;
+	else if (n > DIRSCAN_MAX_THREADS)
+		return DIRSCAN_MAX_THREADS;
+	return (unsigned int) n;
+#else
+	return 2;
+#endif
+}
+#endif
+
+extern void startDirScanThreads (void)
+{
+#ifdef DIRSCAN_THREADS
+	const unsigned int count = getScanThreadCount ();
+
+	ScanRequests = hashTableNew (64, hashCstrhash, hashCstreq, NULL, NULL);
+	ScanPrefetched = 0;
+	ScanStopping = false;
+
+	for (ScanThreadCount = 0; ScanThreadCount < count; ScanThreadCount++)
+		if (pthread_create (ScanThreads + ScanThreadCount, NULL,
+							runScanThread, NULL) != 0)
+			break;
+#endif
+}
+
+#ifdef DIRSCAN_THREADS
+static bool freeScanRequest (const void *key CTAGS_ATTR_UNUSED, void *value,
+							 void *user_data CTAGS_ATTR_UNUSED)
+{
+	struct scanRequest *req = value;
+
+	if (req->listing)
+		freeDirListing (req->listing);
+	free (req->path);
+	free (req);
+	return true;
+}
+#endif
+
+extern void stopDirScanThreads (void)
+{
+#ifdef DIRSCAN_THREADS
+	struct scanRequest *req, *next;
+
+	pthread_mutex_lock (&ScanMutex);
+	ScanStopping = true;
+	pthread_cond_broadcast (&ScanQueued);
+	pthread_mutex_unlock (&ScanMutex);
+
+	for (unsigned int i = 0; i < ScanThreadCount; i++)
+		pthread_join (ScanThreads [i], NULL);
+	ScanThreadCount = 0;
+
+	/* The requests left in the queue are pending. The other requests
+	 * not taken are done. */
+	for (req = ScanQueueHead; req; req = next)
+	{
+		next = req->next;
+		if (! req->abandoned)
+			hashTableDeleteItem (ScanRequests, req->path);
+		free (req->path);
+		free (req);
+	}
+	ScanQueueHead = ScanQueueTail = NULL;
+
+	hashTableForeachItem (ScanRequests, freeScanRequest, NULL);
+	hashTableDelete (ScanRequests);
+	ScanRequests = NULL;
+#endif
+}
+
+extern void prefetchDirListing (const char *const path)
+{
+#ifdef DIRSCAN_THREADS
+	struct scanRequest *req;
+
+	if (ScanThreadCount == 0
+		|| ScanPrefetched >= DIRSCAN_MAX_PREFETCHED
+		|| hashTableHasItem (ScanRequests, path))
+		return;
+
+	req = malloc (sizeof (*req));
+	if (req == NULL)
+		return;
+	req->path = strdup (path);
+	if (req->path == NULL)
+	{
+		free (req);
+		return;
+	}
+	req->state = SCAN_PENDING;
+	req->abandoned = false;
+	req->listing = NULL;
+	req->next = NULL;
+
+	hashTablePutItem (ScanRequests, req->path, req);
+	ScanPrefetched++;
+
+	pthread_mutex_lock (&ScanMutex);
+	if (ScanQueueTail)
+		ScanQueueTail->next = req;
+	else
+		ScanQueueHead = req;
+	ScanQueueTail = req;
+	pthread_cond_signal (&ScanQueued);
+	pthread_mutex_unlock (&ScanMutex);
+#endif
+}
+
+extern dirListing *getDirListing (const char *const path)
+{
+	dirListing *listing = NULL;
+
+#ifdef DIRSCAN_THREADS
+	struct scanRequest *req = ScanRequests? hashTableGetItem (ScanRequests, path): NULL;
+
+	if (req)
+	{
+		bool abandoned;
+
+		hashTableDeleteItem (ScanRequests, path);
+		ScanPrefetched--;
+
+		pthread_mutex_lock (&ScanMutex);
+		/* Reading the directory here is faster than waiting for a
+		 * thread to start reading it. */
+		if (req->state == SCAN_PENDING)
+			req->abandoned = true;
+		else
+		{
+			while (req->state != SCAN_DONE)
+				pthread_cond_wait (&ScanDone, &ScanMutex);
+			listing = req->listing;
+		}
+		abandoned = req->abandoned;
+		pthread_mutex_unlock (&ScanMutex);
+
+		/* An abandoned request is freed by a thread taking it from the
+		 * queue. */
+		if (! abandoned)
+		{
+			free (req->path);
+			free (req);
+		}
+	}
+#endif
+
+	if (listing == NULL)
+		listing = scanDirectory (path);
+	if (listing == NULL)
+		error (FATAL, "out of memory");
+
+	return listing;
+}
+#endif
@@ -0,0 +1,52 @@
+/*
+*   Copyright (c) 2026, Universal Ctags Team
+*
+*   This source code is released for free distribution under the terms of the
+*   GNU General Public License version 2 or (at your option) any later version.
+*
+*   main part private interface to dirscan.c
+*/
+#ifndef CTAGS_MAIN_DIRSCAN_PRIVATE_H
+#define CTAGS_MAIN_DIRSCAN_PRIVATE_H
+
+/*
+*   INCLUDE FILES
+*/
+#include "general.h"  /* must always come first */
+
+#include "routines_p.h"
+
+/*
+*   MACROS
+*/
+#if defined (HAVE_OPENDIR) && defined (HAVE_DIRENT_H) \
+	&& defined (HAVE_DIRFD) && defined (HAVE_FSTATAT)
+# define DIRSCAN_SUPPORTED
+#endif
+
+/*
+*   DATA DECLARATIONS
+*/
+
+/* The entries of a directory in the order readdir(3) returns them */
+typedef struct sDirListing {
+	int error;					/* errno of opening the directory, or 0 */
+	unsigned int count;
+	fileStatus *entries;		/* the name of an entry is its path */
+} dirListing;
+
+/*
+*   FUNCTION PROTOTYPES
+*/
+#ifdef DIRSCAN_SUPPORTED
+extern void startDirScanThreads (void);
+extern void stopDirScanThreads (void);
+
+/* Let a thread read the directory at PATH, which getDirListing() will
+ * be called for soon. */
+extern void prefetchDirListing (const char *const path);
+extern dirListing *getDirListing (const char *const path);
+extern void freeDirListing (dirListing *listing);
+#endif
+
+#endif	/* CTAGS_MAIN_DIRSCAN_PRIVATE_H */
@@ -39,10 +39,14 @@
 #include <stdint.h>
 #include <limits.h>  /* to define INT_MAX */
 
+#include "arena_p.h"
 #include "debug.h"
+#include "dedup_p.h"
 #include "entry_p.h"
 #include "field.h"
 #include "fmt_p.h"
+#include "htable.h"
+#include "intern_p.h"
 #include "kind.h"
 #include "nestlevel.h"
 #include "options_p.h"
@@ -55,8 +59,11 @@
 #include "parse_p.h"
 #include "ptrarray.h"
 #include "sort_p.h"
+#include "stats_p.h"
 #include "strlist.h"
 #include "subparser_p.h"
+#include "tagindex_p.h"
+#include "traceevent_p.h"
 #include "trashbox.h"
 #include "writer_p.h"
 #include "xtag_p.h"
@@ -95,8 +102,20 @@ typedef struct eTagFile {
 	int cork;
 	unsigned int corkFlags;
 	ptrArray *corkQueue;
+	arena *corkArena;			/* the memory for the entries in corkQueue */
 
 	bool patternCacheValid;
+
+	/* The tag lines kept in memory for stdout; NULL if the tag lines
+	 * for stdout go to a temporary file. */
+	MIO *stdoutMio;
+
+	/* for --update */
+	struct sUpdate {
+		hashTable *inputs;	/* the input fields of the files tagged again */
+		long offset;		/* the end of the old tags */
+		int sorted;			/* the old value of !_TAG_FILE_SORTED */
+	} update;
 } tagFile;
 
 typedef struct sTagEntryInfoX  {
@@ -119,11 +138,21 @@ static tagFile TagFile = {
     NULL,                /* vLine */
     .cork = false,
     .corkQueue = NULL,
+    .corkArena = NULL,
     .patternCacheValid = false,
+    .stdoutMio = NULL,
+    .update = { NULL, 0, -1 },
 };
 
 static bool TagsToStdout = false;
 
+/* The input line of the tag written by writeReplayedTagEntry () */
+static struct {
+	bool active;
+	const char *line;
+	long seekValue;
+} ReplayedLine;
+
 /*
 *   FUNCTION PROTOTYPES
 */
@@ -144,6 +173,10 @@ extern void freeTagFileResources (void)
 	if (TagFile.directory != NULL)
 		eFree (TagFile.directory);
 	vStringDelete (TagFile.vLine);
+	if (TagFile.update.inputs != NULL)
+		hashTableDelete (TagFile.update.inputs);
+	if (TagFile.corkArena != NULL)
+		arenaDelete (TagFile.corkArena);
 }
 
 extern const char *tagFileName (void)
@@ -276,7 +309,12 @@ static long unsigned int updatePseudoTags (MIO *const mio)
 				tab == '\t')
 			{
 				if (strcmp (classType, "_SORTED") == 0)
+				{
+					const char *const flag = strchr (line, '\t') + 1;
+					if (flag [0] >= '0'  &&  flag [0] <= '2')
+						TagFile.update.sorted = flag [0] - '0';
 					updateSortedFlag (line, mio, startOfLine);
+				}
 			}
 			mio_getpos (mio, &startOfLine);
 		}
@@ -391,13 +429,21 @@ extern void openTagFile (void)
 	 */
 	if (TagsToStdout)
 	{
-		if (Option.interactive == INTERACTIVE_SANDBOX)
+#ifdef EXTERNAL_SORT
+		/* The sort command reads the tag lines from a file. */
+		if (Option.sorted != SO_UNSORTED
+			&& Option.interactive != INTERACTIVE_SANDBOX)
+			TagFile.mio = tempFile ("w+", &TagFile.name);
+		else
+#endif
 		{
+			/* The tag lines are sorted in memory, and written to stdout
+			 * at once. Unsorted ones are written after each input file;
+			 * see streamTagFile (). */
 			TagFile.mio = mio_new_memory (NULL, 0, eRealloc, eFreeNoNullCheck);
 			TagFile.name = NULL;
+			TagFile.stdoutMio = TagFile.mio;
 		}
-		else
-			TagFile.mio = tempFile ("w+", &TagFile.name);
 		if (isXtagEnabled (XTAG_PSEUDO_TAGS))
 			addCommonPseudoTags ();
 	}
@@ -421,12 +467,15 @@ extern void openTagFile (void)
 		}
 		else
 		{
-			if (Option.append  &&  fileExists)
+			if ((Option.append || Option.update)  &&  fileExists)
 			{
 				TagFile.mio = mio_new_file (TagFile.name, "r+");
 				if (TagFile.mio != NULL)
 				{
+					TagFile.update.sorted = -1;
 					TagFile.numTags.prev = updatePseudoTags (TagFile.mio);
+					if (Option.update)
+						TagFile.update.offset = mio_tell (TagFile.mio);
 					mio_unref (TagFile.mio);
 					TagFile.mio = mio_new_file (TagFile.name, "a+");
 				}
@@ -451,8 +500,6 @@ extern void openTagFile (void)
 	}
 }
 
-#ifdef USE_REPLACEMENT_TRUNCATE
-
 static void copyBytes (MIO* const fromMio, MIO* const toMio, const long size)
 {
 	enum { BufferSize = 1000 };
@@ -472,6 +519,8 @@ static void copyBytes (MIO* const fromMio, MIO* const toMio, const long size)
 	eFree (buffer);
 }
 
+#ifdef USE_REPLACEMENT_TRUNCATE
+
 static void copyFile (const char *const from, const char *const to, const long size)
 {
 	MIO* const fromMio = mio_new_file (from, "rb");
@@ -528,15 +577,66 @@ static void internalSortTagFile (void)
 			failedSort (mio, NULL);
 	}
 
-	internalSortTags (TagsToStdout,
-			  mio,
-			  TagFile.numTags.added + TagFile.numTags.prev);
+	internalSortTags (TagsToStdout, mio, NULL);
 
 	if (! TagsToStdout)
 		mio_unref (mio);
 }
 #endif
 
+/*  Write the first SIZE bytes of the tag lines kept in memory to stdout,
+ *  sorting them if needed.
+ */
+static void writeTagLinesToStdout (const long size)
+{
+	size_t length;
+	char *data = (char *) mio_memory_get_data (TagFile.stdoutMio, &length);
+
+	if (size < (long) length)
+		length = (size_t) size;
+	if (length == 0)
+		return;
+
+#ifndef EXTERNAL_SORT
+	if (Option.sorted != SO_UNSORTED)
+	{
+		verbose ("sorting tag file\n");
+		statsPhase phase = switchPhase (PHASE_SORTING);
+		if (TraceEventsEnabled)
+			traceEventBegin ("sort", NULL, NULL);
+		internalSortTagsInMemory (data, length);
+		if (TraceEventsEnabled)
+			traceEventEnd ("sort");
+		switchPhase (phase);
+		return;
+	}
+#endif
+	if (fwrite (data, 1, length, stdout) != length
+		|| fflush (stdout) != 0)
+		error (FATAL | PERROR, "cannot write tags to stdout");
+}
+
+/*  Write the unsorted tag lines made so far to stdout, and reuse the
+ *  memory for the tag lines of the next input files. Nothing is written
+ *  until the first tag is made, as closeTagFile () writes nothing if no
+ *  tag is made.
+ */
+extern void streamTagFile (void)
+{
+	if (TagFile.stdoutMio == NULL
+		|| TagFile.mio != TagFile.stdoutMio	/* in a worker process, or caching */
+		|| Option.sorted != SO_UNSORTED
+		|| Option.interactive
+		|| TagFile.numTags.added == 0)
+		return;
+
+	/* Bytes left after the position by a rescan are garbage. */
+	statsPhase phase = switchPhase (PHASE_WRITING);
+	writeTagLinesToStdout (mio_tell (TagFile.mio));
+	mio_seek (TagFile.mio, 0L, SEEK_SET);
+	switchPhase (phase);
+}
+
 static void sortTagFile (void)
 {
 	if (TagFile.numTags.added > 0L)
@@ -544,17 +644,142 @@ static void sortTagFile (void)
 		if (Option.sorted != SO_UNSORTED)
 		{
 			verbose ("sorting tag file\n");
+			statsPhase phase = switchPhase (PHASE_SORTING);
+			if (TraceEventsEnabled)
+				traceEventBegin ("sort", NULL, NULL);
 #ifdef EXTERNAL_SORT
 			externalSortTags (TagsToStdout, TagFile.mio);
 #else
 			internalSortTagFile ();
 #endif
+			if (TraceEventsEnabled)
+				traceEventEnd ("sort");
+			switchPhase (phase);
 		}
 		else if (TagsToStdout)
 			catFile (TagFile.mio);
 	}
 }
 
+/*
+ *  Incremental update (--update)
+ */
+
+extern void noteInputFileForUpdate (const char *const fileName)
+{
+	if (TagFile.update.inputs == NULL)
+		TagFile.update.inputs = hashTableGrowableNew (128, hashCstrhash, hashCstreq,
+													  eFree, NULL);
+	vString *const tagPath = makeInputFileTagPath (fileName);
+	char *const input = vStringDeleteUnwrap (tagPath);
+
+	if (hashTableHasItem (TagFile.update.inputs, input))
+		eFree (input);
+	else
+		hashTablePutItem (TagFile.update.inputs, input, input);
+}
+
+/*  Does the line hold a tag made from one of the input files tagged
+ *  again?  Pseudo tags are always kept.
+ */
+static bool isStaleTagLine (const char *const line, vString *const input)
+{
+	const char *tab1, *tab2;
+
+	if (TagFile.update.inputs == NULL
+		|| strncmp (line, PSEUDO_TAG_PREFIX, strlen (PSEUDO_TAG_PREFIX)) == 0)
+		return false;
+
+	tab1 = strchr (line, '\t');
+	if (tab1 == NULL)
+		return false;
+	tab2 = strchr (tab1 + 1, '\t');
+	if (tab2 == NULL)
+		return false;
+
+	vStringNCopyS (input, tab1 + 1, tab2 - tab1 - 1);
+	return hashTableHasItem (TagFile.update.inputs, vStringValue (input));
+}
+
+/*  Copy the old tags from mio to dest, dropping the stale ones.
+ *  Returns the number of dropped lines.
+ */
+static unsigned long copyOldTags (MIO *const mio, MIO *const dest)
+{
+	vString *const input = vStringNew ();
+	unsigned long dropped = 0;
+
+	while (mio_tell (mio) < TagFile.update.offset)
+	{
+		const char *const line = readLineRaw (TagFile.vLine, mio);
+
+		if (line == NULL)
+			break;
+		else if (isStaleTagLine (line, input))
+			dropped++;
+		else if (mio_puts (dest, line) == EOF)
+			error (FATAL | PERROR, "cannot write to temporary file");
+	}
+	vStringDelete (input);
+	return dropped;
+}
+
+/*  Drop the stale tags from the tag file, and put the new tags
+ *  appended at the end of the tag file in order.
+ *
+ *  If the old tags are sorted in the same way, they are merged with the
+ *  sorted new tags in a linear pass. Otherwise the remaining tags are
+ *  written back to the tag file, and the whole file is sorted as usual.
+ */
+static void updateTagFile (void)
+{
+	MIO *const mio = mio_new_file (TagFile.name, "r");
+	char *oldName = NULL;
+	MIO *old;
+	unsigned long dropped;
+
+	if (mio == NULL)
+		error (FATAL | PERROR, "cannot open tag file");
+
+	old = tempFile ("w+", &oldName);
+	dropped = copyOldTags (mio, old);
+	verbose ("update: dropped %lu stale tag%s\n", dropped, dropped == 1? "": "s");
+	TagFile.numTags.prev -= dropped;
+	mio_seek (mio, TagFile.update.offset, SEEK_SET);
+
+#ifndef EXTERNAL_SORT
+	if (Option.sorted != SO_UNSORTED
+		&& TagFile.update.sorted == (int) Option.sorted)
+	{
+		verbose ("merging tag file\n");
+		mio_seek (old, 0, SEEK_SET);
+		internalSortTags (false, mio, old);
+		mio_unref (mio);
+	}
+	else
+#endif
+	{
+		MIO *out;
+
+		copyBytes (mio, old, -1);
+		mio_unref (mio);
+
+		out = mio_new_file (TagFile.name, "w");
+		if (out == NULL)
+			error (FATAL | PERROR, "cannot open tag file");
+		mio_seek (old, 0, SEEK_SET);
+		copyBytes (old, out, -1);
+		if (mio_unref (out) != 0)
+			error (FATAL | PERROR, "cannot close tag file");
+
+		sortTagFile ();
+	}
+
+	mio_unref (old);
+	remove (oldName);
+	eFree (oldName);
+}
+
 static void resizeTagFile (const long newSize)
 {
 	int result;
@@ -629,8 +854,23 @@ extern void closeTagFile (const bool resize)
 				TagFile.name? TagFile.name: "<mio>", size, desiredSize); )
 		resizeTagFile (desiredSize);
 	}
-	sortTagFile ();
-	if (TagsToStdout)
+	if (TagFile.update.offset > 0)
+		updateTagFile ();
+	else if (TagFile.stdoutMio)
+	{
+		if (TagFile.numTags.added > 0L)
+			writeTagLinesToStdout (desiredSize);
+	}
+	else
+		sortTagFile ();
+	if (! TagsToStdout)
+	{
+		if (Option.tagIndex)
+			writeTagIndex (TagFile.name);
+		else
+			removeTagIndex (TagFile.name);
+	}
+	else
 	{
 		if (mio_unref (TagFile.mio) != 0)
 			error (FATAL | PERROR, "cannot close tag file");
@@ -639,9 +879,11 @@ extern void closeTagFile (const bool resize)
 	}
 
 	TagFile.mio = NULL;
+	TagFile.stdoutMio = NULL;
 	if (TagFile.name)
 		eFree (TagFile.name);
 	TagFile.name = NULL;
+	TagFile.update.offset = 0;
 }
 
 /*
@@ -727,6 +969,17 @@ static bool isPosSet(MIOPos pos)
 extern char *readLineFromBypassForTag (vString *const vLine, const tagEntryInfo *const tag,
 				   long *const pSeekValue)
 {
+	/* The input file of a tag written again is not open. */
+	if (ReplayedLine.active)
+	{
+		if (ReplayedLine.line == NULL)
+			return NULL;
+		vStringCopyS (vLine, ReplayedLine.line);
+		if (pSeekValue != NULL)
+			*pSeekValue = ReplayedLine.seekValue;
+		return vStringValue (vLine);
+	}
+
 	Assert (isPosSet (tag->filePosition) || (tag->pattern == NULL));
 	return readLineFromBypass (vLine, tag->filePosition, pSeekValue);
 }
@@ -976,10 +1229,10 @@ extern void attachParserField (tagEntryInfo *const tag, bool inCorkQueue, fieldT
 	if (inCorkQueue)
 	{
 		const char * v;
-		v = eStrdup (value);
+		v = internString (value);
 
 		bool dynfields_allocated = tag->parserFieldsDynamic? true: false;
-		attachParserFieldGeneric (tag, ftype, v, true);
+		attachParserFieldGeneric (tag, ftype, v, false);
 		if (!dynfields_allocated && tag->parserFieldsDynamic)
 			PARSER_TRASH_BOX_TAKE_BACK(tag->parserFieldsDynamic);
 	}
@@ -1033,29 +1286,34 @@ static void copyParserFields (const tagEntryInfo *const tag, tagEntryInfo* slot)
 
 		value = f->value;
 		if (value)
-			value = eStrdup (value);
+			value = internString (value);
 
 		attachParserFieldGeneric (slot,
 								  f->ftype,
 								  value,
-								  true);
+								  false);
 	}
 
 }
 
 static tagEntryInfo *newNilTagEntry (unsigned int corkFlags)
 {
-	tagEntryInfoX *x = xCalloc (1, tagEntryInfoX);
+	tagEntryInfoX *x = arenaCalloc (TagFile.corkArena, 1, sizeof (tagEntryInfoX));
 	x->corkIndex = CORK_NIL;
 	x->symtab = RB_ROOT;
 	x->slot.kindIndex = KIND_FILE_INDEX;
 	return &(x->slot);
 }
 
+static const char *corkStrdup (const char *const str)
+{
+	return arenaStrdup (TagFile.corkArena, str);
+}
+
 static tagEntryInfoX *copyTagEntry (const tagEntryInfo *const tag,
 								   unsigned int corkFlags)
 {
-	tagEntryInfoX *x = xMalloc (1, tagEntryInfoX);
+	tagEntryInfoX *x = arenaAlloc (TagFile.corkArena, sizeof (tagEntryInfoX));
 	x->symtab = RB_ROOT;
 	x->corkIndex = CORK_NIL;
 	tagEntryInfo  *slot = (tagEntryInfo *)x;
@@ -1063,38 +1321,38 @@ static tagEntryInfoX *copyTagEntry (const tagEntryInfo *const tag,
 	*slot = *tag;
 
 	if (slot->pattern)
-		slot->pattern = eStrdup (slot->pattern);
+		slot->pattern = corkStrdup (slot->pattern);
 
-	slot->inputFileName = eStrdup (slot->inputFileName);
-	slot->name = eStrdup (slot->name);
+	slot->inputFileName = internString (slot->inputFileName);
+	slot->name = corkStrdup (slot->name);
 	if (slot->extensionFields.access)
-		slot->extensionFields.access = eStrdup (slot->extensionFields.access);
+		slot->extensionFields.access = internString (slot->extensionFields.access);
 	if (slot->extensionFields.implementation)
-		slot->extensionFields.implementation = eStrdup (slot->extensionFields.implementation);
+		slot->extensionFields.implementation = internString (slot->extensionFields.implementation);
 	if (slot->extensionFields.inheritance)
-		slot->extensionFields.inheritance = eStrdup (slot->extensionFields.inheritance);
+		slot->extensionFields.inheritance = internString (slot->extensionFields.inheritance);
 	if (slot->extensionFields.scopeName)
-		slot->extensionFields.scopeName = eStrdup (slot->extensionFields.scopeName);
+		slot->extensionFields.scopeName = internString (slot->extensionFields.scopeName);
 	if (slot->extensionFields.signature)
-		slot->extensionFields.signature = eStrdup (slot->extensionFields.signature);
+		slot->extensionFields.signature = corkStrdup (slot->extensionFields.signature);
 	if (slot->extensionFields.typeRef[0])
-		slot->extensionFields.typeRef[0] = eStrdup (slot->extensionFields.typeRef[0]);
+		slot->extensionFields.typeRef[0] = internString (slot->extensionFields.typeRef[0]);
 	if (slot->extensionFields.typeRef[1])
-		slot->extensionFields.typeRef[1] = eStrdup (slot->extensionFields.typeRef[1]);
+		slot->extensionFields.typeRef[1] = internString (slot->extensionFields.typeRef[1]);
 #ifdef HAVE_LIBXML
 	if (slot->extensionFields.xpath)
-		slot->extensionFields.xpath = eStrdup (slot->extensionFields.xpath);
+		slot->extensionFields.xpath = corkStrdup (slot->extensionFields.xpath);
 #endif
 
 	if (slot->extraDynamic)
 	{
 		int n = countXtags () - XTAG_COUNT;
-		slot->extraDynamic = xCalloc ((n / 8) + 1, uint8_t);
+		slot->extraDynamic = arenaAlloc (TagFile.corkArena, (n / 8) + 1);
 		memcpy (slot->extraDynamic, tag->extraDynamic, (n / 8) + 1);
 	}
 
 	if (slot->sourceFileName)
-		slot->sourceFileName = eStrdup (slot->sourceFileName);
+		slot->sourceFileName = internString (slot->sourceFileName);
 
 
 	slot->usedParserFields = 0;
@@ -1131,47 +1389,42 @@ static void clearParserFields (tagEntryInfo *const tag)
 	}
 }
 
+/* A parser may replace a string in an entry on the cork queue with
+ * a string on the heap. Only the latter has to be freed here; the rest
+ * is released at once with the arena or the pool of interned strings. */
 static void deleteTagEnry (void *data)
 {
 	tagEntryInfo *slot = data;
 
 	if (slot->kindIndex == KIND_FILE_INDEX)
-		goto out;
-
-	if (slot->pattern)
-		eFree ((char *)slot->pattern);
-	eFree ((char *)slot->inputFileName);
-	eFree ((char *)slot->name);
+		return;
 
-	if (slot->extensionFields.access)
-		eFree ((char *)slot->extensionFields.access);
-	if (slot->extensionFields.implementation)
-		eFree ((char *)slot->extensionFields.implementation);
-	if (slot->extensionFields.inheritance)
-		eFree ((char *)slot->extensionFields.inheritance);
-	if (slot->extensionFields.scopeName)
-		eFree ((char *)slot->extensionFields.scopeName);
-	if (slot->extensionFields.signature)
-		eFree ((char *)slot->extensionFields.signature);
-	if (slot->extensionFields.typeRef[0])
-		eFree ((char *)slot->extensionFields.typeRef[0]);
-	if (slot->extensionFields.typeRef[1])
-		eFree ((char *)slot->extensionFields.typeRef[1]);
+	freeCorkEntryField (slot->pattern);
+	freeCorkEntryField (slot->inputFileName);
+	freeCorkEntryField (slot->name);
+
+	freeCorkEntryField (slot->extensionFields.access);
+	freeCorkEntryField (slot->extensionFields.implementation);
+	freeCorkEntryField (slot->extensionFields.inheritance);
+	freeCorkEntryField (slot->extensionFields.scopeName);
+	freeCorkEntryField (slot->extensionFields.signature);
+	freeCorkEntryField (slot->extensionFields.typeRef[0]);
+	freeCorkEntryField (slot->extensionFields.typeRef[1]);
 #ifdef HAVE_LIBXML
-	if (slot->extensionFields.xpath)
-		eFree ((char *)slot->extensionFields.xpath);
+	freeCorkEntryField (slot->extensionFields.xpath);
 #endif
 
-	if (slot->extraDynamic)
-		eFree (slot->extraDynamic);
-
-	if (slot->sourceFileName)
-		eFree ((char *)slot->sourceFileName);
+	freeCorkEntryField (slot->sourceFileName);
 
 	clearParserFields (slot);
+}
 
- out:
-	eFree (slot);
+extern void freeCorkEntryField (const char *value)
+{
+	if (value
+		&& !arenaOwns (TagFile.corkArena, value)
+		&& !isInternedString (value))
+		eFree ((char *)value);
 }
 
 static void corkSymtabPut (tagEntryInfoX *scope, const char* name, tagEntryInfoX *item)
@@ -1552,6 +1805,9 @@ static void writeTagEntry (const tagEntryInfo *const tag)
 		buildFqTagCache ( (tagEntryInfo *const)tag);
 	}
 
+	if (isDedupRecording ())
+		recordTagForDedup ((tagEntryInfo *const)tag);
+
 	length = writerWriteTag (TagFile.mio, tag);
 
 	if (length > 0)
@@ -1564,6 +1820,20 @@ static void writeTagEntry (const tagEntryInfo *const tag)
 	abort_if_ferror (TagFile.mio);
 }
 
+/*  Write a tag recorded for another input file with the same content.
+ *  LINE is the input line read for the tag when it was recorded. */
+extern void writeReplayedTagEntry (const tagEntryInfo *const tag,
+				   const char *const line, long seekValue)
+{
+	ReplayedLine.active = true;
+	ReplayedLine.line = line;
+	ReplayedLine.seekValue = seekValue;
+
+	writeTagEntry (tag);
+
+	ReplayedLine.active = false;
+}
+
 extern bool writePseudoTag (const ptagDesc *desc,
 			       const char *const fileName,
 			       const char *const pattern,
@@ -1591,6 +1861,8 @@ extern void corkTagFile(unsigned int corkFlags)
 	{
 		TagFile.corkFlags = corkFlags;
 		TagFile.corkQueue = ptrArrayNew (deleteTagEnry);
+		if (TagFile.corkArena == NULL)
+			TagFile.corkArena = arenaNew ();
 		tagEntryInfo *nil = newNilTagEntry (corkFlags);
 		ptrArrayAdd (TagFile.corkQueue, nil);
 	}
@@ -1599,12 +1871,19 @@ extern void corkTagFile(unsigned int corkFlags)
 extern void uncorkTagFile(void)
 {
 	unsigned int i;
+	statsPhase phase;
 
 	TagFile.cork--;
 
 	if (TagFile.cork > 0)
 		return ;
 
+	phase = switchPhase (PHASE_WRITING);
+	if (TraceEventsEnabled)
+	{
+		traceEventCounter ("corkQueue", ptrArrayCount (TagFile.corkQueue) - 1);
+		traceEventBegin ("uncork", NULL, NULL);
+	}
 	for (i = 1; i < ptrArrayCount (TagFile.corkQueue); i++)
 	{
 		tagEntryInfo *tag = ptrArrayItem (TagFile.corkQueue, i);
@@ -1629,6 +1908,14 @@ extern void uncorkTagFile(void)
 
 	ptrArrayDelete (TagFile.corkQueue);
 	TagFile.corkQueue = NULL;
+	arenaClear (TagFile.corkArena);
+	clearInternedStrings ();
+	if (TraceEventsEnabled)
+	{
+		traceEventEnd ("uncork");
+		traceEventCounter ("corkQueue", 0);
+	}
+	switchPhase (phase);
 }
 
 extern tagEntryInfo *getEntryInCorkQueue   (int n)
@@ -2025,6 +2312,57 @@ extern const char* getTagFileDirectory (void)
 	return TagFile.directory;
 }
 
+extern void flushTagFile (void)
+{
+	if (TagFile.mio == NULL)
+		return;
+
+	mio_flush (TagFile.mio);
+	abort_if_ferror (TagFile.mio);
+}
+
+/*  Let tag entries be written to MIO instead of the tag file.
+ *  The previously used stream is returned. */
+extern MIO *replaceTagFileMio (MIO *mio)
+{
+	MIO *old = TagFile.mio;
+
+	TagFile.mio = mio;
+	return old;
+}
+
+/*  Copy LENGTH bytes of tag output prepared elsewhere, at the current
+ *  position of SRC, to the tag file. */
+extern void copyToTagFile (MIO *src, long length)
+{
+	char buffer [BUFSIZ];
+
+	while (length > 0)
+	{
+		size_t toRead = ((size_t) length < sizeof (buffer))
+			? (size_t) length: sizeof (buffer);
+		size_t numRead = mio_read (src, buffer, 1, toRead);
+
+		if (numRead == 0)
+			error (FATAL | PERROR, "cannot read tag output to copy");
+		if (mio_write (TagFile.mio, buffer, 1, numRead) < numRead)
+			error (FATAL | PERROR, "cannot complete write");
+		length -= (long) numRead;
+	}
+	abort_if_ferror (TagFile.mio);
+}
+
+extern void getMaxTagLengths (size_t *nameLength, size_t *lineLength)
+{
+	*nameLength = TagFile.max.tag;
+	*lineLength = TagFile.max.line;
+}
+
+extern void updateMaxTagLengths (size_t nameLength, size_t lineLength)
+{
+	rememberMaxLengths (nameLength, lineLength);
+}
+
 static bool markAsPlaceholder  (int index, tagEntryInfo *e, void *data CTAGS_ATTR_UNUSED)
 {
 	e->placeholder = 1;
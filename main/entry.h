@@ -148,6 +148,11 @@ tagEntryInfo *getEntryInCorkQueue   (int n);
 tagEntryInfo *getEntryOfNestingLevel (const NestingLevel *nl);
 size_t        countEntryInCorkQueue (void);
 
+/* The strings in an entry on the cork queue are owned by the cork queue.
+ * A parser replacing one of them with a string on the heap must free
+ * the old one with freeCorkEntryField () instead of eFree (). */
+extern void freeCorkEntryField (const char *value);
+
 /* If a parser sets (CORK_QUEUE and )CORK_SYMTAB to useCork,
  * the parsesr can use symbol lookup tables for the current input.
  * Each scope has a symbol lookup table.
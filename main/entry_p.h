@@ -30,8 +30,12 @@ extern void freeTagFileResources (void);
 extern const char *tagFileName (void);
 extern void openTagFile (void);
 extern void closeTagFile (const bool resize);
+extern void streamTagFile (void);
+extern void noteInputFileForUpdate (const char *const fileName);
 extern void  setupWriter (void *writerClientData);
 extern bool  teardownWriter (const char *inputFilename);
+extern void writeReplayedTagEntry (const tagEntryInfo *const tag,
+				   const char *const line, long seekValue);
 
 extern unsigned long numTagsAdded(void);
 extern void setNumTagsAdded (unsigned long nadded);
@@ -41,6 +45,13 @@ extern void invalidatePatternCache(void);
 extern void tagFilePosition (MIOPos *p);
 extern void setTagFilePosition (MIOPos *p);
 extern const char* getTagFileDirectory (void);
+
+/* Merging tag output made in worker processes */
+extern void flushTagFile (void);
+extern MIO *replaceTagFileMio (MIO *mio);
+extern void copyToTagFile (MIO *src, long length);
+extern void getMaxTagLengths (size_t *nameLength, size_t *lineLength);
+extern void updateMaxTagLengths (size_t nameLength, size_t lineLength);
 extern void getTagScopeInformation (tagEntryInfo *const tag,
 				    const char **kind, const char **name);
 
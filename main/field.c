@@ -22,6 +22,7 @@
 #include "entry_p.h"
 #include "field.h"
 #include "field_p.h"
+#include "intern_p.h"
 #include "kind.h"
 #include "options_p.h"
 #include "parse_p.h"
@@ -402,7 +403,10 @@ static const char *renderEscapedString (const char *s,
 					const tagEntryInfo *const tag CTAGS_ATTR_UNUSED,
 					vString* b)
 {
-	vStringCatSWithEscaping (b, s);
+	if (isInternedString (s))
+		vStringCatS (b, escapeInternedString (s));
+	else
+		vStringCatSWithEscaping (b, s);
 	return vStringValue (b);
 }
 
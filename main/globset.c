@@ -0,0 +1,360 @@
+/*
+*   Copyright (c) 2026, Universal Ctags Team
+*
+*   This source code is released for free distribution under the terms of the
+*   GNU General Public License version 2 or (at your option) any later version.
+*
+*   This module matches a name against many file name patterns at once.
+*
+*   Most patterns given to ctags are one of "name", "*suffix" or
+*   "prefix*". Such patterns are put into hash tables keyed by their
+*   literal parts. A name is then matched with a lookup in the literal
+*   table, and a lookup per distinct suffix or prefix length, instead
+*   of a fnmatch(3) call per pattern. Only the rest of patterns are
+*   matched with fnmatch.
+*
+*   The patterns are matched without the flags of fnmatch, as
+*   stringListFileMatched() does: '*' matches '/' and a leading '.'.
+*/
+
+/*
+*   INCLUDE FILES
+*/
+#include "general.h"  /* must always come first */
+
+#include <string.h>
+#include <fnmatch.h>
+
+#include "globset_p.h"
+#include "htable.h"
+#include "routines.h"
+#include "routines_p.h"
+#include "vstring.h"
+
+/*
+*   DATA DECLARATIONS
+*/
+struct globEntry {
+	unsigned int order;			/* in which the entry was added */
+	char *key;					/* the literal part, or the pattern for fnmatch */
+	void *data;
+	struct globEntry *next;		/* the next entry with the same key */
+};
+
+struct globTable {
+	hashTable *table;			/* key -> the first entry with the key */
+	unsigned int *lengths;		/* the distinct lengths of the keys */
+	unsigned int lengthCount;
+};
+
+enum globClass {
+	GLOB_LITERAL,				/* name */
+	GLOB_SUFFIX,				/* *suffix */
+	GLOB_PREFIX,				/* prefix* */
+	GLOB_OTHER,					/* matched with fnmatch */
+};
+
+struct sGlobSet {
+	ptrArray *entries;
+	struct globTable literals;
+	struct globTable suffixes;
+	struct globTable prefixes;
+	ptrArray *others;
+	ptrArray *found;
+	vString *scratch;
+};
+
+/*
+*   FUNCTION DEFINITIONS
+*/
+
+static void deleteGlobEntry (void *data)
+{
+	struct globEntry *entry = data;
+
+	eFree (entry->key);
+	eFree (entry);
+}
+
+static void initGlobTable (struct globTable *table)
+{
+	table->table = hashTableGrowableNew (
+		31,
+#ifdef CASE_INSENSITIVE_FILENAMES
+		hashCstrcasehash, hashCstrcaseeq,
+#else
+		hashCstrhash, hashCstreq,
+#endif
+		NULL, NULL);
+	table->lengths = NULL;
+	table->lengthCount = 0;
+}
+
+static void finiGlobTable (struct globTable *table)
+{
+	hashTableDelete (table->table);
+	if (table->lengths)
+		eFree (table->lengths);
+}
+
+extern globSet *globSetNew (void)
+{
+	globSet *set = xMalloc (1, globSet);
+
+	set->entries = ptrArrayNew (deleteGlobEntry);
+	initGlobTable (&set->literals);
+	initGlobTable (&set->suffixes);
+	initGlobTable (&set->prefixes);
+	set->others = ptrArrayNew (NULL);
+	set->found = ptrArrayNew (NULL);
+	set->scratch = vStringNew ();
+
+	return set;
+}
+
+extern void globSetDelete (globSet *set)
+{
+	finiGlobTable (&set->literals);
+	finiGlobTable (&set->suffixes);
+	finiGlobTable (&set->prefixes);
+	ptrArrayDelete (set->others);
+	ptrArrayDelete (set->found);
+	ptrArrayDelete (set->entries);
+	vStringDelete (set->scratch);
+	eFree (set);
+}
+
+extern void globSetClear (globSet *set)
+{
+	finiGlobTable (&set->literals);
+	finiGlobTable (&set->suffixes);
+	finiGlobTable (&set->prefixes);
+	initGlobTable (&set->literals);
+	initGlobTable (&set->suffixes);
+	initGlobTable (&set->prefixes);
+	ptrArrayClear (set->others);
+	ptrArrayClear (set->entries);
+}
+
+extern unsigned int globSetCount (const globSet *set)
+{
+	return ptrArrayCount (set->entries);
+}
+
+static bool hasSpecialChar (const char *const s, size_t length)
+{
+	for (size_t i = 0; i < length; i++)
+		if (s [i] == '*' || s [i] == '?' || s [i] == '[' || s [i] == '\\')
+			return true;
+	return false;
+}
+
+static void addToGlobTable (struct globTable *table, struct globEntry *entry)
+{
+	struct globEntry *first = hashTableGetItem (table->table, entry->key);
+	unsigned int length = (unsigned int) strlen (entry->key);
+	unsigned int i;
+
+	if (first)
+	{
+		while (first->next)
+			first = first->next;
+		first->next = entry;
+		return;
+	}
+	hashTablePutItem (table->table, entry->key, entry);
+
+	for (i = 0; i < table->lengthCount; i++)
+		if (table->lengths [i] == length)
+			return;
+	table->lengths = xRealloc (table->lengths, table->lengthCount + 1, unsigned int);
+	table->lengths [table->lengthCount++] = length;
+}
+
+static void addGlobEntry (globSet *set, enum globClass klass,
+						  const char *const key, size_t length, void *data)
+{
+	struct globEntry *entry = xMalloc (1, struct globEntry);
+
+	entry->order = ptrArrayAdd (set->entries, entry);
+	entry->key = eStrndup (key, length);
+	entry->data = data;
+	entry->next = NULL;
+
+	switch (klass)
+	{
+	case GLOB_LITERAL:
+		addToGlobTable (&set->literals, entry);
+		break;
+	case GLOB_SUFFIX:
+		addToGlobTable (&set->suffixes, entry);
+		break;
+	case GLOB_PREFIX:
+		addToGlobTable (&set->prefixes, entry);
+		break;
+	case GLOB_OTHER:
+#ifdef CASE_INSENSITIVE_FILENAMES
+		{
+			char *upper = newUpperString (entry->key);
+			eFree (entry->key);
+			entry->key = upper;
+		}
+#endif
+		ptrArrayAdd (set->others, entry);
+		break;
+	}
+}
+
+extern void globSetAddPattern (globSet *set, const char *const pattern, void *data)
+{
+	const size_t length = strlen (pattern);
+
+	if (! hasSpecialChar (pattern, length))
+		addGlobEntry (set, GLOB_LITERAL, pattern, length, data);
+	else if (pattern [0] == '*' && ! hasSpecialChar (pattern + 1, length - 1))
+		addGlobEntry (set, GLOB_SUFFIX, pattern + 1, length - 1, data);
+	else if (pattern [length - 1] == '*' && ! hasSpecialChar (pattern, length - 1))
+		addGlobEntry (set, GLOB_PREFIX, pattern, length - 1, data);
+	else
+		addGlobEntry (set, GLOB_OTHER, pattern, length, data);
+}
+
+extern void globSetAddLiteral (globSet *set, const char *const literal, void *data)
+{
+	addGlobEntry (set, GLOB_LITERAL, literal, strlen (literal), data);
+}
+
+/*  Add ENTRY and the entries following it to FOUND. Return true if
+ *  there is ENTRY. */
+static bool addFoundEntries (struct globEntry *entry, ptrArray *found)
+{
+	if (entry == NULL)
+		return false;
+
+	if (found)
+		for (; entry; entry = entry->next)
+			ptrArrayAdd (found, entry);
+	return true;
+}
+
+/*  Find the entries matching NAME. If FOUND is NULL, stop at the first
+ *  entry found. */
+static bool findGlobEntries (globSet *set, const char *const name, ptrArray *found)
+{
+	const size_t length = strlen (name);
+	bool matched = false;
+	unsigned int i;
+
+	if (addFoundEntries (hashTableGetItem (set->literals.table, name), found))
+	{
+		if (! found)
+			return true;
+		matched = true;
+	}
+
+	for (i = 0; i < set->suffixes.lengthCount; i++)
+	{
+		const size_t l = set->suffixes.lengths [i];
+
+		if (l <= length
+			&& addFoundEntries (hashTableGetItem (set->suffixes.table,
+												  name + length - l), found))
+		{
+			if (! found)
+				return true;
+			matched = true;
+		}
+	}
+
+	for (i = 0; i < set->prefixes.lengthCount; i++)
+	{
+		const size_t l = set->prefixes.lengths [i];
+
+		if (l > length)
+			continue;
+		vStringNCopyS (set->scratch, name, l);
+		if (addFoundEntries (hashTableGetItem (set->prefixes.table,
+											   vStringValue (set->scratch)), found))
+		{
+			if (! found)
+				return true;
+			matched = true;
+		}
+	}
+
+	if (ptrArrayCount (set->others) > 0)
+	{
+#ifdef CASE_INSENSITIVE_FILENAMES
+		char *const n = newUpperString (name);
+#else
+		const char *const n = name;
+#endif
+		for (i = 0; i < ptrArrayCount (set->others); i++)
+		{
+			struct globEntry *entry = ptrArrayItem (set->others, i);
+
+			if (fnmatch (entry->key, n, 0) == 0)
+			{
+				matched = true;
+				if (! found)
+					break;
+				ptrArrayAdd (found, entry);
+			}
+		}
+#ifdef CASE_INSENSITIVE_FILENAMES
+		eFree (n);
+#endif
+	}
+
+	return matched;
+}
+
+static int compareGlobEntryOrder (const void *a, const void *b)
+{
+	const struct globEntry *ea = a;
+	const struct globEntry *eb = b;
+
+	return (ea->order < eb->order)? -1: (ea->order > eb->order);
+}
+
+extern bool globSetMatched (globSet *set, const char *const name)
+{
+	bool matched;
+
+	if (ptrArrayCount (set->entries) == 0)
+		return false;
+
+#if defined (WIN32)
+	vString *tmp = vStringNewInit (name);
+	vStringTranslate (tmp, PATH_SEPARATOR, OUTPUT_PATH_SEPARATOR);
+	matched = findGlobEntries (set, vStringValue (tmp), NULL);
+	vStringDelete (tmp);
+#else
+	matched = findGlobEntries (set, name, NULL);
+#endif
+
+	return matched;
+}
+
+extern void globSetFindAll (globSet *set, const char *const name, ptrArray *matches)
+{
+	if (ptrArrayCount (set->entries) == 0)
+		return;
+
+	ptrArrayClear (set->found);
+#if defined (WIN32)
+	vString *tmp = vStringNewInit (name);
+	vStringTranslate (tmp, PATH_SEPARATOR, OUTPUT_PATH_SEPARATOR);
+	findGlobEntries (set, vStringValue (tmp), set->found);
+	vStringDelete (tmp);
+#else
+	findGlobEntries (set, name, set->found);
+#endif
+
+	ptrArraySort (set->found, compareGlobEntryOrder);
+	for (unsigned int i = 0; i < ptrArrayCount (set->found); i++)
+	{
+		struct globEntry *entry = ptrArrayItem (set->found, i);
+		ptrArrayAdd (matches, entry->data);
+	}
+}
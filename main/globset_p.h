@@ -0,0 +1,46 @@
+/*
+*   Copyright (c) 2026, Universal Ctags Team
+*
+*   This source code is released for free distribution under the terms of the
+*   GNU General Public License version 2 or (at your option) any later version.
+*
+*   main part private interface to globset.c
+*/
+#ifndef CTAGS_MAIN_GLOBSET_PRIVATE_H
+#define CTAGS_MAIN_GLOBSET_PRIVATE_H
+
+/*
+*   INCLUDE FILES
+*/
+#include "general.h"  /* must always come first */
+
+#include "ptrarray.h"
+
+/*
+*   DATA DECLARATIONS
+*/
+typedef struct sGlobSet globSet;
+
+/*
+*   FUNCTION PROTOTYPES
+*/
+extern globSet *globSetNew (void);
+extern void globSetDelete (globSet *set);
+extern void globSetClear (globSet *set);
+extern unsigned int globSetCount (const globSet *set);
+
+/* Add a file name pattern of fnmatch(3). DATA is given back for a name
+ * matching it. */
+extern void globSetAddPattern (globSet *set, const char *const pattern, void *data);
+/* Add a string which a name must be equal to. Unlike a pattern, the
+ * characters special to fnmatch have no special meaning in it. */
+extern void globSetAddLiteral (globSet *set, const char *const literal, void *data);
+
+/* Return true if NAME matches one of the patterns and literals of SET
+ * as stringListFileMatched() does. */
+extern bool globSetMatched (globSet *set, const char *const name);
+/* Append the DATA of all patterns and literals matching NAME to MATCHES,
+ * in the order they were added to SET. */
+extern void globSetFindAll (globSet *set, const char *const name, ptrArray *matches);
+
+#endif	/* CTAGS_MAIN_GLOBSET_PRIVATE_H */
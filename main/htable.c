@@ -14,6 +14,7 @@
 
 #ifndef MAIN
 #include <stdio.h>
+#include "htable_p.h"
 #include "routines.h"
 #else
 #include <stdlib.h>
@@ -28,6 +29,7 @@
 #endif
 #endif	/* MAIN */
 
+#include <stdint.h>
 #include <string.h>
 
 
@@ -38,9 +40,28 @@ struct sHashEntry {
 	hentry *next;
 };
 
+/* A slot of the open addressing table made by hashTableGrowableNew().
+ * The key and value put last for a key are stored in the slot itself.
+ * The ones put before for the same key are chained to "older", the
+ * newest first, as the chained table does. */
+typedef struct sHashSlot hslot;
+struct sHashSlot {
+	void *key;
+	void *value;
+	hentry *older;
+	unsigned int hash;
+	unsigned int distance;	/* 0 for an empty slot, 1 for the home slot */
+};
+
+#define HASH_SLOT_MIN 8
+
 struct sHashTable {
 	hentry** table;
-	unsigned int size;
+	unsigned int size;			/* the number of slots if slots is not NULL */
+	hslot *slots;
+	unsigned int shift;
+	unsigned int used;			/* the number of occupied slots */
+	unsigned int items;
 	hashTableHashFunc hashfn;
 	hashTableEqualFunc equalfn;
 	hashTableDeleteFunc keyfreefn;
@@ -152,6 +173,112 @@ static bool  entry_foreach (hentry *entry, hashTableForeachFunc proc, void *user
 	return true;
 }
 
+/* Robin Hood hashing with linear probing: a key being inserted takes
+ * the slot of a key closer to its home slot, so that every probe can
+ * stop at a key closer to its home than the probed key would be. */
+static unsigned int slot_home (hashTable *htable, unsigned int hash)
+{
+	/* hashPtrhash() and hashInthash() leave the low bits unmixed. */
+	return (unsigned int) (((uint32_t) hash * UINT32_C(0x9E3779B9)) >> htable->shift);
+}
+
+static hslot *slot_find (hashTable *htable, const void *const key, unsigned int hash)
+{
+	unsigned int mask = htable->size - 1;
+	unsigned int i = slot_home (htable, hash);
+
+	for (unsigned int distance = 1; ; distance++)
+	{
+		hslot *slot = htable->slots + i;
+
+		if (slot->distance < distance)
+			return NULL;
+		if (slot->hash == hash && htable->equalfn (key, slot->key))
+			return slot;
+		i = (i + 1) & mask;
+	}
+}
+
+static void slot_insert (hashTable *htable, hslot entry)
+{
+	unsigned int mask = htable->size - 1;
+	unsigned int i = slot_home (htable, entry.hash);
+
+	for (entry.distance = 1; htable->slots[i].distance != 0; entry.distance++)
+	{
+		if (htable->slots[i].distance < entry.distance)
+		{
+			hslot tmp = htable->slots[i];
+			htable->slots[i] = entry;
+			entry = tmp;
+		}
+		i = (i + 1) & mask;
+	}
+	htable->slots[i] = entry;
+	htable->used++;
+}
+
+/* Backward shift deletion: no tombstone is left. */
+static void slot_remove (hashTable *htable, unsigned int i)
+{
+	unsigned int mask = htable->size - 1;
+	unsigned int j = (i + 1) & mask;
+
+	while (htable->slots[j].distance > 1)
+	{
+		htable->slots[i] = htable->slots[j];
+		htable->slots[i].distance--;
+		i = j;
+		j = (j + 1) & mask;
+	}
+	htable->slots[i].distance = 0;
+	htable->slots[i].older = NULL;
+	htable->used--;
+}
+
+static void slots_grow (hashTable *htable)
+{
+	hslot *old = htable->slots;
+	unsigned int oldSize = htable->size;
+
+	htable->size *= 2;
+	htable->shift--;
+	htable->slots = xCalloc (htable->size, hslot);
+	htable->used = 0;
+
+	for (unsigned int i = 0; i < oldSize; i++)
+		if (old[i].distance)
+			slot_insert (htable, old[i]);
+	eFree (old);
+}
+
+static void slot_put (hashTable *htable, void *key, void *value, unsigned int hash)
+{
+	/* Keep the load factor at or below 3/4. */
+	if ((htable->used + 1) * 4 > htable->size * 3)
+		slots_grow (htable);
+
+	hslot entry = {
+		.key = key,
+		.value = value,
+		.older = NULL,
+		.hash = hash,
+	};
+	slot_insert (htable, entry);
+}
+
+static void slot_reset (hslot *slot, void *newkey, void *newval,
+						hashTableDeleteFunc keyfreefn,
+						hashTableDeleteFunc valfreefn)
+{
+	if (keyfreefn)
+		keyfreefn (slot->key);
+	if (valfreefn)
+		valfreefn (slot->value);
+	slot->key = newkey;
+	slot->value = newval;
+}
+
 extern hashTable *hashTableNew    (unsigned int size,
 				   hashTableHashFunc hashfn,
 				   hashTableEqualFunc equalfn,
@@ -160,7 +287,7 @@ extern hashTable *hashTableNew    (unsigned int size,
 {
 	hashTable *htable;
 
-	htable = xMalloc (1, hashTable);
+	htable = xCalloc (1, hashTable);
 	htable->size = size;
 	htable->table = xCalloc (size, hentry*);
 
@@ -180,6 +307,33 @@ extern hashTable* hashTableIntNew (unsigned int size,
 	return hashTableNew (size, hashfn, equalfn, keyfreefn, NULL);
 }
 
+extern hashTable* hashTableGrowableNew (unsigned int size,
+										hashTableHashFunc hashfn,
+										hashTableEqualFunc equalfn,
+										hashTableDeleteFunc keyfreefn,
+										hashTableDeleteFunc valfreefn)
+{
+	hashTable *htable;
+	unsigned int shift = 32;
+
+	htable = xCalloc (1, hashTable);
+	htable->size = 1;
+	while (htable->size < HASH_SLOT_MIN || htable->size / 4 * 3 < size)
+	{
+		htable->size *= 2;
+		shift--;
+	}
+	htable->shift = shift;
+	htable->slots = xCalloc (htable->size, hslot);
+
+	htable->hashfn = hashfn;
+	htable->equalfn = equalfn;
+	htable->keyfreefn = keyfreefn;
+	htable->valfreefn = valfreefn;
+
+	return htable;
+}
+
 extern void       hashTableDelete (hashTable *htable)
 {
 	if (!htable)
@@ -187,7 +341,10 @@ extern void       hashTableDelete (hashTable *htable)
 
 	hashTableClear (htable);
 
-	eFree (htable->table);
+	if (htable->slots)
+		eFree (htable->slots);
+	else
+		eFree (htable->table);
 	eFree (htable);
 }
 
@@ -197,6 +354,23 @@ extern void       hashTableClear (hashTable *htable)
 	if (!htable)
 		return;
 
+	if (htable->slots)
+	{
+		for (i = 0; i < htable->size; i++)
+		{
+			hslot *slot = htable->slots + i;
+
+			if (slot->distance == 0)
+				continue;
+			slot_reset (slot, NULL, NULL, htable->keyfreefn, htable->valfreefn);
+			entry_reclaim (slot->older, htable->keyfreefn, htable->valfreefn);
+		}
+		memset (htable->slots, 0, sizeof (hslot) * htable->size);
+		htable->used = 0;
+		htable->items = 0;
+		return;
+	}
+
 	for (i = 0; i < htable->size; i++)
 	{
 		hentry *entry;
@@ -211,6 +385,23 @@ extern void       hashTablePutItem    (hashTable *htable, void *key, void *value
 {
 	unsigned int i;
 
+	if (htable->slots)
+	{
+		unsigned int hash = htable->hashfn (key);
+		hslot *slot = slot_find (htable, key, hash);
+
+		if (slot)
+		{
+			slot->older = entry_new (slot->key, slot->value, slot->older);
+			slot->key = key;
+			slot->value = value;
+		}
+		else
+			slot_put (htable, key, value, hash);
+		htable->items++;
+		return;
+	}
+
 	i = htable->hashfn (key) % htable->size;
 	htable->table[i] = entry_new(key, value, htable->table[i]);
 }
@@ -219,6 +410,12 @@ extern void*      hashTableGetItem   (hashTable *htable, const void * key)
 {
 	unsigned int i;
 
+	if (htable->slots)
+	{
+		hslot *slot = slot_find (htable, key, htable->hashfn (key));
+		return slot? slot->value: NULL;
+	}
+
 	i = htable->hashfn (key) % htable->size;
 	return entry_find(htable->table[i], key, htable->equalfn);
 }
@@ -227,6 +424,30 @@ extern bool     hashTableDeleteItem (hashTable *htable, const void *key)
 {
 	unsigned int i;
 
+	if (htable->slots)
+	{
+		hslot *slot = slot_find (htable, key, htable->hashfn (key));
+
+		if (!slot)
+			return false;
+
+		hentry *older = slot->older;
+		if (older)
+		{
+			slot_reset (slot, older->key, older->value,
+						htable->keyfreefn, htable->valfreefn);
+			slot->older = older->next;
+			eFree (older);
+		}
+		else
+		{
+			slot_reset (slot, NULL, NULL, htable->keyfreefn, htable->valfreefn);
+			slot_remove (htable, (unsigned int) (slot - htable->slots));
+		}
+		htable->items--;
+		return true;
+	}
+
 	i = htable->hashfn (key) % htable->size;
 	return entry_delete(&htable->table[i], key,
 			    htable->equalfn, htable->keyfreefn, htable->valfreefn);
@@ -236,6 +457,21 @@ extern bool    hashTableUpdateItem (hashTable *htable, void *key, void *value)
 {
 	unsigned int i;
 
+	if (htable->slots)
+	{
+		unsigned int hash = htable->hashfn (key);
+		hslot *slot = slot_find (htable, key, hash);
+
+		if (slot)
+		{
+			slot_reset (slot, key, value, htable->keyfreefn, htable->valfreefn);
+			return true;
+		}
+		slot_put (htable, key, value, hash);
+		htable->items++;
+		return false;
+	}
+
 	i = htable->hashfn (key) % htable->size;
 	bool r = entry_update(htable->table[i], key, value,
 						  htable->equalfn, htable->keyfreefn, htable->valfreefn);
@@ -253,6 +489,22 @@ extern bool       hashTableForeachItem (hashTable *htable, hashTableForeachFunc
 {
 	unsigned int i;
 
+	if (htable->slots)
+	{
+		for (i = 0; i < htable->size; i++)
+		{
+			hslot *slot = htable->slots + i;
+
+			if (slot->distance == 0)
+				continue;
+			if (!proc (slot->key, slot->value, user_data))
+				return false;
+			if (!entry_foreach (slot->older, proc, user_data))
+				return false;
+		}
+		return true;
+	}
+
 	for (i = 0; i < htable->size; i++)
 		if (!entry_foreach(htable->table[i], proc, user_data))
 			return false;
@@ -281,6 +533,18 @@ extern bool       hashTableForeachItemOnChain (hashTable *htable, const void *ke
 		.equalfn   = htable->equalfn,
 	};
 
+	if (htable->slots)
+	{
+		/* All the items in the slot and its "older" chain have the key. */
+		hslot *slot = slot_find (htable, key, htable->hashfn (key));
+
+		if (!slot)
+			return true;
+		if (!proc (slot->key, slot->value, user_data))
+			return false;
+		return entry_foreach (slot->older, proc, user_data);
+	}
+
 	i = htable->hashfn (key) % htable->size;
 	if (!entry_foreach(htable->table[i], track_chain, &chain_tracker))
 		return false;
@@ -297,6 +561,10 @@ static bool count (const void *const key CTAGS_ATTR_UNUSED, void *value CTAGS_AT
 extern unsigned int hashTableCountItem   (hashTable *htable)
 {
 	int c = 0;
+
+	if (htable->slots)
+		return htable->items;
+
 	hashTableForeachItem (htable, count, &c);
 	return c;
 }
@@ -391,3 +659,152 @@ bool hashCstrcaseeq (const void *const a, const void *const b)
 {
 	return !!(strcasecmp (a, b) == 0);
 }
+
+#ifndef MAIN
+static unsigned int testFreedCount;
+
+/* Items 4n to 4n+3 have the same hash, to make them collide. */
+static unsigned int test_hash (const void *const x)
+{
+	return HT_PTR_TO_UINT (x) / 4;
+}
+
+static void test_free (void *ptr CTAGS_ATTR_UNUSED)
+{
+	testFreedCount++;
+}
+
+static bool test_collect (const void *const key CTAGS_ATTR_UNUSED, void *value, void *data)
+{
+	FILE *fp = data;
+	fprintf (fp, " %u", HT_PTR_TO_UINT (value));
+	return true;
+}
+
+/* Verify that each slot is at the distance it records from the home of
+ * its key, that no key is farther from its home than the key in the slot
+ * before it could have been, and that the counters are right. */
+static void test_verify (hashTable *htable, const char *step)
+{
+	unsigned int mask = htable->size - 1;
+	unsigned int used = 0, items = 0;
+
+	for (unsigned int i = 0; i < htable->size; i++)
+	{
+		hslot *slot = htable->slots + i;
+
+		if (slot->distance == 0)
+			continue;
+		used++;
+		items++;
+		for (hentry *e = slot->older; e; e = e->next)
+			items++;
+
+		if (((i - slot_home (htable, slot->hash)) & mask) + 1 != slot->distance
+			|| htable->slots[(i - 1) & mask].distance + 1 < slot->distance
+			|| slot_find (htable, slot->key, slot->hash) != slot)
+			error (FATAL, "%s: slot %u of the hash table is misplaced", step, i);
+	}
+
+	if (used != htable->used || items != htable->items
+		|| used * 4 > htable->size * 3)
+		error (FATAL, "%s: the hash table counts %u/%u items in %u/%u slots of %u",
+			   step, htable->items, items, htable->used, used, htable->size);
+}
+
+static unsigned int test_moved (hashTable *htable, const void **keys)
+{
+	unsigned int moved = 0;
+
+	for (unsigned int i = 0; i < htable->size; i++)
+	{
+		const void *key = htable->slots[i].distance? htable->slots[i].key: NULL;
+		if (keys[i] && key && keys[i] != key)
+			moved++;
+		keys[i] = key;
+	}
+	return moved;
+}
+
+/* Exercise the growable table with colliding keys, verifying the
+ * layout of the slots after each step, and print the results. */
+extern void testHashTable (FILE *fp)
+{
+	hashTable *htable = hashTableGrowableNew (0, test_hash, hashPtreq, NULL, test_free);
+	unsigned int k;
+	const void *keys [64];
+
+	fprintf (fp, "new: %u slots\n", htable->size);
+	for (k = 1; k <= 20; k++)
+	{
+		hashTablePutItem (htable, HT_UINT_TO_PTR (k), HT_UINT_TO_PTR (k));
+		test_verify (htable, "put");
+	}
+	fprintf (fp, "put 1..20: %u items in %u slots\n",
+			 hashTableCountItem (htable), htable->size);
+
+	for (k = 1; k <= 20; k++)
+		if (HT_PTR_TO_UINT (hashTableGetItem (htable, HT_UINT_TO_PTR (k))) != k)
+			error (FATAL, "get: wrong value for %u", k);
+	fprintf (fp, "get 1..20: ok, has 21: %d\n",
+			 hashTableHasItem (htable, HT_UINT_TO_PTR (21)));
+
+	hashTablePutItem (htable, HT_UINT_TO_PTR (4), HT_UINT_TO_PTR (104));
+	test_verify (htable, "put again");
+	fprintf (fp, "put 4 again: %u items, get 4: %u, chain of 4:",
+			 hashTableCountItem (htable),
+			 HT_PTR_TO_UINT (hashTableGetItem (htable, HT_UINT_TO_PTR (4))));
+	hashTableForeachItemOnChain (htable, HT_UINT_TO_PTR (4), test_collect, fp);
+	fputc ('\n', fp);
+
+	bool updated = hashTableUpdateItem (htable, HT_UINT_TO_PTR (5), HT_UINT_TO_PTR (105));
+	test_verify (htable, "update");
+	fprintf (fp, "update 5: %d, get 5: %u, freed: %u\n", updated,
+			 HT_PTR_TO_UINT (hashTableGetItem (htable, HT_UINT_TO_PTR (5))),
+			 testFreedCount);
+	updated = hashTableUpdateItem (htable, HT_UINT_TO_PTR (21), HT_UINT_TO_PTR (21));
+	test_verify (htable, "update");
+	fprintf (fp, "update 21: %d, %u items\n", updated, hashTableCountItem (htable));
+
+	bool deleted = hashTableDeleteItem (htable, HT_UINT_TO_PTR (4));
+	test_verify (htable, "delete");
+	fprintf (fp, "delete 4: %d, get 4: %u, freed: %u\n", deleted,
+			 HT_PTR_TO_UINT (hashTableGetItem (htable, HT_UINT_TO_PTR (4))),
+			 testFreedCount);
+
+	test_moved (htable, memset (keys, 0, sizeof (keys)));
+	deleted = hashTableDeleteItem (htable, HT_UINT_TO_PTR (4));
+	test_verify (htable, "delete");
+	unsigned int moved = test_moved (htable, keys);
+	fprintf (fp, "delete 4 again: %d, shifted back: %s, has 4: %d, get 7: %u\n",
+			 deleted, moved > 0? "yes": "no",
+			 hashTableHasItem (htable, HT_UINT_TO_PTR (4)),
+			 HT_PTR_TO_UINT (hashTableGetItem (htable, HT_UINT_TO_PTR (7))));
+	fprintf (fp, "delete 4 once more: %d, %u items\n",
+			 hashTableDeleteItem (htable, HT_UINT_TO_PTR (4)),
+			 hashTableCountItem (htable));
+
+	for (k = 1; k <= 21; k++)
+		if (k != 4
+			&& HT_PTR_TO_UINT (hashTableGetItem (htable, HT_UINT_TO_PTR (k))) != (k == 5? 105: k))
+			error (FATAL, "delete: wrong value for %u", k);
+
+	testFreedCount = 0;
+	hashTableClear (htable);
+	test_verify (htable, "clear");
+	fprintf (fp, "clear: %u items in %u slots, freed: %u, has 1: %d\n",
+			 hashTableCountItem (htable), htable->size, testFreedCount,
+			 hashTableHasItem (htable, HT_UINT_TO_PTR (1)));
+
+	for (k = 1; k <= 48; k++)
+		hashTablePutItem (htable, HT_UINT_TO_PTR (k), HT_UINT_TO_PTR (k));
+	test_verify (htable, "grow");
+	fprintf (fp, "put 1..48: %u items in %u slots\n",
+			 hashTableCountItem (htable), htable->size);
+	hashTableDelete (htable);
+
+	htable = hashTableGrowableNew (100, test_hash, hashPtreq, NULL, NULL);
+	fprintf (fp, "new for 100 items: %u slots\n", htable->size);
+	hashTableDelete (htable);
+}
+#endif	/* MAIN */
@@ -26,6 +26,13 @@
  * key.
  *
  * Use hashTableForeachItemOnChain () to process all items for the same key.
+ *
+ * hashTableNew() makes a table chaining the items in a fixed number
+ * (size) of buckets. hashTableGrowableNew() makes a table storing the
+ * items in an array of slots with open addressing; the array grows as
+ * items are added, so size is just the number of items expected.
+ * Both tables work the same way through the functions below, except
+ * that hashTableForeachItem() visits the items in different orders.
  */
 typedef struct sHashTable hashTable;
 typedef unsigned int (* hashTableHashFunc)  (const void * const key);
@@ -54,6 +61,12 @@ extern hashTable* hashTableNew         (unsigned int size,
 					hashTableDeleteFunc keyfreefn,
 					hashTableDeleteFunc valfreefn);
 
+extern hashTable* hashTableGrowableNew (unsigned int size,
+					hashTableHashFunc hashfn,
+					hashTableEqualFunc equalfn,
+					hashTableDeleteFunc keyfreefn,
+					hashTableDeleteFunc valfreefn);
+
 extern void       hashTableDelete      (hashTable *htable);
 extern void       hashTableClear       (hashTable *htable);
 extern void       hashTablePutItem     (hashTable *htable, void *key, void *value);
@@ -0,0 +1,20 @@
+/*
+*   Copyright (c) 2026, Universal Ctags Team
+*
+*   This source code is released for free distribution under the terms of the
+*   GNU General Public License version 2 or (at your option) any later version.
+*
+*   main part private interface to htable.c
+*/
+#ifndef CTAGS_MAIN_HTABLE_PRIVATE_H
+#define CTAGS_MAIN_HTABLE_PRIVATE_H
+
+/*
+*   INCLUDE FILES
+*/
+#include "general.h"  /* must always come first */
+#include <stdio.h>
+
+extern void testHashTable (FILE *fp);
+
+#endif	/* CTAGS_MAIN_HTABLE_PRIVATE_H */
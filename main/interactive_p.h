@@ -20,6 +20,7 @@ struct interactiveModeArgs
 };
 
 void interactiveLoop (cookedArgs *args, void *user);
+void serveInteractiveRequests (bool sandbox);
 bool jsonErrorPrinter (const errorSelection selection, const char *const format, va_list ap,
 					  void *data);
 int installSyscallFilter (void);
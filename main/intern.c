@@ -0,0 +1,122 @@
+/*
+*   Copyright (c) 2026, Universal Ctags Team
+*
+*   This source code is released for free distribution under the terms of the
+*   GNU General Public License version 2 or (at your option) any later version.
+*
+*   This module contains functions for interning strings.
+*
+*   Many tag entries of an input file share the same input file name,
+*   scope name, access, type reference and so on. Interning stores each
+*   of them once, and lets writers reuse the escaped form of a string.
+*   The strings are allocated from an arena, so isInternedString() is
+*   cheap, and the pool is cleared for each input file.
+*/
+
+/*
+*   INCLUDE FILES
+*/
+#include "general.h"  /* must always come first */
+
+#include <stddef.h>
+#include <string.h>
+
+#include "arena_p.h"
+#include "htable.h"
+#include "intern_p.h"
+#include "vstring.h"
+
+/*
+*   MACROS
+*/
+#define INTERN_TABLE_SIZE 1024	/* grows as needed */
+
+/*
+*   DATA DECLARATIONS
+*/
+struct sInternedString {
+	const char *escaped;		/* NULL until escapeInternedString() is called */
+	char str [1];
+};
+
+/*
+*   DATA DEFINITIONS
+*/
+static hashTable *InternTable;
+static arena *InternArena;
+
+/*
+*   FUNCTION DEFINITIONS
+*/
+
+static struct sInternedString *getInternedString (const char *const str)
+{
+	return (struct sInternedString *) (str - offsetof (struct sInternedString, str));
+}
+
+extern const char *internString (const char *const str)
+{
+	char *result;
+
+	if (InternTable == NULL)
+	{
+		InternTable = hashTableGrowableNew (INTERN_TABLE_SIZE,
+											hashCstrhash, hashCstreq, NULL, NULL);
+		InternArena = arenaNew ();
+	}
+	else if ((result = hashTableGetItem (InternTable, str)) != NULL)
+		return result;
+
+	const size_t length = strlen (str);
+	struct sInternedString *interned
+		= arenaAlloc (InternArena, offsetof (struct sInternedString, str) + length + 1);
+
+	interned->escaped = NULL;
+	memcpy (interned->str, str, length + 1);
+	result = interned->str;
+	hashTablePutItem (InternTable, result, result);
+	return result;
+}
+
+extern bool isInternedString (const char *const str)
+{
+	return InternArena && arenaOwns (InternArena, str);
+}
+
+extern const char *escapeInternedString (const char *const str)
+{
+	struct sInternedString *interned = getInternedString (str);
+
+	if (interned->escaped == NULL)
+	{
+		vString *escaped = vStringNew ();
+
+		vStringCatSWithEscaping (escaped, str);
+		if (strcmp (vStringValue (escaped), str) == 0)
+			interned->escaped = str;
+		else
+			interned->escaped = arenaStrdup (InternArena, vStringValue (escaped));
+		vStringDelete (escaped);
+	}
+	return interned->escaped;
+}
+
+extern void clearInternedStrings (void)
+{
+	if (InternTable)
+	{
+		hashTableClear (InternTable);
+		arenaClear (InternArena);
+	}
+}
+
+extern void freeInternResources (void)
+{
+	if (InternTable)
+	{
+		hashTableDelete (InternTable);
+		InternTable = NULL;
+		arenaDelete (InternArena);
+		InternArena = NULL;
+	}
+}
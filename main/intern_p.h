@@ -0,0 +1,35 @@
+/*
+*   Copyright (c) 2026, Universal Ctags Team
+*
+*   This source code is released for free distribution under the terms of the
+*   GNU General Public License version 2 or (at your option) any later version.
+*
+*   Defines private interface to the pool of interned strings.
+*/
+#ifndef CTAGS_MAIN_INTERN_PRIVATE_H
+#define CTAGS_MAIN_INTERN_PRIVATE_H
+
+/*
+*   INCLUDE FILES
+*/
+#include "general.h"  /* must always come first */
+
+/*
+*   FUNCTION PROTOTYPES
+*/
+
+/* Return the string in the pool equal to STR, adding a copy of STR to
+ * the pool if there is none. Two interned strings are equal if and only
+ * if they are the same pointer. Interned strings must not be modified or
+ * freed; all of them are released at once with clearInternedStrings(). */
+extern const char *internString (const char *const str);
+extern bool isInternedString (const char *const str);
+
+/* Return STR escaped with vStringCatSWithEscaping(). The escaped string
+ * is computed once for each interned string. */
+extern const char *escapeInternedString (const char *const str);
+
+extern void clearInternedStrings (void);
+extern void freeInternResources (void);
+
+#endif  /* CTAGS_MAIN_INTERN_PRIVATE_H */
@@ -0,0 +1,435 @@
+/*
+*   Copyright (c) 2026, Universal Ctags Team
+*
+*   This source code is released for free distribution under the terms of the
+*   GNU General Public License version 2 or (at your option) any later version.
+*
+*   This module runs parsers for input files in worker processes
+*   (--jobs=N).
+*
+*   The main process queues the input files found while traversing
+*   the command line arguments. When the queue is flushed, N worker
+*   processes are forked. They take input files from a pipe one by
+*   one, and write the tag output for them to their own temporary
+*   files. After all workers exit, the main process copies the
+*   tag output to the tag file in the order the input files were
+*   queued. As a result, the tag file is the same as the one made
+*   without --jobs option.
+*
+*   The parser specific pseudo tags are emitted only once, before the
+*   tags made by the parser for the first time. A worker cannot know
+*   whether another worker already used a parser. So a worker just
+*   notes the position where the pseudo tags may be emitted, and the
+*   main process emits them at the position while merging.
+*/
+
+/*
+*   INCLUDE FILES
+*/
+#include "general.h"  /* must always come first */
+
+#include "jobs_p.h"
+
+#ifdef JOBS_SUPPORTED
+#include <errno.h>
+#include <signal.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#ifdef HAVE_SYS_TYPES_H
+# include <sys/types.h>
+#endif
+#include <sys/wait.h>
+#endif
+
+#include "debug.h"
+#include "entry_p.h"
+#include "error_p.h"
+#include "mio.h"
+#include "options_p.h"
+#include "parse_p.h"
+#include "routines.h"
+#include "routines_p.h"
+#include "stats_p.h"
+#include "strlist.h"
+
+/*
+*   DATA DECLARATIONS
+*/
+
+/* Written by a worker for each input file it parses. */
+struct jobRecord {
+	unsigned int index;			/* index of the input file in the queue */
+	long start, end;			/* range in the tag output of the worker */
+	unsigned long tags;
+	size_t maxTagName, maxTagLine;
+	long files, lines, bytes;	/* for --totals */
+	unsigned long cacheHits, cacheMisses;
+	unsigned long dedupHits, dedupMisses;
+	unsigned long heapAllocations, arenaAllocations;
+	bool resize;
+	bool profiled;				/* for --totals=json */
+	fileProfile profile;
+	phaseTimes phases;
+	unsigned int markCount;		/* the number of ptagMarks following the record */
+};
+
+struct ptagMark {
+	long offset;				/* offset in the tag output of the worker */
+	langType language;
+};
+
+struct worker {
+	pid_t pid;
+	char *tagFileName;
+	char *recordFileName;
+};
+
+/*
+*   DATA DEFINITIONS
+*/
+static stringList *JobQueue;
+
+static bool InWorker;
+static MIO *WorkerTagMio;
+static struct ptagMark *Marks;
+static unsigned int MarkCount;
+static unsigned int MarkAllocated;
+
+/*
+*   FUNCTION DEFINITIONS
+*/
+
+extern bool isJobQueueEnabled (void)
+{
+#ifdef JOBS_SUPPORTED
+	return (Option.jobs > 1
+			&& ! InWorker
+			&& ! Option.filter
+			&& ! Option.interactive
+			&& ! Option.printLanguage
+			/* The time spent in regex patterns is kept in the parsers. */
+			&& ! Option.profileRegex
+			&& ! Option.traceEvents);
+#else
+	return false;
+#endif
+}
+
+extern void queueJob (const char *const fileName)
+{
+	if (JobQueue == NULL)
+		JobQueue = stringListNew ();
+	stringListAdd (JobQueue, vStringNewInit (fileName));
+}
+
+extern bool isJobWorker (void)
+{
+	return InWorker;
+}
+
+extern void notePseudoTagsPositionInJob (const langType language)
+{
+	for (unsigned int i = 0; i < MarkCount; i++)
+		if (Marks [i].language == language)
+			return;
+
+	if (MarkCount == MarkAllocated)
+	{
+		MarkAllocated = MarkAllocated? MarkAllocated * 2: 4;
+		Marks = xRealloc (Marks, MarkAllocated, struct ptagMark);
+	}
+	Marks [MarkCount].offset = mio_tell (WorkerTagMio);
+	Marks [MarkCount].language = language;
+	MarkCount++;
+}
+
+#ifdef JOBS_SUPPORTED
+static void writeOrDie (MIO *mio, const void *ptr, size_t size, size_t nmemb)
+{
+	if (mio_write (mio, ptr, size, nmemb) != nmemb)
+		error (FATAL | PERROR, "cannot write the output of a worker process");
+}
+
+static void runWorker (int fd, MIO *tagMio, MIO *recordMio)
+{
+	unsigned int index;
+	ssize_t r;
+	fileProfile profile;
+
+	InWorker = true;
+	WorkerTagMio = tagMio;
+	replaceTagFileMio (tagMio);
+	/* Drop the profile of a file parsed by the main process. */
+	takeLastFileProfile (&profile);
+
+	while ((r = read (fd, &index, sizeof (index))) != 0)
+	{
+		struct jobRecord record;
+		unsigned long tags = numTagsAdded ();
+		long files, lines, bytes;
+		unsigned long cacheHits, cacheMisses;
+		unsigned long dedupHits, dedupMisses;
+		unsigned long heapAllocations, arenaAllocations;
+		phaseTimes phases;
+
+		if (r == -1 && errno == EINTR)
+			continue;
+		else if (r != sizeof (index))
+			error (FATAL | PERROR, "cannot receive a job");
+
+		getTotals (&files, &lines, &bytes);
+		getTagCacheTotals (&cacheHits, &cacheMisses);
+		getDedupTotals (&dedupHits, &dedupMisses);
+		getAllocationTotals (&heapAllocations, &arenaAllocations);
+		getPhaseTimes (&phases);
+		MarkCount = 0;
+
+		memset (&record, 0, sizeof (record));
+		record.index = index;
+		record.start = mio_tell (tagMio);
+		record.resize = parseFile (vStringValue (stringListItem (JobQueue, index)));
+		record.end = mio_tell (tagMio);
+		record.tags = numTagsAdded () - tags;
+		getMaxTagLengths (&record.maxTagName, &record.maxTagLine);
+		getTotals (&record.files, &record.lines, &record.bytes);
+		record.files -= files;
+		record.lines -= lines;
+		record.bytes -= bytes;
+		getTagCacheTotals (&record.cacheHits, &record.cacheMisses);
+		record.cacheHits -= cacheHits;
+		record.cacheMisses -= cacheMisses;
+		getDedupTotals (&record.dedupHits, &record.dedupMisses);
+		record.dedupHits -= dedupHits;
+		record.dedupMisses -= dedupMisses;
+		getAllocationTotals (&record.heapAllocations, &record.arenaAllocations);
+		record.heapAllocations -= heapAllocations;
+		record.arenaAllocations -= arenaAllocations;
+		record.profiled = takeLastFileProfile (&record.profile);
+		getPhaseTimes (&record.phases);
+		for (unsigned int i = 0; i < PHASE_COUNT; i++)
+		{
+			record.phases.wall [i] -= phases.wall [i];
+			record.phases.cpu [i] -= phases.cpu [i];
+		}
+		record.markCount = MarkCount;
+
+		writeOrDie (recordMio, &record, sizeof (record), 1);
+		if (MarkCount > 0)
+			writeOrDie (recordMio, Marks, sizeof (*Marks), MarkCount);
+	}
+
+	if (mio_unref (tagMio) != 0 || mio_unref (recordMio) != 0)
+		error (FATAL | PERROR, "cannot close the output of a worker process");
+
+	/* Don't run the clean up code of the main process. */
+	fflush (stderr);
+	_exit (0);
+}
+
+static void sendJobs (int fd, unsigned int count)
+{
+	void (* sigpipe) (int) = signal (SIGPIPE, SIG_IGN);
+
+	for (unsigned int index = 0; index < count; index++)
+	{
+		ssize_t r = write (fd, &index, sizeof (index));
+
+		if (r == -1 && errno == EINTR)
+			index--;
+		else if (r != sizeof (index))
+			/* All workers are gone. */
+			break;
+	}
+
+	signal (SIGPIPE, sigpipe);
+}
+
+static bool mergeJobOutputs (struct worker *workers, unsigned int workerCount,
+							 unsigned int count)
+{
+	struct jobRecord *records = xCalloc (count, struct jobRecord);
+	struct ptagMark **marks = xCalloc (count, struct ptagMark *);
+	MIO **tagMios = xCalloc (workerCount, MIO *);
+	unsigned int *owners = xMalloc (count, unsigned int);
+	bool resize = false;
+
+	for (unsigned int i = 0; i < count; i++)
+		owners [i] = workerCount;
+
+	for (unsigned int w = 0; w < workerCount; w++)
+	{
+		MIO *recordMio = mio_new_file (workers [w].recordFileName, "rb");
+		struct jobRecord record;
+
+		if (recordMio == NULL)
+			error (FATAL | PERROR, "cannot open the output of a worker process");
+
+		while (mio_read (recordMio, &record, sizeof (record), 1) == 1)
+		{
+			Assert (record.index < count);
+			records [record.index] = record;
+			owners [record.index] = w;
+			if (record.markCount > 0)
+			{
+				marks [record.index] = xMalloc (record.markCount, struct ptagMark);
+				if (mio_read (recordMio, marks [record.index],
+							  sizeof (struct ptagMark), record.markCount) != record.markCount)
+					error (FATAL, "broken output of a worker process");
+			}
+		}
+		mio_unref (recordMio);
+
+		tagMios [w] = mio_new_file (workers [w].tagFileName, "rb");
+		if (tagMios [w] == NULL)
+			error (FATAL | PERROR, "cannot open the output of a worker process");
+	}
+
+	for (unsigned int i = 0; i < count; i++)
+	{
+		struct jobRecord *record = records + i;
+		MIO *src;
+		long offset;
+
+		if (owners [i] == workerCount)
+			error (FATAL, "no worker process parsed \"%s\"",
+				   vStringValue (stringListItem (JobQueue, i)));
+
+		src = tagMios [owners [i]];
+		offset = record->start;
+		mio_seek (src, offset, SEEK_SET);
+
+		for (unsigned int m = 0; m < record->markCount; m++)
+		{
+			copyToTagFile (src, marks [i][m].offset - offset);
+			offset = marks [i][m].offset;
+			replayParserPseudoTags (marks [i][m].language);
+		}
+		copyToTagFile (src, record->end - offset);
+
+		setNumTagsAdded (numTagsAdded () + record->tags);
+		updateMaxTagLengths (record->maxTagName, record->maxTagLine);
+		addTotals ((unsigned int) record->files,
+				   (unsigned long) record->lines, (unsigned long) record->bytes);
+		addTagCacheTotals (record->cacheHits, record->cacheMisses);
+		addDedupTotals (record->dedupHits, record->dedupMisses);
+		addAllocationTotals (record->heapAllocations, record->arenaAllocations);
+		if (record->profiled)
+			addFileProfile (vStringValue (stringListItem (JobQueue, i)), &record->profile);
+		addPhaseTimes (&record->phases);
+		resize = record->resize || resize;
+		streamTagFile ();
+
+		if (marks [i])
+			eFree (marks [i]);
+	}
+
+	for (unsigned int w = 0; w < workerCount; w++)
+		mio_unref (tagMios [w]);
+
+	eFree (owners);
+	eFree (tagMios);
+	eFree (marks);
+	eFree (records);
+
+	return resize;
+}
+
+static bool runWorkers (unsigned int workerCount, unsigned int count)
+{
+	struct worker *workers = xCalloc (workerCount, struct worker);
+	bool failed = false;
+	bool resize = false;
+	int fds [2];
+
+	if (pipe (fds) == -1)
+		error (FATAL | PERROR, "cannot make a pipe for worker processes");
+
+	/* Nothing buffered should be inherited. */
+	flushTagFile ();
+	fflush (stdout);
+	fflush (stderr);
+
+	for (unsigned int w = 0; w < workerCount; w++)
+	{
+		MIO *tagMio = tempFile ("w+b", &workers [w].tagFileName);
+		MIO *recordMio = tempFile ("w+b", &workers [w].recordFileName);
+
+		workers [w].pid = fork ();
+		if (workers [w].pid == -1)
+			error (FATAL | PERROR, "cannot fork a worker process");
+		else if (workers [w].pid == 0)
+		{
+			close (fds [1]);
+			runWorker (fds [0], tagMio, recordMio);
+		}
+
+		mio_unref (tagMio);
+		mio_unref (recordMio);
+	}
+	close (fds [0]);
+
+	verbose ("tagging %u files with %u worker processes\n", count, workerCount);
+	statsPhase phase = switchPhase (PHASE_JOBS);
+	sendJobs (fds [1], count);
+	close (fds [1]);
+
+	for (unsigned int w = 0; w < workerCount; w++)
+	{
+		int status;
+
+		while (waitpid (workers [w].pid, &status, 0) == -1)
+		{
+			if (errno != EINTR)
+				error (FATAL | PERROR, "cannot wait for a worker process");
+		}
+		if (! WIFEXITED (status) || WEXITSTATUS (status) != 0)
+			failed = true;
+	}
+	switchPhase (phase);
+
+	if (! failed)
+		resize = mergeJobOutputs (workers, workerCount, count);
+
+	for (unsigned int w = 0; w < workerCount; w++)
+	{
+		remove (workers [w].tagFileName);
+		eFree (workers [w].tagFileName);
+		remove (workers [w].recordFileName);
+		eFree (workers [w].recordFileName);
+	}
+	eFree (workers);
+
+	if (failed)
+		error (FATAL, "a worker process failed");
+
+	return resize;
+}
+#endif
+
+/*  Parse all queued input files, and add the tags for them to the tag
+ *  file in the order they were queued. */
+extern bool runQueuedJobs (void)
+{
+	bool resize = false;
+	unsigned int count = JobQueue? stringListCount (JobQueue): 0;
+
+	if (count == 0)
+		return false;
+#ifdef JOBS_SUPPORTED
+	else if (count > 1)
+	{
+		unsigned int workerCount = (Option.jobs < count)? Option.jobs: count;
+		resize = runWorkers (workerCount, count);
+	}
+#endif
+	else
+	{
+		for (unsigned int i = 0; i < count; i++)
+			resize = parseFile (vStringValue (stringListItem (JobQueue, i))) || resize;
+	}
+
+	stringListDelete (JobQueue);
+	JobQueue = NULL;
+	return resize;
+}
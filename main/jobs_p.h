@@ -0,0 +1,35 @@
+/*
+*   Copyright (c) 2026, Universal Ctags Team
+*
+*   This source code is released for free distribution under the terms of the
+*   GNU General Public License version 2 or (at your option) any later version.
+*
+*   main part private interface to jobs.c
+*/
+#ifndef CTAGS_MAIN_JOBS_PRIVATE_H
+#define CTAGS_MAIN_JOBS_PRIVATE_H
+
+/*
+*   INCLUDE FILES
+*/
+#include "general.h"  /* must always come first */
+#include "types.h"
+
+/*
+*   MACROS
+*/
+#if defined (HAVE_FORK) && defined (HAVE_SYS_WAIT_H) && defined (HAVE_UNISTD_H)
+# define JOBS_SUPPORTED
+#endif
+
+/*
+*   FUNCTION PROTOTYPES
+*/
+extern bool isJobQueueEnabled (void);
+extern void queueJob (const char *const fileName);
+extern bool runQueuedJobs (void);
+
+extern bool isJobWorker (void);
+extern void notePseudoTagsPositionInJob (const langType language);
+
+#endif	/* CTAGS_MAIN_JOBS_PRIVATE_H */
@@ -5,6 +5,14 @@
 *   GNU General Public License version 2 or (at your option) any later version.
 *
 *   Manages a keyword hash.
+*
+*   All keywords are kept in a chained hash table shared by all languages.
+*   In addition, the keywords of a language added before the first lookup
+*   for the language, typically in the initializer of its parser, are
+*   indexed with a per-language minimal perfect hash (hash and displace).
+*   A lookup probes exactly one slot of it, after rejecting strings whose
+*   length or first character no keyword of the language has. The
+*   chained table serves the keywords added after that.
 */
 
 /*
@@ -14,11 +22,15 @@
 
 #include <string.h>
 #include <ctype.h>
+#include <stdint.h>
+#include <time.h>
 
+#include "bench_p.h"
 #include "debug.h"
 #include "keyword.h"
 #include "keyword_p.h"
 #include "parse.h"
+#include "parse_p.h"
 #include "routines.h"
 
 /*
@@ -31,12 +43,48 @@ typedef struct sHashEntry {
 	int value;
 } hashEntry;
 
+typedef struct sKeywordSlot {
+	const char *string;
+	size_t length;
+	uint32_t hash;
+	int value;
+} keywordSlot;
+
+typedef struct sLanguageKeywords {
+	/* Keywords waiting for the perfect hash */
+	keywordSlot *pending;
+	unsigned int pendingCount;
+	unsigned int pendingAllocated;
+
+	bool frozen;				/* the perfect hash is built */
+	unsigned int overflowCount;	/* keywords only in the chained table */
+
+	/* The perfect hash; slots is NULL if it could not be built. */
+	uint32_t seed;
+	unsigned int slotCount;
+	unsigned int bucketCount;
+	uint32_t *displacements;
+	keywordSlot *slots;
+
+	/* For rejecting a string quickly */
+	uint64_t lengths;			/* bit n for length n, bit 63 for longer ones */
+	unsigned char firstChars [256 / 8];
+} languageKeywords;
+
 /*
 *   DATA DEFINITIONS
 */
 static const unsigned int TableSize = 2039;  /* prime */
 static hashEntry **HashTable = NULL;
 
+static languageKeywords **LanguageKeywords = NULL;
+static unsigned int LanguageKeywordsCount = 0;
+static unsigned char LowerCase [256];
+
+#define KEYWORD_BUCKET_SIZE 4
+#define KEYWORD_SEED_TRIALS 16
+#define KEYWORD_DISPLACEMENT_TRIALS (1U << 20)
+
 /*
 *   FUNCTION DEFINITIONS
 */
@@ -100,12 +148,43 @@ static hashEntry *newEntry (
 	return entry;
 }
 
-/*  Note that it is assumed that a "value" of zero means an undefined keyword
- *  and clients of this function should observe this. Also, all keywords added
- *  should be added in lower case. If we encounter a case-sensitive language
- *  whose keywords are in upper case, we will need to redesign this.
- */
-extern void addKeyword (const char *const string, langType language, int value)
+static languageKeywords *getLanguageKeywords (langType language, bool create)
+{
+	Assert (language >= 0);
+
+	if ((unsigned int) language >= LanguageKeywordsCount)
+	{
+		if (! create)
+			return NULL;
+
+		unsigned int count = language + 1;
+		LanguageKeywords = xRealloc (LanguageKeywords, count, languageKeywords *);
+		memset (LanguageKeywords + LanguageKeywordsCount, 0,
+				sizeof (languageKeywords *) * (count - LanguageKeywordsCount));
+		LanguageKeywordsCount = count;
+	}
+
+	if (LanguageKeywords [language] == NULL && create)
+		LanguageKeywords [language] = xCalloc (1, languageKeywords);
+
+	return LanguageKeywords [language];
+}
+
+static void addPendingKeyword (languageKeywords *lk, const char *const string, int value)
+{
+	if (lk->pendingCount == lk->pendingAllocated)
+	{
+		lk->pendingAllocated = lk->pendingAllocated? lk->pendingAllocated * 2: 32;
+		lk->pending = xRealloc (lk->pending, lk->pendingAllocated, keywordSlot);
+	}
+
+	lk->pending [lk->pendingCount].string = string;
+	lk->pending [lk->pendingCount].length = strlen (string);
+	lk->pending [lk->pendingCount].value = value;
+	lk->pendingCount++;
+}
+
+static void addChainedKeyword (const char *const string, langType language, int value)
 {
 	const unsigned int index = hashValue (string, language) % TableSize;
 	hashEntry *entry = getHashTableEntry (index);
@@ -137,7 +216,269 @@ extern void addKeyword (const char *const string, langType language, int value)
 	}
 }
 
-static int lookupKeywordFull (const char *const string, bool caseSensitive, langType language)
+/*  Note that it is assumed that a "value" of zero means an undefined keyword
+ *  and clients of this function should observe this. Also, all keywords added
+ *  should be added in lower case. If we encounter a case-sensitive language
+ *  whose keywords are in upper case, we will need to redesign this.
+ */
+extern void addKeyword (const char *const string, langType language, int value)
+{
+	languageKeywords *lk = getLanguageKeywords (language, true);
+
+	addChainedKeyword (string, language, value);
+
+	if (lk->frozen)
+		lk->overflowCount++;
+	else
+		addPendingKeyword (lk, string, value);
+}
+
+static void initLowerCase (void)
+{
+	if (LowerCase ['A'] == 'a')
+		return;
+	for (unsigned int c = 0; c < 256; c++)
+		LowerCase [c] = (unsigned char) tolower ((int) c);
+}
+
+/* The "djb" hash over the lower-cased string, started from SEED.
+ * *LENGTH is set to the length of STRING. */
+static uint32_t perfectHashValue (const char *const string, uint32_t seed, size_t *length)
+{
+	const unsigned char *p;
+	uint32_t h = 5381 + seed * 0x9e3779b9U;
+
+	for (p = (const unsigned char *)string; *p != '\0'; p++)
+		h = (h << 5) + h + LowerCase [*p];
+
+	*length = p - (const unsigned char *)string;
+	return h;
+}
+
+/* Map H to [0, N) without a division. */
+static unsigned int reduceHash (uint32_t h, unsigned int n)
+{
+	return (unsigned int) (((uint64_t) h * n) >> 32);
+}
+
+static unsigned int perfectHashBucket (uint32_t h, unsigned int bucketCount)
+{
+	return reduceHash (h * 0x9e3779b9U, bucketCount);
+}
+
+static unsigned int perfectHashSlot (uint32_t h, uint32_t displacement, unsigned int slotCount)
+{
+	return reduceHash ((h ^ displacement) * 0x85ebca6bU, slotCount);
+}
+
+static uint64_t lengthBit (size_t length)
+{
+	return (uint64_t) 1 << ((length < 63)? length: 63);
+}
+
+/* Place the keywords in KEYS to LK->slots with hash and displace:
+ * keywords are distributed to buckets by their hash values, and for each
+ * bucket, from the largest one, a displacement that moves all its
+ * keywords to free slots is searched. */
+static bool buildPerfectHash (languageKeywords *lk,
+							  const keywordSlot *keys, const uint32_t *hashes,
+							  unsigned int count)
+{
+	unsigned int bucketCount = count / KEYWORD_BUCKET_SIZE + 1;
+	unsigned int *bucketSizes = xCalloc (bucketCount, unsigned int);
+	unsigned int *bucketStarts = xCalloc (bucketCount + 1, unsigned int);
+	unsigned int *members = xMalloc (count, unsigned int);
+	unsigned int *order = xMalloc (bucketCount, unsigned int);
+	unsigned int *placed = xMalloc (KEYWORD_BUCKET_SIZE * 8, unsigned int);
+	unsigned int placedAllocated = KEYWORD_BUCKET_SIZE * 8;
+	bool *used = xCalloc (count, bool);
+	bool success = true;
+
+	lk->displacements = xCalloc (bucketCount, uint32_t);
+	lk->slots = xCalloc (count, keywordSlot);
+	lk->bucketCount = bucketCount;
+	lk->slotCount = count;
+
+	for (unsigned int i = 0; i < count; i++)
+		bucketSizes [perfectHashBucket (hashes [i], bucketCount)]++;
+	for (unsigned int b = 0; b < bucketCount; b++)
+		bucketStarts [b + 1] = bucketStarts [b] + bucketSizes [b];
+	for (unsigned int b = 0; b < bucketCount; b++)
+		bucketSizes [b] = 0;
+	for (unsigned int i = 0; i < count; i++)
+	{
+		unsigned int b = perfectHashBucket (hashes [i], bucketCount);
+		members [bucketStarts [b] + bucketSizes [b]++] = i;
+	}
+
+	/* Larger buckets first; a counting sort is enough. */
+	unsigned int n = 0;
+	for (unsigned int size = count; size > 0 && n < bucketCount; size--)
+	{
+		for (unsigned int b = 0; b < bucketCount; b++)
+			if (bucketSizes [b] == size)
+				order [n++] = b;
+	}
+
+	for (unsigned int o = 0; o < n && success; o++)
+	{
+		unsigned int b = order [o];
+		unsigned int size = bucketSizes [b];
+		uint32_t d;
+
+		if (size > placedAllocated)
+		{
+			placedAllocated = size;
+			placed = xRealloc (placed, placedAllocated, unsigned int);
+		}
+
+		for (d = 0; d < KEYWORD_DISPLACEMENT_TRIALS; d++)
+		{
+			unsigned int k;
+
+			for (k = 0; k < size; k++)
+			{
+				unsigned int i = members [bucketStarts [b] + k];
+				unsigned int slot = perfectHashSlot (hashes [i], d, count);
+				unsigned int j;
+
+				if (used [slot])
+					break;
+				for (j = 0; j < k; j++)
+					if (placed [j] == slot)
+						break;
+				if (j < k)
+					break;
+				placed [k] = slot;
+			}
+			if (k == size)
+				break;
+		}
+
+		if (d == KEYWORD_DISPLACEMENT_TRIALS)
+			success = false;
+		else
+		{
+			lk->displacements [b] = d;
+			for (unsigned int k = 0; k < size; k++)
+			{
+				used [placed [k]] = true;
+				unsigned int i = members [bucketStarts [b] + k];
+				lk->slots [placed [k]] = keys [i];
+				lk->slots [placed [k]].hash = hashes [i];
+			}
+		}
+	}
+
+	eFree (used);
+	eFree (placed);
+	eFree (order);
+	eFree (members);
+	eFree (bucketStarts);
+	eFree (bucketSizes);
+
+	if (! success)
+	{
+		eFree (lk->displacements);
+		lk->displacements = NULL;
+		eFree (lk->slots);
+		lk->slots = NULL;
+	}
+	return success;
+}
+
+static void freezeLanguageKeywords (languageKeywords *lk)
+{
+	unsigned int count = lk->pendingCount;
+	keywordSlot *keys = xMalloc (count, keywordSlot);
+	uint32_t *hashes = xMalloc (count, uint32_t);
+	uint32_t seed;
+
+	initLowerCase ();
+	lk->frozen = true;
+
+	for (seed = 0; seed < KEYWORD_SEED_TRIALS; seed++)
+	{
+		unsigned int n = 0;
+
+		/* A keyword differing from an earlier one only in case cannot
+		 * be in the perfect hash; the chained table has it. */
+		lk->overflowCount = 0;
+		for (unsigned int i = 0; i < count; i++)
+		{
+			size_t length;
+			uint32_t h = perfectHashValue (lk->pending [i].string, seed, &length);
+			unsigned int j;
+
+			for (j = 0; j < n; j++)
+				if (hashes [j] == h && strcasecmp (keys [j].string, lk->pending [i].string) == 0)
+					break;
+			if (j < n)
+			{
+				lk->overflowCount++;
+				continue;
+			}
+			keys [n] = lk->pending [i];
+			hashes [n] = h;
+			n++;
+		}
+
+		if (n == 0 || buildPerfectHash (lk, keys, hashes, n))
+			break;
+	}
+
+	if (seed < KEYWORD_SEED_TRIALS && lk->slots)
+	{
+		lk->seed = seed;
+		for (unsigned int i = 0; i < lk->slotCount; i++)
+		{
+			unsigned char c = (unsigned char) lk->slots [i].string [0];
+
+			lk->lengths |= lengthBit (lk->slots [i].length);
+			lk->firstChars [tolower (c) / 8] |= 1 << (tolower (c) % 8);
+			lk->firstChars [toupper (c) / 8] |= 1 << (toupper (c) % 8);
+		}
+	}
+	else
+		lk->overflowCount = count;
+
+	eFree (hashes);
+	eFree (keys);
+	if (lk->pending)
+		eFree (lk->pending);
+	lk->pending = NULL;
+	lk->pendingCount = 0;
+	lk->pendingAllocated = 0;
+}
+
+static int lookupPerfectKeyword (const languageKeywords *lk,
+								 const char *const string, bool caseSensitive)
+{
+	const unsigned char c = (unsigned char) string [0];
+	const keywordSlot *slot;
+	size_t length;
+	uint32_t h;
+
+	if (! (lk->firstChars [c / 8] & (1 << (c % 8))))
+		return KEYWORD_NONE;
+
+	h = perfectHashValue (string, lk->seed, &length);
+	if (! (lk->lengths & lengthBit (length)))
+		return KEYWORD_NONE;
+
+	slot = lk->slots + perfectHashSlot (h, lk->displacements [perfectHashBucket (h, lk->bucketCount)],
+										lk->slotCount);
+	if (slot->hash == h
+		&& slot->length == length
+		&& (caseSensitive
+			? strcmp (string, slot->string) == 0
+			: strcasecmp (string, slot->string) == 0))
+		return slot->value;
+
+	return KEYWORD_NONE;
+}
+
+static int lookupChainedKeyword (const char *const string, bool caseSensitive, langType language)
 {
 	const unsigned int index = hashValue (string, language) % TableSize;
 	hashEntry *entry = getHashTableEntry (index);
@@ -157,6 +498,26 @@ static int lookupKeywordFull (const char *const string, bool caseSensitive, lang
 	return result;
 }
 
+static int lookupKeywordFull (const char *const string, bool caseSensitive, langType language)
+{
+	languageKeywords *lk = getLanguageKeywords (language, false);
+
+	if (lk == NULL)
+		return KEYWORD_NONE;
+
+	if (! lk->frozen)
+		freezeLanguageKeywords (lk);
+
+	if (lk->slots)
+	{
+		int result = lookupPerfectKeyword (lk, string, caseSensitive);
+		if (result != KEYWORD_NONE || lk->overflowCount == 0)
+			return result;
+	}
+
+	return lookupChainedKeyword (string, caseSensitive, language);
+}
+
 extern int lookupKeyword (const char *const string, langType language)
 {
 	return lookupKeywordFull (string, true, language);
@@ -186,6 +547,23 @@ extern void freeKeywordTable (void)
 		}
 		eFree (HashTable);
 	}
+
+	for (unsigned int i = 0; i < LanguageKeywordsCount; i++)
+	{
+		languageKeywords *lk = LanguageKeywords [i];
+
+		if (lk == NULL)
+			continue;
+		if (lk->pending)
+			eFree (lk->pending);
+		if (lk->displacements)
+			eFree (lk->displacements);
+		if (lk->slots)
+			eFree (lk->slots);
+		eFree (lk);
+	}
+	if (LanguageKeywords)
+		eFree (LanguageKeywords);
 }
 
 #ifdef DEBUG
@@ -257,20 +635,109 @@ extern void dumpKeywordTable (FILE *fp)
 	}
 }
 
+struct keywordBench {
+	const char **probes;
+	unsigned int count;
+	unsigned int rounds;
+	langType language;
+};
+
+/* Variant 0 is the perfect hash, and variant 1 is the chained table. */
+static double benchKeywordLookups (unsigned int variant, void *data)
+{
+	struct keywordBench *bench = data;
+	languageKeywords *lk = LanguageKeywords [bench->language];
+	volatile int sink = 0;
+	clock_t start = clock ();
+
+	for (unsigned int r = 0; r < bench->rounds; r++)
+	{
+		for (unsigned int i = 0; i < bench->count; i++)
+		{
+			if (variant == 0)
+				sink += lookupPerfectKeyword (lk, bench->probes [i], true);
+			else
+				sink += lookupChainedKeyword (bench->probes [i], true, bench->language);
+		}
+	}
+
+	(void) sink;
+	return benchRate (start, bench->count * (double) bench->rounds);
+}
+
+/* Measure the lookup rate of the keywords of each language, and of the
+ * strings made by adding a character before or after them, for the
+ * perfect hash and for the chained table. */
+extern void benchKeywordTable (FILE *fp)
+{
+	for (unsigned int language = 0; language < LanguageKeywordsCount; language++)
+	{
+		languageKeywords *lk = LanguageKeywords [language];
+
+		if (lk == NULL)
+			continue;
+		if (! lk->frozen)
+			freezeLanguageKeywords (lk);
+		if (lk->slots == NULL)
+			continue;
+
+		unsigned int count = lk->slotCount * 3;
+		const char **probes = xMalloc (count, const char *);
+		char **made = xMalloc (lk->slotCount * 2, char *);
+
+		for (unsigned int i = 0; i < lk->slotCount; i++)
+		{
+			const keywordSlot *slot = lk->slots + i;
+
+			made [i * 2] = xMalloc (slot->length + 2, char);
+			made [i * 2][0] = '_';
+			memcpy (made [i * 2] + 1, slot->string, slot->length + 1);
+
+			made [i * 2 + 1] = xMalloc (slot->length + 2, char);
+			memcpy (made [i * 2 + 1], slot->string, slot->length);
+			made [i * 2 + 1][slot->length] = '_';
+			made [i * 2 + 1][slot->length + 1] = '\0';
+
+			probes [i * 3] = slot->string;
+			probes [i * 3 + 1] = made [i * 2];
+			probes [i * 3 + 2] = made [i * 2 + 1];
+		}
+
+		struct keywordBench bench = {
+			.probes = probes,
+			.count = count,
+			.rounds = 1000000 / count + 1,
+			.language = language,
+		};
+		double rates [2];
+		benchBestOfRuns (benchKeywordLookups, &bench, 2, 3, rates);
+
+		fprintf (fp, "%-16s %5u keywords %12.0f lookups/s (perfect hash) %12.0f lookups/s (chained hash)\n",
+				 getLanguageName (language), lk->slotCount, rates [0], rates [1]);
+
+		for (unsigned int i = 0; i < lk->slotCount * 2; i++)
+			eFree (made [i]);
+		eFree (made);
+		eFree (probes);
+	}
+}
+
 extern void addKeywordGroup (const struct keywordGroup *const groupdef,
 							 langType language)
 {
 	for (int i = 0; groupdef->keywords[i]; i++)
 	{
+		/* Looking up the chained table doesn't freeze the keywords
+		 * of the language. */
 		if (groupdef->addingUnlessExisting)
 		{
-			if (lookupKeyword (groupdef->keywords[i],
-							   language) != KEYWORD_NONE)
+			if (lookupChainedKeyword (groupdef->keywords[i], true,
+									  language) != KEYWORD_NONE)
 				continue;		/* already added */
 		}
 		else
-			Assert (lookupKeyword (groupdef->keywords[i],
-								   language) == KEYWORD_NONE);
+			Assert (lookupChainedKeyword (groupdef->keywords[i], true,
+										  language) == KEYWORD_NONE);
 		addKeyword (groupdef->keywords[i], language, groupdef->value);
 	}
 }
@@ -18,6 +18,7 @@
 extern void freeKeywordTable (void);
 
 extern void dumpKeywordTable (FILE *fp);
+extern void benchKeywordTable (FILE *fp);
 
 #ifdef DEBUG
 extern void printKeywordTable (void);
@@ -41,6 +41,7 @@
 #include "read_p.h"
 #include "routines.h"
 #include "routines_p.h"
+#include "stats_p.h"
 #include "trashbox.h"
 #include "xtag_p.h"
 
@@ -165,6 +166,10 @@ typedef struct {
 
 	char *pattern_string;
 
+	/* A string which every line matching a single line pattern
+	 * contains, in lower case. NULL if none is known. */
+	char *literal;
+
 	char *anonymous_tag_prefix;
 
 	struct {
@@ -184,6 +189,8 @@ typedef struct {
 	struct {
 		unsigned int match;
 		unsigned int unmatch;
+		unsigned int skip;		/* regexec() calls avoided by the prefilter */
+		double time;			/* seconds spent in regexec(), with --_profile-regex */
 	} statistics;
 } regexTableEntry;
 
@@ -206,9 +213,30 @@ struct guestRequest {
 	struct boundaryInRequest boundary[2];
 };
 
+/* An Aho-Corasick automaton finding the literals of single line
+ * patterns in a line. A pattern having a literal is tried only if the
+ * literal is found in the line. */
+struct literalPrefilter {
+	unsigned int literalCount;
+	unsigned char classes [256];	/* byte -> class; 0 for bytes not in literals */
+	unsigned int classCount;
+	unsigned int *next;				/* state * classCount + class -> state */
+	int *output;					/* state -> head of the output chain, or -1 */
+	struct literalOutput {
+		unsigned int entryIndex;
+		int next;
+	} *outputs;
+
+	unsigned int entryCount;
+	/* entry index -> generation of the last line in which the literal is found */
+	unsigned int *candidates;
+	unsigned int generation;
+};
+
 struct lregexControlBlock {
 	int currentScope;
 	ptrArray *entries [2];
+	struct literalPrefilter *prefilter; /* for entries [REG_PARSER_SINGLE_LINE] */
 
 	ptrArray *tables;
 	ptrArray *tstack;
@@ -227,6 +255,7 @@ struct lregexControlBlock {
 */
 static int getTableIndexForName (const struct lregexControlBlock *const lcb, const char *name);
 static void deletePattern (regexPattern *p);
+static void invalidateLiteralPrefilter (struct lregexControlBlock *lcb);
 static int  makePromiseForAreaSpecifiedWithOffsets (const char *parser,
 													off_t startOffset,
 													off_t endOffset);
@@ -279,6 +308,9 @@ static void deletePattern (regexPattern *p)
 
 	eFree (p->pattern_string);
 
+	if (p->literal)
+		eFree (p->literal);
+
 	if (p->message.message_string)
 		eFree (p->message.message_string);
 
@@ -290,6 +322,7 @@ static void deletePattern (regexPattern *p)
 
 static void clearPatternSet (struct lregexControlBlock *lcb)
 {
+	invalidateLiteralPrefilter (lcb);
 	ptrArrayClear (lcb->entries [REG_PARSER_SINGLE_LINE]);
 	ptrArrayClear (lcb->entries [REG_PARSER_MULTI_LINE]);
 	ptrArrayClear (lcb->tables);
@@ -607,7 +640,11 @@ static regexPattern* addCompiledTagCommon (struct lregexControlBlock *lcb,
 		ptrArrayAdd (table->entries, entry);
 	}
 	else
+	{
 		ptrArrayAdd (lcb->entries[regptype], entry);
+		if (regptype == REG_PARSER_SINGLE_LINE)
+			invalidateLiteralPrefilter (lcb);
+	}
 
 	useRegexMethod(lcb->owner);
 
@@ -1333,6 +1370,216 @@ static regex_t* compileRegex (enum regexParserType regptype,
 	return result;
 }
 
+static bool skipBracketExpression (const char **pp)
+{
+	const char *p = *pp + 1;
+
+	if (*p == '^')
+		p++;
+	if (*p == ']')
+		p++;
+
+	while (*p != ']')
+	{
+		if (*p == '\0')
+			return false;
+		else if (*p == '[' && (p[1] == ':' || p[1] == '.' || p[1] == '='))
+		{
+			const char *end = p + 2;
+
+			while (! (end[0] == p[1] && end[1] == ']'))
+			{
+				if (*end == '\0')
+					return false;
+				end++;
+			}
+			p = end + 2;
+		}
+		else
+			p++;
+	}
+
+	*pp = p + 1;
+	return true;
+}
+
+static bool skipGroup (const char **pp, bool extended)
+{
+	const char *p = *pp;
+	int depth = 1;
+
+	while (depth > 0)
+	{
+		if (*p == '\0')
+			return false;
+		else if (*p == '[')
+		{
+			if (!skipBracketExpression (&p))
+				return false;
+			continue;
+		}
+		else if (*p == '\\')
+		{
+			if (p[1] == '\0')
+				return false;
+			if (!extended && p[1] == '(')
+				depth++;
+			else if (!extended && p[1] == ')')
+				depth--;
+			p++;
+		}
+		else if (extended && *p == '(')
+			depth++;
+		else if (extended && *p == ')')
+			depth--;
+		p++;
+	}
+
+	*pp = p;
+	return true;
+}
+
+/* Skip the quantifiers after an atom. Return false for a broken one.
+ * *optional is set if the atom may not appear; *repeated is set if the
+ * atom may appear more than once. */
+static bool skipQuantifiers (const char **pp, bool extended,
+							 bool *optional, bool *repeated)
+{
+	const char *p = *pp;
+
+	*optional = false;
+	*repeated = false;
+
+	while (true)
+	{
+		const char *q = p;
+
+		if (!extended && *q == '\\')
+			q++;
+
+		if ((extended || q != p) && *q == '{')
+		{
+			/* Any interval is treated as optional. */
+			const char *end = strstr (q, extended? "}": "\\}");
+			if (end == NULL)
+				return false;
+			*optional = true;
+			p = end + (extended? 1: 2);
+		}
+		else if ((q == p) && *q == '*')
+		{
+			*optional = true;
+			p = q + 1;
+		}
+		else if ((extended == (q == p)) && *q == '?')
+		{
+			*optional = true;
+			p = q + 1;
+		}
+		else if ((extended == (q == p)) && *q == '+')
+		{
+			*repeated = true;
+			p = q + 1;
+		}
+		else
+			break;
+	}
+
+	*pp = p;
+	return true;
+}
+
+static void keepLongerLiteral (vString *run, vString *longest)
+{
+	if (vStringLength (run) > vStringLength (longest))
+		vStringCopy (longest, run);
+	vStringClear (run);
+}
+
+/* Return the longest string which every line matching REGEXP contains,
+ * in lower case, or NULL if no such string is found.
+ * This doesn't have to understand the whole syntax: a construct not known
+ * here just ends a run of literal chars. Alternation at the top level
+ * gives up because no string is mandatory for it. */
+static char *extractRequiredLiteral (const char *const regexp, const char *const flags)
+{
+	int cflags = REG_EXTENDED;
+	bool extended;
+	const char *p = regexp;
+	vString *run = vStringNew ();
+	vString *longest = vStringNew ();
+	char *literal = NULL;
+
+	flagsEval (flags, regexFlagDefs, ARRAY_SIZE(regexFlagDefs), &cflags);
+	extended = !!(cflags & REG_EXTENDED);
+
+	while (*p != '\0')
+	{
+		int c = -1;				/* the literal char of the atom, or -1 */
+		bool optional, repeated;
+
+		if (*p == '\\')
+		{
+			unsigned char d = (unsigned char) p[1];
+
+			if (d == '\0' || d == '|')
+				goto out;
+			else if (!extended && d == '(')
+			{
+				p += 2;
+				if (!skipGroup (&p, false))
+					goto out;
+			}
+			else if (!extended && strchr (")}{+?", d))
+				goto out;
+			else
+			{
+				if (!isalnum (d) && !strchr ("<>`'", d))
+					c = d;
+				p += 2;
+			}
+		}
+		else if (extended && *p == '(')
+		{
+			p++;
+			if (!skipGroup (&p, true))
+				goto out;
+		}
+		else if ((extended && strchr ("|)*+?{", *p))
+				 || (!extended && *p == '*'))
+			goto out;
+		else if (*p == '[')
+		{
+			if (!skipBracketExpression (&p))
+				goto out;
+		}
+		else if (*p == '.' || *p == '^' || *p == '$')
+			p++;
+		else
+			c = (unsigned char) *p++;
+
+		if (!skipQuantifiers (&p, extended, &optional, &repeated))
+			goto out;
+
+		if (c == -1 || optional)
+			keepLongerLiteral (run, longest);
+		else
+		{
+			vStringPut (run, tolower (c));
+			if (repeated)
+				keepLongerLiteral (run, longest);
+		}
+	}
+	keepLongerLiteral (run, longest);
+
+	if (vStringLength (longest) > 0)
+		literal = vStringStrdup (longest);
+ out:
+	vStringDelete (run);
+	vStringDelete (longest);
+	return literal;
+}
+
 
 /* If a letter and/or a name are defined in kindSpec, return true. */
 static bool parseKinds (
@@ -1681,9 +1928,185 @@ static bool fillGuestRequest (const char *start,
 	return guestRequestIsFilled (guest_req);
 }
 
+static void deleteLiteralPrefilter (struct literalPrefilter *prefilter)
+{
+	eFree (prefilter->next);
+	eFree (prefilter->output);
+	if (prefilter->outputs)
+		eFree (prefilter->outputs);
+	eFree (prefilter->candidates);
+	eFree (prefilter);
+}
+
+static void invalidateLiteralPrefilter (struct lregexControlBlock *lcb)
+{
+	if (lcb->prefilter)
+	{
+		deleteLiteralPrefilter (lcb->prefilter);
+		lcb->prefilter = NULL;
+	}
+}
+
+static struct literalPrefilter *newLiteralPrefilter (ptrArray *entries)
+{
+	struct literalPrefilter *prefilter = xCalloc (1, struct literalPrefilter);
+	unsigned int entryCount = ptrArrayCount (entries);
+	unsigned int maxStates = 1;
+	unsigned int stateCount = 1;
+	unsigned int *fail;
+	unsigned int *queue;
+	unsigned int head, tail;
+
+	prefilter->classCount = 1;
+	for (unsigned int i = 0; i < entryCount; i++)
+	{
+		regexTableEntry *entry = ptrArrayItem (entries, i);
+		const char *literal = entry->pattern->literal;
+
+		if (literal == NULL)
+			continue;
+
+		prefilter->literalCount++;
+		for (const unsigned char *c = (const unsigned char *)literal; *c; c++)
+		{
+			maxStates++;
+			if (prefilter->classes [*c] == 0)
+			{
+				/* The literals are in lower case; the line is not. */
+				prefilter->classes [*c] = prefilter->classCount;
+				prefilter->classes [toupper (*c)] = prefilter->classCount;
+				prefilter->classCount++;
+			}
+		}
+	}
+
+	/* Make a trie of the literals. 0 in next means no transition yet,
+	 * because nothing goes back to the root state 0 in a trie. */
+	prefilter->next = xCalloc (maxStates * prefilter->classCount, unsigned int);
+	prefilter->output = xMalloc (maxStates, int);
+	for (unsigned int s = 0; s < maxStates; s++)
+		prefilter->output [s] = -1;
+	if (prefilter->literalCount > 0)
+		prefilter->outputs = xMalloc (prefilter->literalCount, struct literalOutput);
+	prefilter->entryCount = entryCount;
+	prefilter->candidates = xCalloc (entryCount? entryCount: 1, unsigned int);
+
+	for (unsigned int i = 0, o = 0; i < entryCount; i++)
+	{
+		regexTableEntry *entry = ptrArrayItem (entries, i);
+		const char *literal = entry->pattern->literal;
+		unsigned int s = 0;
+
+		if (literal == NULL)
+			continue;
+
+		for (const unsigned char *c = (const unsigned char *)literal; *c; c++)
+		{
+			unsigned int *n = prefilter->next + s * prefilter->classCount
+				+ prefilter->classes [*c];
+			if (*n == 0)
+				*n = stateCount++;
+			s = *n;
+		}
+		prefilter->outputs [o].entryIndex = i;
+		prefilter->outputs [o].next = prefilter->output [s];
+		prefilter->output [s] = o++;
+	}
+
+	/* Complete the transitions with the failure links in breadth-first
+	 * order, and append the outputs of the failure state to those of
+	 * each state. */
+	fail = xCalloc (stateCount, unsigned int);
+	queue = xMalloc (stateCount, unsigned int);
+	head = tail = 0;
+	queue [tail++] = 0;
+	while (head < tail)
+	{
+		unsigned int s = queue [head++];
+
+		for (unsigned int k = 0; k < prefilter->classCount; k++)
+		{
+			unsigned int *n = prefilter->next + s * prefilter->classCount + k;
+			unsigned int f = prefilter->next [fail [s] * prefilter->classCount + k];
+
+			if (k == 0 || *n == 0)
+			{
+				/* Class 0 never appears in literals. */
+				*n = (s == 0)? 0: f;
+				continue;
+			}
+
+			fail [*n] = (s == 0)? 0: f;
+			if (prefilter->output [*n] == -1)
+				prefilter->output [*n] = prefilter->output [fail [*n]];
+			else
+			{
+				int o = prefilter->output [*n];
+				while (prefilter->outputs [o].next != -1)
+					o = prefilter->outputs [o].next;
+				prefilter->outputs [o].next = prefilter->output [fail [*n]];
+			}
+			queue [tail++] = *n;
+		}
+	}
+	eFree (queue);
+	eFree (fail);
+
+	return prefilter;
+}
+
+/* Mark the entries whose literals are found in LINE. */
+static void scanLiteralPrefilter (struct literalPrefilter *prefilter,
+								  const vString *const line)
+{
+	const unsigned char *c = (const unsigned char *) vStringValue (line);
+	const unsigned char *end = c + vStringLength (line);
+	unsigned int s = 0;
+
+	if (++prefilter->generation == 0)
+	{
+		memset (prefilter->candidates, 0, sizeof (unsigned int) * prefilter->entryCount);
+		prefilter->generation = 1;
+	}
+
+	for (; c < end; c++)
+	{
+		s = prefilter->next [s * prefilter->classCount + prefilter->classes [*c]];
+		for (int o = prefilter->output [s]; o != -1; o = prefilter->outputs [o].next)
+			prefilter->candidates [prefilter->outputs [o].entryIndex] = prefilter->generation;
+	}
+}
+
+static bool isLiteralPrefilterCandidate (struct literalPrefilter *prefilter,
+										 unsigned int entryIndex, regexPattern *ptrn)
+{
+	return (ptrn->literal == NULL
+			|| prefilter->candidates [entryIndex] == prefilter->generation);
+}
+
+/*  Run regexec () for the pattern of ENTRY, measuring the time spent
+ *  if --_profile-regex is given. */
+static int execRegexTableEntry (regexTableEntry *entry, const char *string,
+								regmatch_t *pmatch)
+{
+	double start;
+	int r;
+
+	if (! Option.profileRegex)
+		return regexec (entry->pattern->pattern, string,
+						BACK_REFERENCE_COUNT, pmatch, 0);
+
+	start = getMonotonicTime ();
+	r = regexec (entry->pattern->pattern, string,
+				 BACK_REFERENCE_COUNT, pmatch, 0);
+	entry->statistics.time += getMonotonicTime () - start;
+	return r;
+}
+
 static bool matchRegexPattern (struct lregexControlBlock *lcb,
 							   const vString* const line,
-							   regexTableEntry *entry)
+							   regexTableEntry *entry,
+							   bool candidate)
 {
 	bool result = false;
 	regmatch_t pmatch [BACK_REFERENCE_COUNT];
@@ -1694,8 +2117,14 @@ static bool matchRegexPattern (struct lregexControlBlock *lcb,
 	if (patbuf->disabled && *(patbuf->disabled))
 		return false;
 
-	match = regexec (patbuf->pattern, vStringValue (line),
-			 BACK_REFERENCE_COUNT, pmatch, 0);
+	if (!candidate)
+	{
+		/* The line doesn't have the literal the pattern requires. */
+		entry->statistics.skip++;
+		return false;
+	}
+
+	match = execRegexTableEntry (entry, vStringValue (line), pmatch);
 	if (match == 0)
 	{
 		result = true;
@@ -1759,8 +2188,7 @@ static bool matchMultilineRegexPattern (struct lregexControlBlock *lcb,
 	current = start = vStringValue (allLines);
 	do
 	{
-		match = regexec (patbuf->pattern, current,
-						 BACK_REFERENCE_COUNT, pmatch, 0);
+		match = execRegexTableEntry (entry, current, pmatch);
 		if (match != 0)
 		{
 			entry->statistics.unmatch++;
@@ -1825,6 +2253,15 @@ extern bool matchRegex (struct lregexControlBlock *lcb, const vString* const lin
 {
 	bool result = false;
 	unsigned int i;
+
+	if (ptrArrayCount(lcb->entries[REG_PARSER_SINGLE_LINE]) == 0)
+		return false;
+
+	if (lcb->prefilter == NULL)
+		lcb->prefilter = newLiteralPrefilter (lcb->entries[REG_PARSER_SINGLE_LINE]);
+	if (lcb->prefilter->literalCount > 0)
+		scanLiteralPrefilter (lcb->prefilter, line);
+
 	for (i = 0  ;  i < ptrArrayCount(lcb->entries[REG_PARSER_SINGLE_LINE])  ;  ++i)
 	{
 		regexTableEntry *entry = ptrArrayItem(lcb->entries[REG_PARSER_SINGLE_LINE], i);
@@ -1836,7 +2273,8 @@ extern bool matchRegex (struct lregexControlBlock *lcb, const vString* const lin
 			&& (!isXtagEnabled (ptrn->xtagType)))
 				continue;
 
-		if (matchRegexPattern (lcb, line, entry))
+		if (matchRegexPattern (lcb, line, entry,
+							   isLiteralPrefilterCandidate (lcb->prefilter, i, ptrn)))
 		{
 			result = true;
 			if (ptrn->exclusive)
@@ -2016,6 +2454,8 @@ static regexPattern *addTagRegexInternal (struct lregexControlBlock *lcb,
 												explictly_defined,
 												disabled);
 	rptr->pattern_string = escapeRegexPattern(regex);
+	if (regptype == REG_PARSER_SINGLE_LINE)
+		rptr->literal = extractRequiredLiteral (regex, flags);
 
 	eFree (kindName);
 	if (description)
@@ -2089,6 +2529,7 @@ extern void addCallbackRegex (struct lregexControlBlock *lcb,
 		regexPattern *rptr = addCompiledCallbackPattern (lcb, cp, callback, flags,
 														 disabled, userData);
 		rptr->pattern_string = escapeRegexPattern(regex);
+		rptr->literal = extractRequiredLiteral (regex, flags);
 	}
 }
 
@@ -2453,8 +2894,7 @@ static struct regexTable * matchMultitableRegexTable (struct lregexControlBlock
 		if (ptrn->disabled && *(ptrn->disabled))
 			continue;
 
-		match = regexec (ptrn->pattern, current,
-						 BACK_REFERENCE_COUNT, pmatch, 0);
+		match = execRegexTableEntry (entry, current, pmatch);
 
 		if (match == 0)
 		{
@@ -2631,6 +3071,27 @@ extern void extendRegexTable (struct lregexControlBlock *lcb, const char *src, c
 	}
 }
 
+extern void printRegexStatistics (struct lregexControlBlock *lcb)
+{
+	ptrArray *entries = lcb->entries[REG_PARSER_SINGLE_LINE];
+
+	if (ptrArrayCount(entries) == 0)
+		return;
+
+	fprintf(stderr, "\nREGEX STATISTICS of %s\n", getLanguageName (lcb->owner));
+	fputs("==============================================\n", stderr);
+	for (unsigned int i = 0; i < ptrArrayCount(entries); i++)
+	{
+		regexTableEntry *entry = ptrArrayItem (entries, i);
+		Assert (entry && entry->pattern);
+		fprintf(stderr, "%10u/%-10u%-40s skip: %u\n",
+				entry->statistics.match,
+				entry->statistics.unmatch + entry->statistics.match,
+				entry->pattern->pattern_string,
+				entry->statistics.skip);
+	}
+}
+
 extern void printMultitableStatistics (struct lregexControlBlock *lcb)
 {
 	if (ptrArrayCount(lcb->tables) == 0)
@@ -2657,6 +3118,47 @@ extern void printMultitableStatistics (struct lregexControlBlock *lcb)
 	}
 }
 
+static void collectRegexProfilesOfEntries (struct lregexControlBlock *lcb,
+										   enum regexParserType regptype,
+										   const char *table,
+										   ptrArray *entries, ptrArray *profiles)
+{
+	for (unsigned int i = 0; i < ptrArrayCount (entries); i++)
+	{
+		regexTableEntry *entry = ptrArrayItem (entries, i);
+		unsigned int calls = entry->statistics.match + entry->statistics.unmatch;
+
+		if (calls == 0)
+			continue;
+
+		struct regexProfile *profile = xMalloc (1, struct regexProfile);
+		profile->language = lcb->owner;
+		profile->regptype = regptype;
+		profile->table = table;
+		profile->pattern = entry->pattern->pattern_string;
+		profile->calls = calls;
+		profile->matches = entry->statistics.match;
+		profile->time = entry->statistics.time;
+		ptrArrayAdd (profiles, profile);
+	}
+}
+
+/*  Add a struct regexProfile for each pattern of LCB tried at least once
+ *  to PROFILES. The strings in them are owned by LCB. */
+extern void collectRegexProfiles (struct lregexControlBlock *lcb, ptrArray *profiles)
+{
+	collectRegexProfilesOfEntries (lcb, REG_PARSER_SINGLE_LINE, NULL,
+								   lcb->entries [REG_PARSER_SINGLE_LINE], profiles);
+	collectRegexProfilesOfEntries (lcb, REG_PARSER_MULTI_LINE, NULL,
+								   lcb->entries [REG_PARSER_MULTI_LINE], profiles);
+	for (unsigned int i = 0; i < ptrArrayCount (lcb->tables); i++)
+	{
+		struct regexTable *table = ptrArrayItem (lcb->tables, i);
+		collectRegexProfilesOfEntries (lcb, REG_PARSER_MULTI_TABLE, table->name,
+									   table->entries, profiles);
+	}
+}
+
 extern bool matchMultitableRegex (struct lregexControlBlock *lcb, const vString* const allLines)
 {
 	if (ptrArrayCount (lcb->tables) == 0)
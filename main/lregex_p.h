@@ -21,6 +21,7 @@
 #include "general.h"
 #include "kind_p.h"
 #include "lregex.h"
+#include "ptrarray.h"
 
 /*
 *   DATA DECLARATIONS
@@ -33,6 +34,17 @@ enum regexParserType {
 
 struct lregexControlBlock;
 
+/* How a pattern worked, collected for --_profile-regex */
+struct regexProfile {
+	langType language;
+	enum regexParserType regptype;
+	const char *table;			/* NULL unless REG_PARSER_MULTI_TABLE */
+	const char *pattern;
+	unsigned int calls;
+	unsigned int matches;
+	double time;				/* in seconds */
+};
+
 /*
 *   FUNCTION PROTOTYPES
 */
@@ -72,6 +84,8 @@ extern void notifyRegexInputEnd (struct lregexControlBlock *lcb);
 extern void addRegexTable (struct lregexControlBlock *lcb, const char *name);
 extern void extendRegexTable (struct lregexControlBlock *lcb, const char *src, const char *dist);
 
+extern void printRegexStatistics (struct lregexControlBlock *lcb);
 extern void printMultitableStatistics (struct lregexControlBlock *lcb);
+extern void collectRegexProfiles (struct lregexControlBlock *lcb, ptrArray *profiles);
 
 #endif	/* CTAGS_MAIN_LREGEX_PRIVATEH */
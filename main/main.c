@@ -28,6 +28,7 @@
 #include <crt_externs.h>
 #endif
 
+#include <errno.h>
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
@@ -51,9 +52,13 @@
 
 #include "ctags.h"
 #include "debug.h"
+#include "dedup_p.h"
+#include "dirscan_p.h"
 #include "entry_p.h"
 #include "error_p.h"
 #include "field_p.h"
+#include "intern_p.h"
+#include "jobs_p.h"
 #include "keyword_p.h"
 #include "main_p.h"
 #include "options_p.h"
@@ -61,6 +66,7 @@
 #include "read_p.h"
 #include "routines_p.h"
 #include "stats_p.h"
+#include "traceevent_p.h"
 #include "trace.h"
 #include "trashbox_p.h"
 #include "writer_p.h"
@@ -69,7 +75,6 @@
 #ifdef HAVE_JANSSON
 #include "interactive_p.h"
 #include <jansson.h>
-#include <errno.h>
 #endif
 
 /*
@@ -87,7 +92,58 @@ static bool createTagsForEntry (const char *const entryName);
 *   FUNCTION DEFINITIONS
 */
 
-#if defined (HAVE_OPENDIR) && (defined (HAVE_DIRENT_H) || defined (_MSC_VER))
+#if defined (DIRSCAN_SUPPORTED)
+/*  Make tags for an entry of a directory, letting eStat() take the status
+ *  read with the directory. */
+static bool createTagsForListedEntry (const fileStatus *const status)
+{
+	bool resize;
+
+	/* An entry without status is looked at again for errno. */
+	if (status->exists)
+		setFileStatusHint (status);
+	resize = createTagsForEntry (status->name);
+	clearFileStatusHint ();
+
+	return resize;
+}
+
+static bool isDirectoryToRecurse (const fileStatus *const status,
+								  const unsigned int depth)
+{
+	return (status->exists && status->isDirectory && ! status->isSymbolicLink
+			&& depth < Option.maxRecursionDepth
+			&& ! isExcludedFile (status->name, true)
+			&& ! isExcludedDirectory (status->name));
+}
+
+static bool recurseUsingDirScan (const char *const dirName,
+								 const unsigned int depth)
+{
+	bool resize = false;
+	dirListing *const listing = getDirListing (dirName);
+	unsigned int i;
+
+	if (listing->error)
+	{
+		errno = listing->error;
+		error (WARNING | PERROR, "cannot recurse into directory \"%s\"", dirName);
+	}
+
+	/* Let threads read the subdirectories while the files here are
+	 * parsed. The entries are still visited in the order of readdir. */
+	for (i = 0; i < listing->count; i++)
+		if (isDirectoryToRecurse (listing->entries + i, depth))
+			prefetchDirListing (listing->entries [i].name);
+
+	for (i = 0; i < listing->count; i++)
+		resize |= createTagsForListedEntry (listing->entries + i);
+
+	freeDirListing (listing);
+	return resize;
+}
+
+#elif defined (HAVE_OPENDIR) && (defined (HAVE_DIRENT_H) || defined (_MSC_VER))
 static bool recurseUsingOpendir (const char *const dirName)
 {
 	bool resize = false;
@@ -179,8 +235,16 @@ static bool recurseIntoDirectory (const char *const dirName)
 				dirName, recursionDepth, Option.maxRecursionDepth);
 	else
 	{
+		statsPhase phase = switchPhase (PHASE_TRAVERSAL);
+
 		verbose ("RECURSING into directory \"%s\"\n", dirName);
-#if defined (HAVE_OPENDIR) && (defined (HAVE_DIRENT_H) || defined (_MSC_VER))
+#if defined (DIRSCAN_SUPPORTED)
+		if (recursionDepth == 1)
+			startDirScanThreads ();
+		resize = recurseUsingDirScan (dirName, recursionDepth);
+		if (recursionDepth == 1)
+			stopDirScanThreads ();
+#elif defined (HAVE_OPENDIR) && (defined (HAVE_DIRENT_H) || defined (_MSC_VER))
 		resize = recurseUsingOpendir (dirName);
 #elif defined (HAVE__FINDFIRST)
 		{
@@ -192,6 +256,7 @@ static bool recurseIntoDirectory (const char *const dirName)
 			vStringDelete (pattern);
 		}
 #endif
+		switchPhase (phase);
 	}
 
 	recursionDepth--;
@@ -202,15 +267,23 @@ static bool recurseIntoDirectory (const char *const dirName)
 static bool createTagsForEntry (const char *const entryName)
 {
 	bool resize = false;
-	fileStatus *status = eStat (entryName);
+	fileStatus *status;
 
 	Assert (entryName != NULL);
+	/* An excluded entry needs no stat. */
 	if (isExcludedFile (entryName, true))
+	{
 		verbose ("excluding \"%s\" (the early stage)\n", entryName);
-	else if (status->isSymbolicLink  &&  ! Option.followLinks)
+		return false;
+	}
+
+	status = eStat (entryName);
+	if (status->isSymbolicLink  &&  ! Option.followLinks)
 		verbose ("ignoring \"%s\" (symbolic link)\n", entryName);
 	else if (! status->exists)
 		error (WARNING | PERROR, "cannot open input file \"%s\"", entryName);
+	else if (status->isDirectory && isExcludedDirectory (entryName))
+		verbose ("excluding \"%s\" (all files in the directory)\n", entryName);
 	else if (status->isDirectory)
 		resize = recurseIntoDirectory (entryName);
 	else if (! status->isNormalFile)
@@ -218,7 +291,15 @@ static bool createTagsForEntry (const char *const entryName)
 	else if (isExcludedFile (entryName, false))
 		verbose ("excluding \"%s\"\n", entryName);
 	else
-		resize = parseFile (entryName);
+	{
+		if (Option.update)
+			noteInputFileForUpdate (entryName);
+
+		if (isJobQueueEnabled ())
+			queueJob (entryName);
+		else
+			resize = parseFile (entryName);
+	}
 
 	eStatFree (status);
 	return resize;
@@ -266,6 +347,10 @@ static bool createTagsForArgs (cookedArgs *const args)
 		resize |= createTagsForEntry (arg);
 #endif
 		cArgForth (args);
+		/* Options given after an input file affect only the input
+		   files following them. */
+		if (! cArgOff (args) && cArgIsOption (args))
+			resize |= runQueuedJobs ();
 		parseCmdlineOptions (args);
 	}
 	return resize;
@@ -290,6 +375,8 @@ static bool createTagsFromFileInput (FILE *const fp, const bool filter)
 				fflush (stdout);
 			}
 			cArgForth (args);
+			if (! cArgOff (args) && cArgIsOption (args))
+				resize |= runQueuedJobs ();
 			parseCmdlineOptions (args);
 		}
 		cArgDelete (args);
@@ -353,6 +440,10 @@ static void batchMakeTags (cookedArgs *args, void *user CTAGS_ATTR_UNUSED)
 		openTagFile ();
 
 	timeStamp (0);
+	if (Option.printTotals == TOTALS_JSON)
+		startProfiling ();
+	if (Option.traceEvents)
+		openTraceEvents (Option.traceEvents);
 
 	if (! cArgOff (args))
 	{
@@ -371,21 +462,31 @@ static void batchMakeTags (cookedArgs *args, void *user CTAGS_ATTR_UNUSED)
 	}
 	if (! files  &&  Option.recurse)
 		resize = recurseIntoDirectory (".");
+	resize = (bool) (runQueuedJobs () || resize);
 
 	timeStamp (1);
 
 	if ((! Option.filter) && (!Option.printLanguage))
+	{
+		switchPhase (PHASE_WRITING);
 		closeTagFile (resize);
+	}
 
 	timeStamp (2);
 
-	if (Option.printTotals)
+	if (Option.printTotals == TOTALS_JSON)
+		printTotalsAsJson (Option.append || Option.update, Option.sorted);
+	else if (Option.printTotals)
 	{
-		printTotals (timeStamps, Option.append, Option.sorted);
-		if (Option.printTotals > 1)
+		printTotals (timeStamps, Option.append || Option.update, Option.sorted);
+		if (Option.printTotals == TOTALS_EXTRA)
 			for (unsigned int i = 0; i < countParsers(); i++)
 				printParserStatisticsIfUsed (i);
 	}
+	if (Option.profileRegex && Option.printTotals != TOTALS_JSON)
+		printRegexProfile ();
+
+	closeTraceEvents ();
 
 #undef timeStamp
 }
@@ -412,18 +513,132 @@ void interactiveLoop (cookedArgs *args CTAGS_ATTR_UNUSED, void *user)
 		}
 	}
 
-	char buffer[1024];
+	serveInteractiveRequests (iargs->sandbox);
+}
+
+/*  Read a line of any length from FP into LINE, without the newline.
+ *  Return false at the end of the input. */
+static bool readRequestLine (vString *const line, FILE *const fp)
+{
+	int c;
+
+	vStringClear (line);
+	while ((c = getc (fp)) != EOF && c != '\n')
+		vStringPut (line, c);
+
+	return (c != EOF || vStringLength (line) > 0);
+}
+
+/*  Make the tags for FILENAME. SIZE is the number of bytes of the file
+ *  contents following the request in the stream, or -1 for reading the
+ *  contents from the disk. */
+static void generateTagsForRequest (const char *const filename, json_int_t size)
+{
+	openTagFile ();
+	if (size == -1)
+		createTagsForEntry (filename);
+	else
+	{
+		unsigned char *data = eMalloc (size);
+		size = fread (data, 1, size, stdin);
+		MIO *mio = mio_new_memory (data, size, eRealloc, eFreeNoNullCheck);
+		parseFileWithMio (filename, mio, NULL);
+		mio_unref (mio);
+	}
+	closeTagFile (false);
+	fflush (stdout);
+}
+
+/*  A generate-tags request has either "filename" and an optional "size",
+ *  or "filenames" and an optional "sizes" array of the same length for a
+ *  batch. A null in "sizes" reads that file from the disk. The tags of
+ *  each file of a batch are written as soon as the file is parsed. */
+static void serveGenerateTagsRequest (json_t *const request, bool sandbox)
+{
+	json_t *filenames = json_object_get (request, "filenames");
+	json_t *sizes = json_object_get (request, "sizes");
+	const char *filename;
+	json_int_t size = -1;
+	size_t count, i;
+
+	if (filenames)
+	{
+		if (!json_is_array (filenames)
+			|| (sizes && (!json_is_array (sizes)
+						  || json_array_size (sizes) != json_array_size (filenames))))
+		{
+			error (FATAL, "invalid generate-tags request");
+			return;
+		}
+
+		count = json_array_size (filenames);
+		for (i = 0; i < count; i++)
+		{
+			json_t *s = sizes? json_array_get (sizes, i): NULL;
+
+			if (!json_is_string (json_array_get (filenames, i))
+				|| (s && !json_is_null (s)
+					&& !(json_is_integer (s) && json_integer_value (s) >= 0)))
+			{
+				error (FATAL, "invalid generate-tags request");
+				return;
+			}
+			if (sandbox && (s == NULL || json_is_null (s)))
+			{
+				error (FATAL,
+					   "invalid request in sandbox submode: reading file contents from a file is limited");
+				return;
+			}
+		}
+	}
+	else
+	{
+		if (json_unpack (request, "{ss}", "filename", &filename) == -1)
+		{
+			error (FATAL, "invalid generate-tags request");
+			return;
+		}
+
+		json_unpack (request, "{sI}", "size", &size);
+		if (size == -1 && sandbox)
+		{
+			error (FATAL,
+				   "invalid request in sandbox submode: reading file contents from a file is limited");
+			return;
+		}
+		count = 1;
+	}
+
+	for (i = 0; i < count; i++)
+	{
+		if (filenames)
+		{
+			json_t *s = sizes? json_array_get (sizes, i): NULL;
+
+			filename = json_string_value (json_array_get (filenames, i));
+			size = (s && json_is_integer (s))? json_integer_value (s): -1;
+		}
+		generateTagsForRequest (filename, size);
+	}
+
+	fputs ("{\"_type\": \"completed\", \"command\": \"generate-tags\"}\n", stdout);
+	fflush (stdout);
+}
+
+extern void serveInteractiveRequests (bool sandbox)
+{
+	vString *buffer = vStringNew ();
 	json_t *request;
 
 	fputs ("{\"_type\": \"program\", \"name\": \"" PROGRAM_NAME "\", \"version\": \"" PROGRAM_VERSION "\"}\n", stdout);
 	fflush (stdout);
 
-	while (fgets (buffer, sizeof(buffer), stdin))
+	while (readRequestLine (buffer, stdin))
 	{
-		if (buffer[0] == '\n')
+		if (vStringLength (buffer) == 0)
 			continue;
 
-		request = json_loads (buffer, JSON_DISABLE_EOF_CHECK, NULL);
+		request = json_loads (vStringValue (buffer), JSON_DISABLE_EOF_CHECK, NULL);
 		if (! request)
 		{
 			error (FATAL, "invalid json");
@@ -431,50 +646,14 @@ void interactiveLoop (cookedArgs *args CTAGS_ATTR_UNUSED, void *user)
 		}
 
 		json_t *command = json_object_get (request, "command");
-		if (! command)
+		if (! json_is_string (command))
 		{
 			error (FATAL, "command name not found");
 			goto next;
 		}
 
 		if (!strcmp ("generate-tags", json_string_value (command)))
-		{
-			json_int_t size = -1;
-			const char *filename;
-
-			if (json_unpack (request, "{ss}", "filename", &filename) == -1)
-			{
-				error (FATAL, "invalid generate-tags request");
-				goto next;
-			}
-
-			json_unpack (request, "{sI}", "size", &size);
-
-			openTagFile ();
-			if (size == -1)
-			{					/* read from disk */
-				if (iargs->sandbox) {
-					error (FATAL,
-						   "invalid request in sandbox submode: reading file contents from a file is limited");
-					closeTagFile (false);
-					goto next;
-				}
-
-				createTagsForEntry (filename);
-			}
-			else
-			{					/* read nbytes from stream */
-				unsigned char *data = eMalloc (size);
-				size = fread (data, 1, size, stdin);
-				MIO *mio = mio_new_memory (data, size, eRealloc, eFreeNoNullCheck);
-				parseFileWithMio (filename, mio, NULL);
-				mio_unref (mio);
-			}
-
-			closeTagFile (false);
-			fputs ("{\"_type\": \"completed\", \"command\": \"generate-tags\"}\n", stdout);
-			fflush(stdout);
-		}
+			serveGenerateTagsRequest (request, sandbox);
 		else
 		{
 			error (FATAL, "unknown command name");
@@ -483,7 +662,11 @@ void interactiveLoop (cookedArgs *args CTAGS_ATTR_UNUSED, void *user)
 
 	next:
 		json_decref (request);
+		/* The error responses are not flushed yet. */
+		fflush (stdout);
 	}
+
+	vStringDelete (buffer);
 }
 #endif
 
@@ -591,6 +774,8 @@ extern int ctags_cli_main (int argc CTAGS_ATTR_UNUSED, char **argv)
 	freeRoutineResources ();
 	freeInputFileResources ();
 	freeTagFileResources ();
+	forgetDedupedInputs ();
+	freeInternResources ();
 	freeOptionResources ();
 	freeParserResources ();
 	freeRegexResources ();
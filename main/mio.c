@@ -43,6 +43,14 @@
 #include <stdlib.h>
 #include <limits.h>
 
+#if defined (HAVE_MMAP) && defined (HAVE_SYS_MMAN_H)
+#define MIO_MMAP_SUPPORTED
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
 #ifdef READTAGS_DSL
 #define xMalloc(n,Type)    (Type *)eMalloc((size_t)(n) * sizeof (Type))
 #define xRealloc(p,n,Type) (Type *)eRealloc((p), (n) * sizeof (Type))
@@ -150,6 +158,7 @@ struct _MIO {
 			size_t allocated_size;
 			MIOReallocFunc realloc_func;
 			MIODestroyNotify free_func;
+			bool mapped;	/* buf is mapped with mmap(), and read-only */
 			bool error;
 			bool eof;
 		} mem;
@@ -331,6 +340,7 @@ MIO *mio_new_memory (unsigned char *data,
 		mio->impl.mem.allocated_size = size;
 		mio->impl.mem.realloc_func = realloc_func;
 		mio->impl.mem.free_func = free_func;
+		mio->impl.mem.mapped = false;
 		mio->impl.mem.eof = false;
 		mio->impl.mem.error = false;
 		mio->refcount = 1;
@@ -341,6 +351,59 @@ MIO *mio_new_memory (unsigned char *data,
 	return mio;
 }
 
+/**
+ * mio_new_mmap:
+ * @filename: Filename to map
+ *
+ * Creates a new read-only #MIO object working on memory, mapping the whole
+ * content of a regular file with mmap() instead of reading it. The mapping
+ * is released together with the object.
+ *
+ * The returned object is of the type %MIO_TYPE_MEMORY, so
+ * mio_memory_get_data() returns the mapped bytes. Writing to the object
+ * fails.
+ *
+ * The file must not be truncated while it is mapped.
+ *
+ * Free-function: mio_unref()
+ *
+ * Returns: A new #MIO on success, or %NULL on failure, if @filename is not
+ *          a non-empty regular file, or if mmap() is not available.
+ */
+MIO *mio_new_mmap (const char *filename)
+{
+	MIO *mio = NULL;
+#ifdef MIO_MMAP_SUPPORTED
+	struct stat st;
+	int fd;
+
+	fd = open (filename, O_RDONLY);
+	if (fd < 0)
+		return NULL;
+
+	if (fstat (fd, &st) == 0
+		&& S_ISREG (st.st_mode)
+		&& st.st_size > 0
+		&& st.st_size <= LONG_MAX)
+	{
+		size_t size = (size_t) st.st_size;
+		void *addr = mmap (NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+		if (addr != MAP_FAILED)
+		{
+			mio = mio_new_memory (addr, size, NULL, NULL);
+			if (mio)
+				mio->impl.mem.mapped = true;
+			else
+				munmap (addr, size);
+		}
+	}
+	close (fd);
+#endif
+
+	return mio;
+}
+
 /**
  * mio_new_mio:
  * @base: The original mio
@@ -498,6 +561,11 @@ int mio_unref (MIO *mio)
 		}
 		else if (mio->type == MIO_TYPE_MEMORY)
 		{
+#ifdef MIO_MMAP_SUPPORTED
+			if (mio->impl.mem.mapped)
+				munmap (mio->impl.mem.buf, mio->impl.mem.allocated_size);
+			else
+#endif
 			if (mio->impl.mem.free_func)
 				mio->impl.mem.free_func (mio->impl.mem.buf);
 			mio->impl.mem.buf = NULL;
@@ -506,6 +574,7 @@ int mio_unref (MIO *mio)
 			mio->impl.mem.allocated_size = 0;
 			mio->impl.mem.realloc_func = NULL;
 			mio->impl.mem.free_func = NULL;
+			mio->impl.mem.mapped = false;
 			mio->impl.mem.eof = false;
 			mio->impl.mem.error = false;
 		}
@@ -618,8 +687,11 @@ static int mem_try_resize (MIO *mio, size_t new_size)
 					size_t newsize;
 					unsigned char *newbuf;
 
+					/* Grow geometrically, so that writing a large
+					 * stream doesn't copy the data again and again. */
 					newsize = MAX (mio->impl.mem.allocated_size + MIO_CHUNK_SIZE,
-								   new_size);
+								   mio->impl.mem.allocated_size * 2);
+					newsize = MAX (newsize, new_size);
 					newbuf = mio->impl.mem.realloc_func (mio->impl.mem.buf, newsize);
 					if (newbuf)
 					{
@@ -668,7 +740,9 @@ static int mem_try_ensure_space (MIO *mio, size_t n)
 {
 	int success = true;
 
-	if (mio->impl.mem.pos + n > mio->impl.mem.size)
+	if (mio->impl.mem.mapped)
+		success = false;
+	else if (mio->impl.mem.pos + n > mio->impl.mem.size)
 		success = mem_try_resize (mio, mio->impl.mem.pos + n);
 
 	return success;
@@ -1322,6 +1396,28 @@ int mio_setpos (MIO *mio, MIOPos *pos)
 	return rv;
 }
 
+/**
+ * mio_memory_get_offset:
+ * @mio: A #MIO object
+ * @pos: (in): A #MIOPos object filled-in by a previous call of mio_getpos() on
+ *       the same stream
+ *
+ * Gets the offset of the position saved in @pos in the memory buffer of a
+ * #MIO memory stream, without changing the position of the stream.
+ *
+ * Returns: The offset, or -1 if the stream is not a memory stream or @pos is
+ *          out of the memory buffer.
+ */
+long mio_memory_get_offset (MIO *mio, const MIOPos *pos)
+{
+	if (mio->type == MIO_TYPE_MEMORY
+		&& pos->type == MIO_TYPE_MEMORY
+		&& pos->impl.mem <= mio->impl.mem.size)
+		return (long) pos->impl.mem;
+
+	return -1;
+}
+
 /**
  * mio_flush:
  * @mio: A #MIO object
@@ -122,6 +122,7 @@ MIO *mio_new_memory (unsigned char *data,
 					 size_t size,
 					 MIOReallocFunc realloc_func,
 					 MIODestroyNotify free_func);
+MIO *mio_new_mmap   (const char *filename);
 
 MIO *mio_new_mio    (MIO *base, long start, long size);
 MIO *mio_ref        (MIO *mio);
@@ -154,6 +155,7 @@ long mio_tell (MIO *mio);
 void mio_rewind (MIO *mio);
 int mio_getpos (MIO *mio, MIOPos *pos);
 int mio_setpos (MIO *mio, MIOPos *pos);
+long mio_memory_get_offset (MIO *mio, const MIOPos *pos);
 int mio_flush (MIO *mio);
 
 void  mio_attach_user_data (MIO *mio, void *user_data, MIODestroyNotify user_data_free_func);
@@ -23,11 +23,16 @@
 #include <stdio.h>
 #include <ctype.h>  /* to declare isspace () */
 
+#include "bench_p.h"
+#include "cache_p.h"
 #include "ctags.h"
 #include "debug.h"
+#include "dedup_p.h"
 #include "entry_p.h"
 #include "field_p.h"
+#include "globset_p.h"
 #include "gvars.h"
+#include "htable_p.h"
 #include "keyword_p.h"
 #include "parse_p.h"
 #include "ptag_p.h"
@@ -36,6 +41,8 @@
 #include "param_p.h"
 #include "error_p.h"
 #include "interactive_p.h"
+#include "jobs_p.h"
+#include "server_p.h"
 #include "writer_p.h"
 #include "trace.h"
 
@@ -124,6 +131,10 @@ typedef stringList searchPathList;
 static searchPathList *OptlibPathList;
 
 static stringList *Excluded, *ExcludedException;
+/* Compiled from Excluded and ExcludedException at the first use after
+ * they are changed. */
+static globSet *ExcludedSet, *ExcludedExceptionSet;
+static bool ExcludedSetsAreStale = true;
 static bool FilesRequired = true;
 static bool SkipConfiguration;
 
@@ -136,6 +147,8 @@ bool ctags_verbose = false;
 
 optionValues Option = {
 	.append = false,
+	.update = false,
+	.tagIndex = false,
 	.backward = false,
 	.etags = false,
 	.locate =
@@ -163,7 +176,7 @@ optionValues Option = {
 	.filter = false,
 	.filterTerminator = NULL,
 	.tagRelative = TREL_NO,
-	.printTotals = 0,
+	.printTotals = TOTALS_NO,
 	.lineDirectives = false,
 	.printLanguage =false,
 	.guessLanguageEagerly = false,
@@ -172,6 +185,11 @@ optionValues Option = {
 	.patternLengthLimit = 96,
 	.putFieldPrefix = false,
 	.maxRecursionDepth = 0xffffffff,
+	.jobs = 1,
+	.sortMemory = 128 * 1024 * 1024,
+	.cacheDir = NULL,
+	.dedupInputs = false,
+	.traceEvents = NULL,
 	.interactive = false,
 #ifdef WIN32
 	.useSlashAsFilenameSeparator = FILENAME_SEP_UNSET,
@@ -241,6 +259,11 @@ static optionDescription LongOptionDescription [] = {
  {1,"       for LANG."},
  {1,"  --append=[yes|no]"},
  {1,"       Should tags should be appended to existing tag file [no]?"},
+ {1,"  --cache-dir=<dir>"},
+ {1,"       Reuse the tags of unchanged input files stored in <dir>."},
+ {1,"  --dedup-inputs=[yes|no]"},
+ {1,"       Reuse the tags of an input file for other input files with the"},
+ {1,"       same content and name [no]."},
  {1,"  --etags-include=file"},
  {1,"       Include reference to 'file' in Emacs-style tag file (requires -e)."},
  {1,"  --exclude=pattern"},
@@ -294,6 +317,12 @@ static optionDescription LongOptionDescription [] = {
  {1,"       Specify encoding of all input files."},
  {1,"  --input-encoding-<LANG>=encoding"},
  {1,"       Specify encoding of the LANG input files."},
+#endif
+ {1,"  --jobs=N"},
+#ifdef JOBS_SUPPORTED
+ {1,"       Tag input files in N worker processes [1]."},
+#else
+ {1,"       Not supported on this platform."},
 #endif
  {1,"  --kinddef-<LANG>=letter,name,desc"},
  {1,"       Define new kind for <LANG>."},
@@ -416,12 +445,18 @@ static optionDescription LongOptionDescription [] = {
  {1,"       Enable/disable tag roles for kinds of language <LANG>."},
  {0,"  --sort=[yes|no|foldcase]"},
  {0,"       Should tags be sorted (optionally ignoring case) [yes]?"},
+ {1,"  --sort-memory=<size>[k|m|g]"},
+ {1,"       Memory for sorting tags before using temporary files [128m]."},
+ {1,"  --tag-index=[yes|no]"},
+ {1,"       Should an index of the tag file for readtags be written [no]?"},
  {0,"  --tag-relative=[yes|no|always|never]"},
  {0,"       Should paths be relative to location of tag file [no; yes when -e]?"},
  {0,"       always: be relative even if input files are passed in with absolute paths" },
  {0,"       never:  be absolute even if input files are passed in with relative paths" },
- {1,"  --totals=[yes|no|extra]"},
+ {1,"  --totals=[yes|no|extra|json]"},
  {1,"       Print statistics about input and tag files [no]."},
+ {1,"  --update=[yes|no]"},
+ {1,"       Should tags for input files be replaced in existing tag file [no]?"},
 #ifdef WIN32
  {1,"  --use-slash-as-filename-separator=[yes|no]"},
  {1,"       Use slash as filename separator [yes] for u-ctags output format."},
@@ -441,6 +476,10 @@ static optionDescription LongOptionDescription [] = {
 static optionDescription ExperimentalLongOptionDescription [] = {
  {1,"  --_anonhash=fname"},
  {1,"       Used in u-ctags test harness"},
+ {1,"  --_bench-htable"},
+ {1,"       Measure the operation rate of the hash table implementations."},
+ {1,"  --_bench-keywords"},
+ {1,"       Measure the keyword lookup rate of initialized parser(s)."},
  {1,"  --_dump-keywords"},
  {1,"       Dump keywords of initialized parser(s)."},
  {1,"  --_dump-options"},
@@ -482,17 +521,30 @@ static optionDescription ExperimentalLongOptionDescription [] = {
  {1,"       Define multitable regular expression for locating tags in specific language."},
  {1,"  --_pretend-<NEWLANG>=<OLDLANG>"},
  {1,"       Make NEWLANG parser pretend OLDLANG parser in lang: field."},
+ {1,"  --_profile-regex[=N]"},
+ {1,"       Measure the time spent in each regex pattern, and print N patterns"},
+ {1,"       taking the most time at exit [20]. With --totals=json, they are"},
+ {1,"       added to the JSON object."},
  {1,"  --_roledef-<LANG>.kind=role_name,role_desc"},
  {1,"       Define new role for the kind in <LANG>."},
  {1,"  --_scopesep-<LANG>=[parent_kind_letter]/child_kind_letter:separator"},
  {1,"       Specify scope separator between <PARENT_KIND> and <KIND>."},
  {1,"       * as a kind letter matches any kind."},
+#ifdef SERVER_SUPPORTED
+ {0,"  --_server=path"},
+ {0,"       Serve the requests of the interactive mode on the unix domain socket"},
+ {0,"       at PATH, with N worker processes given with --jobs=N."},
+#endif
  {1,"  --_tabledef-<LANG>=name"},
  {1,"       Define new regex table for <LANG>."},
+ {1,"  --_test-htable"},
+ {1,"       Verify the slots of the growable hash table through its operations."},
 #ifdef DO_TRACING
  {1,"  --_trace=list"},
  {1,"       Trace parsers for the languages."},
 #endif
+ {1,"  --_trace-events=file"},
+ {1,"       Write a trace of the run to FILE in the Trace Event Format of Chrome."},
  {1,"  --_xformat=field_format"},
  {1,"       Specify custom format for tabular cross reference (-x)."},
  {1,"       Fields can be specified with letter listed in --list-fields."},
@@ -542,6 +594,9 @@ static struct Feature {
 #ifdef HAVE_ICONV
 	{"iconv", "can convert input/output encodings"},
 #endif
+#ifdef JOBS_SUPPORTED
+	{"jobs", "can tag input files in parallel worker processes"},
+#endif
 #ifdef DEBUG
 	{"debug", "TO BE WRITTEN"},
 #endif
@@ -555,6 +610,9 @@ static struct Feature {
 	{"json", "supports json format output"},
 	{"interactive", "accepts source code from stdin"},
 #endif
+#ifdef SERVER_SUPPORTED
+	{"server", "serves the interactive mode on a unix domain socket"},
+#endif
 #ifdef HAVE_SECCOMP
 	{"sandbox", "linked with code for system call level sandbox"},
 #endif
@@ -745,13 +803,29 @@ extern void checkOptions (void)
 		if (isDestinationStdout ())
 			error (FATAL, "%s tags to stdout", notice);
 	}
+	if (Option.update)
+	{
+		notice = "update mode is not compatible with";
+		if (isDestinationStdout ())
+			error (FATAL, "%s tags to stdout", notice);
+		if (Option.etags)
+			error (FATAL, "%s etags output", notice);
+	}
+	if (Option.tagIndex)
+	{
+		notice = "tag index is not compatible with";
+		if (isDestinationStdout ())
+			error (FATAL, "%s tags to stdout", notice);
+		if (Option.etags)
+			error (FATAL, "%s etags output", notice);
+	}
 	if (Option.filter)
 	{
 		notice = "filter mode";
 		if (Option.printTotals)
 		{
 			error (WARNING, "%s disables totals", notice);
-			Option.printTotals = 0;
+			Option.printTotals = TOTALS_NO;
 		}
 		if (Option.tagFileName != NULL)
 			error (WARNING, "%s ignores output tag file name", notice);
@@ -1143,6 +1217,8 @@ static void processExcludeOptionCommon (
 	stringList** list, const char *const optname, const char *const parameter)
 {
 	const char *const fileName = parameter + 1;
+
+	ExcludedSetsAreStale = true;
 	if (parameter [0] == '\0')
 		freeList (list);
 	else if (parameter [0] == '@')
@@ -1181,6 +1257,28 @@ static void processExcludeExceptionOption (
 	processExcludeOptionCommon (&ExcludedException, option, parameter);
 }
 
+static void compileExcludeList (globSet **set, stringList *const list)
+{
+	if (*set == NULL)
+		*set = globSetNew ();
+	else
+		globSetClear (*set);
+
+	if (list)
+		for (unsigned int i = 0; i < stringListCount (list); i++)
+			globSetAddPattern (*set, vStringValue (stringListItem (list, i)), NULL);
+}
+
+static void compileExcludeListsMaybe (void)
+{
+	if (! ExcludedSetsAreStale)
+		return;
+
+	compileExcludeList (&ExcludedSet, Excluded);
+	compileExcludeList (&ExcludedExceptionSet, ExcludedException);
+	ExcludedSetsAreStale = false;
+}
+
 extern bool isExcludedFile (const char* const name,
 							bool falseIfExceptionsAreDefeind)
 {
@@ -1192,20 +1290,22 @@ extern bool isExcludedFile (const char* const name,
 		&& stringListCount (ExcludedException) > 0)
 		return false;
 
-	if (Excluded != NULL)
-	{
-		result = stringListFileMatched (Excluded, base);
-		if (! result  &&  name != base)
-			result = stringListFileMatched (Excluded, name);
-	}
+	if (Excluded == NULL)
+		return false;
+
+	compileExcludeListsMaybe ();
+
+	result = globSetMatched (ExcludedSet, base);
+	if (! result  &&  name != base)
+		result = globSetMatched (ExcludedSet, name);
 
-	if (result && ExcludedException != NULL)
+	if (result)
 	{
 		bool result_exception;
 
-		result_exception = stringListFileMatched (ExcludedException, base);
+		result_exception = globSetMatched (ExcludedExceptionSet, base);
 		if (! result_exception && name != base)
-			result_exception = stringListFileMatched (ExcludedException, name);
+			result_exception = globSetMatched (ExcludedExceptionSet, name);
 
 		if (result_exception)
 			result = false;
@@ -1213,6 +1313,74 @@ extern bool isExcludedFile (const char* const name,
 	return result;
 }
 
+static int compareFileNamePrefix (const char *const a, const char *const b, size_t n)
+{
+#ifdef CASE_INSENSITIVE_FILENAMES
+	return strncasecmp (a, b, n);
+#else
+	return strncmp (a, b, n);
+#endif
+}
+
+static size_t literalPrefixLength (const char *const pattern)
+{
+	return strcspn (pattern, "*?[\\");
+}
+
+/*  Return true if all the files under the directory NAME are excluded.
+ *
+ *  Without --exclude-exception, an excluded directory is skipped at the
+ *  early stage. With it, the files under the directory are matched one
+ *  by one. The directory can still be skipped as a whole if a "prefix*"
+ *  pattern excludes every path in it, and no exception can match any
+ *  of the paths. An exception whose literal prefix includes a path
+ *  separator never matches a base name, and matches a path only when
+ *  the prefix agrees with the path of the directory.
+ */
+extern bool isExcludedDirectory (const char *const name)
+{
+	bool allExcluded = false;
+	vString *dir;
+	unsigned int i;
+
+	if (Excluded == NULL || ExcludedException == NULL
+		|| stringListCount (ExcludedException) == 0
+		|| strcmp (name, ".") == 0)
+		return false;
+
+	dir = vStringNewInit (name);
+#if defined (WIN32)
+	vStringTranslate (dir, PATH_SEPARATOR, OUTPUT_PATH_SEPARATOR);
+#endif
+	if (vStringLength (dir) == 0 || vStringLast (dir) != OUTPUT_PATH_SEPARATOR)
+		vStringPut (dir, OUTPUT_PATH_SEPARATOR);
+
+	for (i = 0; ! allExcluded && i < stringListCount (Excluded); i++)
+	{
+		const char *const pattern = vStringValue (stringListItem (Excluded, i));
+		const size_t length = literalPrefixLength (pattern);
+
+		if (pattern [length] == '*' && pattern [length + 1] == '\0'
+			&& length <= vStringLength (dir)
+			&& compareFileNamePrefix (vStringValue (dir), pattern, length) == 0)
+			allExcluded = true;
+	}
+
+	for (i = 0; allExcluded && i < stringListCount (ExcludedException); i++)
+	{
+		const char *const pattern = vStringValue (stringListItem (ExcludedException, i));
+		const size_t length = literalPrefixLength (pattern);
+		const size_t common = (length < vStringLength (dir))? length: vStringLength (dir);
+
+		if (memchr (pattern, OUTPUT_PATH_SEPARATOR, length) == NULL
+			|| compareFileNamePrefix (vStringValue (dir), pattern, common) == 0)
+			allExcluded = false;
+	}
+
+	vStringDelete (dir);
+	return allExcluded;
+}
+
 static void processExcmdOption (
 		const char *const option, const char *const parameter)
 {
@@ -1629,6 +1797,17 @@ static void processHelpFullOption (
 }
 
 #ifdef HAVE_JANSSON
+/*  Set up the things shared by --_interactive and --_server. */
+static void setInteractiveMode (void)
+{
+	Option.sorted = SO_UNSORTED;
+	setErrorPrinter (jsonErrorPrinter, NULL);
+	setTagWriter (WRITER_JSON, NULL);
+	enablePtag (PTAG_JSON_OUTPUT_VERSION, true);
+
+	json_set_alloc_funcs (eMalloc, eFree);
+}
+
 static void processInteractiveOption (
 		const char *const option CTAGS_ATTR_UNUSED,
 		const char *const parameter)
@@ -1665,13 +1844,25 @@ static void processInteractiveOption (
 		error (FATAL, "sandbox submode does not work if gcov is instrumented");
 #endif
 
-	Option.sorted = SO_UNSORTED;
+	setInteractiveMode ();
 	setMainLoop (interactiveLoop, &args);
-	setErrorPrinter (jsonErrorPrinter, NULL);
-	setTagWriter (WRITER_JSON, NULL);
-	enablePtag (PTAG_JSON_OUTPUT_VERSION, true);
+}
+#endif
 
-	json_set_alloc_funcs (eMalloc, eFree);
+#ifdef SERVER_SUPPORTED
+static void processServerOption (const char *const option,
+								 const char *const parameter)
+{
+	static struct serverModeArgs args;
+
+	if (parameter == NULL || parameter[0] == '\0')
+		error (FATAL, "A parameter is needed after \"%s\" option", option);
+
+	Option.interactive = INTERACTIVE_DEFAULT;
+	args.socketPath = eStrdup (parameter);
+
+	setInteractiveMode ();
+	setMainLoop (serverLoop, &args);
 }
 #endif
 
@@ -2481,6 +2672,43 @@ static void processSortOption (
 		error (FATAL, "Invalid value for \"%s\" option", option);
 }
 
+static void processSortMemoryOption (
+		const char *const option, const char *const parameter)
+{
+	unsigned long size;
+	unsigned long unit = 1;
+	char *digits;
+
+	if (parameter == NULL || parameter[0] == '\0')
+		error (FATAL, "A parameter is needed after \"%s\" option", option);
+
+	digits = eStrdup (parameter);
+	switch (digits [strlen (digits) - 1])
+	{
+	case 'k': case 'K':
+		unit = 1024UL;
+		break;
+	case 'm': case 'M':
+		unit = 1024UL * 1024;
+		break;
+	case 'g': case 'G':
+		unit = 1024UL * 1024 * 1024;
+		break;
+	}
+	if (unit > 1)
+		digits [strlen (digits) - 1] = '\0';
+
+	if (!strToULong (digits, 10, &size) || size == 0
+		|| size > ((size_t) -1) / unit)
+		error (FATAL, "-%s: Invalid memory size: %s", option, parameter);
+	eFree (digits);
+
+	Option.sortMemory = (size_t) size * unit;
+#ifdef EXTERNAL_SORT
+	verbose ("--%s is ignored; tags are sorted with sort command\n", option);
+#endif
+}
+
 static void processTagRelative (
 		const char *const option, const char *const parameter)
 {
@@ -2500,11 +2728,13 @@ static void processTotals (
 		const char *const option, const char *const parameter)
 {
 	if (isFalse (parameter))
-		Option.printTotals = 0;
+		Option.printTotals = TOTALS_NO;
 	else if (isTrue (parameter) || *parameter == '\0')
-		Option.printTotals = 1;
+		Option.printTotals = TOTALS_YES;
 	else if (strcasecmp (parameter, "extra") == 0)
-		Option.printTotals = 2;
+		Option.printTotals = TOTALS_EXTRA;
+	else if (strcasecmp (parameter, "json") == 0)
+		Option.printTotals = TOTALS_JSON;
 	else
 		error (FATAL, "Invalid value for \"%s\" option", option);
 }
@@ -2616,6 +2846,21 @@ static void processAnonHashOption (const char *const option CTAGS_ATTR_UNUSED, c
 	exit (0);
 }
 
+static void processBenchHashTableOption (const char *const option CTAGS_ATTR_UNUSED, const char *const parameter CTAGS_ATTR_UNUSED)
+{
+	benchHashTable (stdout);
+}
+
+static void processTestHashTableOption (const char *const option CTAGS_ATTR_UNUSED, const char *const parameter CTAGS_ATTR_UNUSED)
+{
+	testHashTable (stdout);
+}
+
+static void processBenchKeywordsOption (const char *const option CTAGS_ATTR_UNUSED, const char *const parameter CTAGS_ATTR_UNUSED)
+{
+	benchKeywordTable (stdout);
+}
+
 static void processDumpKeywordsOption (const char *const option CTAGS_ATTR_UNUSED, const char *const parameter CTAGS_ATTR_UNUSED)
 {
 	dumpKeywordTable (stdout);
@@ -2755,6 +3000,60 @@ static void processMaxRecursionDepthOption (const char *const option, const char
 	Option.maxRecursionDepth = atol(parameter);
 }
 
+static void processCacheDirOption (const char *const option, const char *const parameter)
+{
+	fileStatus *status;
+
+	if (parameter == NULL || parameter[0] == '\0')
+		error (FATAL, "A parameter is needed after \"%s\" option", option);
+
+	status = eStat (parameter);
+	if (! status->exists || ! status->isDirectory)
+		error (FATAL, "--%s: No such directory: %s", option, parameter);
+
+	freeString (&Option.cacheDir);
+	Option.cacheDir = absoluteFilename (parameter);
+}
+
+static void processJobsOption (const char *const option, const char *const parameter)
+{
+	unsigned int jobs;
+
+	if (parameter == NULL || parameter[0] == '\0')
+		error (FATAL, "A parameter is needed after \"%s\" option", option);
+
+	if (!strToUInt (parameter, 0, &jobs) || jobs < 1)
+		error (FATAL, "-%s: Invalid number of jobs", option);
+
+#ifdef JOBS_SUPPORTED
+	Option.jobs = jobs;
+#else
+	if (jobs > 1)
+		error (WARNING, "--%s is not supported on this platform", option);
+#endif
+}
+
+static void processProfileRegexOption (const char *const option, const char *const parameter)
+{
+	unsigned int n;
+
+	if (parameter == NULL || parameter[0] == '\0')
+		n = 20;
+	else if (!strToUInt (parameter, 0, &n) || n < 1)
+		error (FATAL, "-%s: Invalid number of patterns", option);
+
+	Option.profileRegex = n;
+}
+
+static void processTraceEventsOption (const char *const option, const char *const parameter)
+{
+	if (parameter == NULL || parameter[0] == '\0')
+		error (FATAL, "A parameter is needed after \"%s\" option", option);
+
+	freeString (&Option.traceEvents);
+	Option.traceEvents = eStrdup (parameter);
+}
+
 static void processPatternLengthLimit(const char *const option, const char *const parameter)
 {
 	if (parameter == NULL || parameter[0] == '\0')
@@ -2801,6 +3100,7 @@ static void setBooleanToXtagWithWarning(booleanOption *const option, bool value)
 static void processDumpOptionsOption (const char *const option, const char *const parameter);
 
 static parametricOption ParametricOptions [] = {
+	{ "cache-dir",              processCacheDirOption,          true,   STAGE_ANY },
 	{ "etags-include",          processEtagsInclude,            false,  STAGE_ANY },
 	{ "exclude",                processExcludeOption,           false,  STAGE_ANY },
 	{ "exclude-exception",      processExcludeExceptionOption,  false,  STAGE_ANY },
@@ -2817,6 +3117,7 @@ static parametricOption ParametricOptions [] = {
 	{ "input-encoding",         processInputEncodingOption,     false,  STAGE_ANY },
 	{ "output-encoding",        processOutputEncodingOption,    false,  STAGE_ANY },
 #endif
+	{ "jobs",                   processJobsOption,              true,   STAGE_ANY },
 	{ "lang",                   processLanguageForceOption,     false,  STAGE_ANY },
 	{ "language",               processLanguageForceOption,     false,  STAGE_ANY },
 	{ "language-force",         processLanguageForceOption,     false,  STAGE_ANY },
@@ -2849,10 +3150,13 @@ static parametricOption ParametricOptions [] = {
 	{ "pattern-length-limit",   processPatternLengthLimit,      true,   STAGE_ANY },
 	{ "pseudo-tags",            processPseudoTags,              false,  STAGE_ANY },
 	{ "sort",                   processSortOption,              true,   STAGE_ANY },
+	{ "sort-memory",            processSortMemoryOption,        true,   STAGE_ANY },
 	{ "tag-relative",           processTagRelative,             true,   STAGE_ANY },
 	{ "totals",                 processTotals,                  true,   STAGE_ANY },
 	{ "version",                processVersionOption,           true,   STAGE_ANY },
 	{ "_anonhash",              processAnonHashOption,          false,  STAGE_ANY },
+	{ "_bench-htable",          processBenchHashTableOption,    false,  STAGE_ANY },
+	{ "_bench-keywords",        processBenchKeywordsOption,     false,  STAGE_ANY },
 	{ "_dump-keywords",         processDumpKeywordsOption,      false,  STAGE_ANY },
 	{ "_dump-options",          processDumpOptionsOption,       false,  STAGE_ANY },
 	{ "_echo",                  processEchoOption,              false,  STAGE_ANY },
@@ -2864,14 +3168,21 @@ static parametricOption ParametricOptions [] = {
 	{ "_list-kinddef-flags",     processListKinddefFlagsOptions, true,   STAGE_ANY },
 	{ "_list-langdef-flags",     processListLangdefFlagsOptions, true,   STAGE_ANY },
 	{ "_list-mtable-regex-flags", processListMultitableRegexFlagsOptions, true, STAGE_ANY },
+	{ "_profile-regex",         processProfileRegexOption,      false,  STAGE_ANY },
+#ifdef SERVER_SUPPORTED
+	{ "_server",                processServerOption,            true,   STAGE_ANY },
+#endif
+	{ "_test-htable",           processTestHashTableOption,     false,  STAGE_ANY },
 #ifdef DO_TRACING
 	{ "_trace",                 processTraceOption,             false,  STAGE_ANY },
 #endif
+	{ "_trace-events",          processTraceEventsOption,       false,  STAGE_ANY },
 	{ "_xformat",               processXformatOption,           false,  STAGE_ANY },
 };
 
 static booleanOption BooleanOptions [] = {
 	{ "append",         &Option.append,                 true,  STAGE_ANY },
+	{ "dedup-inputs",   &Option.dedupInputs,            true,  STAGE_ANY },
 	{ "file-scope",     ((bool *)XTAG_FILE_SCOPE),   false, STAGE_ANY, setBooleanToXtagWithWarning },
 	{ "file-tags",      ((bool *)XTAG_FILE_NAMES),   false, STAGE_ANY, setBooleanToXtagWithWarning },
 	{ "filter",         &Option.filter,                 true,  STAGE_ANY },
@@ -2885,6 +3196,8 @@ static booleanOption BooleanOptions [] = {
 #ifdef RECURSE_SUPPORTED
 	{ "recurse",        &Option.recurse,                false, STAGE_ANY },
 #endif
+	{ "tag-index",      &Option.tagIndex,               true,  STAGE_ANY },
+	{ "update",         &Option.update,                 true,  STAGE_ANY },
 	{ "verbose",        &ctags_verbose,                false, STAGE_ANY },
 #ifdef WIN32
 	{ "use-slash-as-filename-separator", (bool *)&Option.useSlashAsFilenameSeparator, false, STAGE_ANY },
@@ -3440,6 +3753,8 @@ static void parseOption (cookedArgs* const args)
 	Assert (! cArgOff (args));
 	if (args->isOption)
 	{
+		noteOptionForTagCache (args->longOption, args->item, args->parameter);
+		forgetDedupedInputs ();
 		if (args->longOption)
 			processLongOption (args->item, args->parameter);
 		else
@@ -3883,9 +4198,17 @@ extern void freeOptionResources (void)
 	freeString (&Option.tagFileName);
 	freeString (&Option.fileList);
 	freeString (&Option.filterTerminator);
+	freeString (&Option.cacheDir);
+	freeString (&Option.traceEvents);
 
 	freeList (&Excluded);
 	freeList (&ExcludedException);
+	if (ExcludedSet)
+		globSetDelete (ExcludedSet);
+	if (ExcludedExceptionSet)
+		globSetDelete (ExcludedExceptionSet);
+	ExcludedSet = ExcludedExceptionSet = NULL;
+	ExcludedSetsAreStale = true;
 	freeList (&Option.headerExt);
 	freeList (&Option.etagsInclude);
 
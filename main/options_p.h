@@ -70,6 +70,13 @@ typedef enum eTagRelative {
 	TREL_NEVER,
 } tagRelative;
 
+typedef enum eTotals {
+	TOTALS_NO,
+	TOTALS_YES,
+	TOTALS_EXTRA,	/* with the statistics of the parsers */
+	TOTALS_JSON,
+} totalsType;
+
 typedef enum eOptionLoadingStage {
 	OptionLoadingStageNone,
 	OptionLoadingStageCustom,
@@ -88,6 +95,8 @@ typedef enum eOptionLoadingStage {
  */
 typedef struct sOptionValues {
 	bool append;         /* -a  append to "tags" file */
+	bool update;         /* --update  replace tags for input files in "tags" file */
+	bool tagIndex;       /* --tag-index  write index of "tags" file for readtags */
 	bool backward;       /* -B  regexp patterns search backwards */
 	bool etags;          /* -e  output Emacs style tags file */
 	exCmd locate;           /* --excmd  EX command used to locate tag */
@@ -109,7 +118,7 @@ typedef struct sOptionValues {
 	bool filter;         /* --filter  behave as filter: files in, tags out */
 	char* filterTerminator; /* --filter-terminator  string to output */
 	tagRelative tagRelative;    /* --tag-relative file paths relative to tag file */
-	int  printTotals;    /* --totals  print cumulative statistics */
+	totalsType printTotals;    /* --totals  print cumulative statistics */
 	bool lineDirectives; /* --linedirectives  process #line directives */
 	bool printLanguage;  /* --print-language */
 	bool guessLanguageEagerly; /* --guess-language-eagerly|-G */
@@ -118,6 +127,12 @@ typedef struct sOptionValues {
 	unsigned int patternLengthLimit; /* --pattern-length-limit=N */
 	bool putFieldPrefix;		 /* --put-field-prefix */
 	unsigned int maxRecursionDepth; /* --maxdepth=<max-recursion-depth> */
+	unsigned int jobs;	/* --jobs=N  the number of worker processes */
+	size_t sortMemory;	/* --sort-memory=SIZE  memory for sorting in a chunk */
+	char *cacheDir;		/* --cache-dir=DIR  directory for the tag cache */
+	bool dedupInputs;	/* --dedup-inputs  reuse the tags of identical input files */
+	unsigned int profileRegex;	/* --_profile-regex=N  the number of patterns listed */
+	char *traceEvents;	/* --_trace-events=FILE  file for the trace events */
 	enum interactiveMode { INTERACTIVE_NONE = 0,
 						   INTERACTIVE_DEFAULT,
 						   INTERACTIVE_SANDBOX, } interactive; /* --interactive */
@@ -161,6 +176,7 @@ extern const char* cArgItem (cookedArgs* const current);
 extern void cArgForth (cookedArgs* const current);
 extern bool isExcludedFile (const char* const name,
 							bool falseIfExceptionsAreDefeind);
+extern bool isExcludedDirectory (const char *const name);
 extern bool isIncludeFile (const char *const fileName);
 extern void parseCmdlineOptions (cookedArgs* const cargs);
 extern void previewFirstOption (cookedArgs* const cargs);
@@ -19,12 +19,16 @@
 
 #include <string.h>
 
+#include "cache_p.h"
 #include "ctags.h"
 #include "debug.h"
+#include "dedup_p.h"
 #include "entry_p.h"
 #include "field_p.h"
 #include "flags_p.h"
+#include "globset_p.h"
 #include "htable.h"
+#include "jobs_p.h"
 #include "keyword.h"
 #include "lxpath_p.h"
 #include "param.h"
@@ -40,6 +44,7 @@
 #include "routines.h"
 #include "routines_p.h"
 #include "stats_p.h"
+#include "traceevent_p.h"
 #include "subparser.h"
 #include "subparser_p.h"
 #include "trace.h"
@@ -72,6 +77,12 @@ typedef struct {
 	enum specType specType;
 }  parserCandidate;
 
+/* A file name pattern or an extension of a language in the index */
+struct languageMapEntry {
+	langType language;
+	vString *spec;
+};
+
 typedef struct sParserObject {
 	parserDefinition *def;
 
@@ -151,6 +162,15 @@ static parserDefinitionFunc* BuiltInParsers[] = {
 static parserObject* LanguageTable = NULL;
 static unsigned int LanguageCount = 0;
 static hashTable* LanguageHTable = NULL;
+
+/* The patterns and the extensions of all parsers, compiled for
+ * matching a file name at once. The index is rebuilt at the first
+ * lookup after the language maps are changed. */
+static globSet* LanguagePatternIndex = NULL;
+static globSet* LanguageExtensionIndex = NULL;
+static ptrArray* LanguageMapEntries = NULL;
+static ptrArray* LanguageMapMatches = NULL;
+static bool LanguageMapIndexIsStale = true;
 static kindDefinition defaultFileKind = {
 	.enabled     = false,
 	.letter      = KIND_FILE_DEFAULT_LETTER,
@@ -459,61 +479,134 @@ extern langType getLanguageForCommand (const char *const command, langType start
 											&tmp_specType);
 }
 
-static langType getPatternLanguageAndSpec (const char *const baseName, langType start_index,
-					   const char **const spec, enum specType *specType)
+static void invalidateLanguageMapIndex (void)
+{
+	LanguageMapIndexIsStale = true;
+}
+
+static void addLanguageMapEntries (globSet *index, const langType language,
+								   stringList *const map, bool asPattern)
 {
-	langType result = LANG_IGNORE;
 	unsigned int i;
 
-	if (start_index == LANG_AUTO)
-	        start_index = 0;
-	else if (start_index == LANG_IGNORE || start_index >= (int) LanguageCount)
-		return result;
+	if (map == NULL)
+		return;
 
-	*spec = NULL;
-	for (i = start_index  ;  i < LanguageCount  &&  result == LANG_IGNORE  ;  ++i)
+	for (i = 0; i < stringListCount (map); ++i)
 	{
-		parserObject *parser = LanguageTable + i;
-		stringList* const ptrns = parser->currentPatterns;
-		vString* tmp;
+		struct languageMapEntry *entry = xMalloc (1, struct languageMapEntry);
 
-		/* isLanguageEnabled is not used here.
-		   It calls initializeParser which takes
-		   cost. */
-		if (! parser->def->enabled)
-			continue;
+		entry->language = language;
+		entry->spec = stringListItem (map, i);
+		ptrArrayAdd (LanguageMapEntries, entry);
+		if (asPattern)
+			globSetAddPattern (index, vStringValue (entry->spec), entry);
+		else
+			globSetAddLiteral (index, vStringValue (entry->spec), entry);
+	}
+}
 
-		if (ptrns != NULL && (tmp = stringListFileFinds (ptrns, baseName)))
-		{
-			result = i;
-			*spec = vStringValue(tmp);
-			*specType = SPEC_PATTERN;
-			goto found;
-		}
+static void buildLanguageMapIndex (void)
+{
+	unsigned int i;
+
+	if (! LanguageMapIndexIsStale)
+		return;
+
+	if (LanguageMapEntries == NULL)
+	{
+		LanguagePatternIndex = globSetNew ();
+		LanguageExtensionIndex = globSetNew ();
+		LanguageMapEntries = ptrArrayNew (eFree);
+		LanguageMapMatches = ptrArrayNew (NULL);
+	}
+	else
+	{
+		globSetClear (LanguagePatternIndex);
+		globSetClear (LanguageExtensionIndex);
+		ptrArrayClear (LanguageMapEntries);
 	}
 
-	for (i = start_index  ;  i < LanguageCount  &&  result == LANG_IGNORE  ;  ++i)
+	/* The order of the entries, by language and then by the position
+	 * in the map, decides the spec chosen for a file name. */
+	for (i = 0; i < LanguageCount; ++i)
 	{
 		parserObject *parser = LanguageTable + i;
-		stringList* const exts = parser->currentExtensions;
-		vString* tmp;
+
+		addLanguageMapEntries (LanguagePatternIndex, i, parser->currentPatterns, true);
+		addLanguageMapEntries (LanguageExtensionIndex, i, parser->currentExtensions, false);
+	}
+
+	LanguageMapIndexIsStale = false;
+}
+
+static void freeLanguageMapIndex (void)
+{
+	if (LanguageMapEntries == NULL)
+		return;
+
+	globSetDelete (LanguagePatternIndex);
+	globSetDelete (LanguageExtensionIndex);
+	ptrArrayDelete (LanguageMapEntries);
+	ptrArrayDelete (LanguageMapMatches);
+	LanguagePatternIndex = NULL;
+	LanguageExtensionIndex = NULL;
+	LanguageMapEntries = NULL;
+	LanguageMapMatches = NULL;
+	LanguageMapIndexIsStale = true;
+}
+
+/*  Return the first enabled language at START_INDEX or after it in
+ *  LanguageMapMatches. */
+static langType findLanguageMapMatch (langType start_index, const char **const spec)
+{
+	unsigned int i;
+
+	for (i = 0; i < ptrArrayCount (LanguageMapMatches); ++i)
+	{
+		struct languageMapEntry *entry = ptrArrayItem (LanguageMapMatches, i);
 
 		/* isLanguageEnabled is not used here.
 		   It calls initializeParser which takes
 		   cost. */
-		if (! parser->def->enabled)
-			continue;
-
-		if (exts != NULL && (tmp = stringListExtensionFinds (exts,
-								     fileExtension (baseName))))
+		if (entry->language >= start_index
+			&& LanguageTable [entry->language].def->enabled)
 		{
-			result = i;
-			*spec = vStringValue(tmp);
-			*specType = SPEC_EXTENSION;
-			goto found;
+			*spec = vStringValue (entry->spec);
+			return entry->language;
 		}
 	}
-found:
+	return LANG_IGNORE;
+}
+
+static langType getPatternLanguageAndSpec (const char *const baseName, langType start_index,
+					   const char **const spec, enum specType *specType)
+{
+	langType result = LANG_IGNORE;
+
+	if (start_index == LANG_AUTO)
+	        start_index = 0;
+	else if (start_index == LANG_IGNORE || start_index >= (int) LanguageCount)
+		return result;
+
+	*spec = NULL;
+	buildLanguageMapIndex ();
+
+	ptrArrayClear (LanguageMapMatches);
+	globSetFindAll (LanguagePatternIndex, baseName, LanguageMapMatches);
+	result = findLanguageMapMatch (start_index, spec);
+	if (result != LANG_IGNORE)
+	{
+		*specType = SPEC_PATTERN;
+		return result;
+	}
+
+	ptrArrayClear (LanguageMapMatches);
+	globSetFindAll (LanguageExtensionIndex, fileExtension (baseName), LanguageMapMatches);
+	result = findLanguageMapMatch (start_index, spec);
+	if (result != LANG_IGNORE)
+		*specType = SPEC_EXTENSION;
+
 	return result;
 }
 
@@ -735,7 +828,133 @@ nominateLanguageCandidatesForPattern(const char *const baseName, parserCandidate
 	return count;
 }
 
-static vString* extractEmacsModeAtFirstLine(MIO* input);
+/*  The beginning and the end of the file whose language is being guessed.
+ *  Each of them is read from the file at most once, and then shared by
+ *  the tasters and the selectors. A line longer than them is cut.
+ */
+#define SAMPLE_HEAD_SIZE 8192
+#define SAMPLE_TAIL_SIZE 4096
+
+static struct inputSample {
+	bool active;				/* a file is being guessed */
+	bool headRead;
+	bool tailRead;
+	bool whole;					/* the head has all the bytes of the file */
+	char *headBuffer;
+	size_t headLength;
+	char *tailBuffer;
+	const char *tail;			/* in tailBuffer, or in headBuffer if whole */
+	size_t tailLength;
+} InputSample;
+
+static void resetInputSample (bool active)
+{
+	InputSample.active = active;
+	InputSample.headRead = false;
+	InputSample.tailRead = false;
+}
+
+static void freeInputSample (void)
+{
+	if (InputSample.headBuffer)
+		eFree (InputSample.headBuffer);
+	if (InputSample.tailBuffer)
+		eFree (InputSample.tailBuffer);
+	memset (&InputSample, 0, sizeof (InputSample));
+}
+
+static const char *getSampleHead (MIO *input, size_t *length)
+{
+	struct inputSample *const sample = &InputSample;
+
+	if (! sample->headRead)
+	{
+		if (sample->headBuffer == NULL)
+			sample->headBuffer = xMalloc (SAMPLE_HEAD_SIZE, char);
+		mio_rewind (input);
+		sample->headLength = mio_read (input, sample->headBuffer, 1, SAMPLE_HEAD_SIZE);
+		sample->whole = (sample->headLength < SAMPLE_HEAD_SIZE);
+		sample->headRead = true;
+	}
+
+	*length = sample->headLength;
+	return sample->headBuffer;
+}
+
+static const char *getSampleTail (MIO *input, size_t *length)
+{
+	struct inputSample *const sample = &InputSample;
+
+	if (! sample->tailRead)
+	{
+		size_t headLength;
+		const char *const head = getSampleHead (input, &headLength);
+
+		if (sample->whole)
+		{
+			sample->tailLength = (headLength < SAMPLE_TAIL_SIZE)? headLength: SAMPLE_TAIL_SIZE;
+			sample->tail = head + headLength - sample->tailLength;
+		}
+		else
+		{
+			if (sample->tailBuffer == NULL)
+				sample->tailBuffer = xMalloc (SAMPLE_TAIL_SIZE, char);
+			if (mio_seek (input, -SAMPLE_TAIL_SIZE, SEEK_END) == 0)
+				sample->tailLength = mio_read (input, sample->tailBuffer, 1, SAMPLE_TAIL_SIZE);
+			else
+				sample->tailLength = 0;
+			sample->tail = sample->tailBuffer;
+		}
+		sample->tailRead = true;
+	}
+
+	*length = sample->tailLength;
+	return sample->tail;
+}
+
+extern const char *getInputSampleHead (MIO *input, size_t *length, bool *whole)
+{
+	const char *head;
+
+	if (! InputSample.active)
+		return NULL;
+
+	head = getSampleHead (input, length);
+	*whole = InputSample.whole;
+	return head;
+}
+
+/*  Copy the line at *OFFSET of DATA into VLINE as readLineRaw() reads a
+ *  line, and move *OFFSET to the next line. Return NULL at the end of DATA,
+ *  leaving VLINE as it is.
+ */
+static const char *copySampleLine (vString *const vLine, const char *const data,
+								   size_t length, size_t *offset)
+{
+	const char *const start = data + *offset;
+	const char *newline;
+	size_t n;
+
+	if (*offset >= length)
+		return NULL;
+
+	vStringClear (vLine);
+	newline = memchr (start, '\n', length - *offset);
+	n = newline? (size_t) (newline - start) + 1: length - *offset;
+	*offset += n;
+
+	if (newline && n > 1 && start [n - 2] == '\r')
+	{
+		vStringNCatSUnsafe (vLine, start, n - 2);
+		vStringPut (vLine, '\n');
+	}
+	else
+		vStringNCatSUnsafe (vLine, start, n);
+	return vStringValue (vLine);
+}
+
+static vString* extractEmacsModeAtLine (const char *const head, size_t length,
+										size_t offset);
 
 /*  The name of the language interpreter, either directly or as the argument
  *  to "env".
@@ -757,8 +976,10 @@ static vString* determineInterpreter (const char* const cmd)
 
 static vString* extractInterpreter (MIO* input)
 {
+	size_t length, offset = 0;
+	const char* const head = getSampleHead (input, &length);
 	vString* const vLine = vStringNew ();
-	const char* const line = readLineRaw (vLine, input);
+	const char* const line = copySampleLine (vLine, head, length, &offset);
 	vString* interpreter = NULL;
 
 	if (line != NULL  &&  line [0] == '#'  &&  line [1] == '!')
@@ -773,7 +994,7 @@ static vString* extractInterpreter (MIO* input)
 		   line if the first line specifies an
 		   interpreter.  */
 
-		interpreter = extractEmacsModeAtFirstLine(input);
+		interpreter = extractEmacsModeAtLine (head, length, offset);
 		if (!interpreter)
 		{
 			const char* const lastSlash = strrchr (line, '/');
@@ -830,10 +1051,11 @@ out:
 
 }
 
-static vString* extractEmacsModeAtFirstLine(MIO* input)
+static vString* extractEmacsModeAtLine (const char *const head, size_t length,
+										size_t offset)
 {
 	vString* const vLine = vStringNew ();
-	const char* const line = readLineRaw (vLine, input);
+	const char* const line = copySampleLine (vLine, head, length, &offset);
 	vString* mode = NULL;
 	if (line != NULL)
 		mode = determineEmacsModeAtFirstLine (line);
@@ -847,15 +1069,24 @@ static vString* extractEmacsModeAtFirstLine(MIO* input)
 	return mode;
 }
 
-static vString* determineEmacsModeAtEOF (MIO* const fp)
+static vString* extractEmacsModeAtFirstLine(MIO* input)
+{
+	size_t length;
+	const char* const head = getSampleHead (input, &length);
+
+	return extractEmacsModeAtLine (head, length, 0);
+}
+
+static vString* determineEmacsModeAtEOF (const char *const tail, size_t length)
 {
 	vString* const vLine = vStringNew ();
 	const char* line;
 	bool headerFound = false;
 	const char* p;
 	vString* mode = vStringNew ();
+	size_t offset = 0;
 
-	while ((line = readLineRaw (vLine, fp)) != NULL)
+	while ((line = copySampleLine (vLine, tail, length, &offset)) != NULL)
 	{
 		if (headerFound && ((p = strstr (line, "mode:")) != NULL))
 		{
@@ -880,6 +1111,8 @@ static vString* determineEmacsModeAtEOF (MIO* const fp)
 static vString* extractEmacsModeLanguageAtEOF (MIO* input)
 {
 	vString* mode;
+	size_t length;
+	const char* tail = getSampleTail (input, &length);
 
 	/* "48.2.4.1 Specifying File Variables" of Emacs info:
 	   ---------------------------------------------------
@@ -887,9 +1120,13 @@ static vString* extractEmacsModeLanguageAtEOF (MIO* input)
 	   variables list" near the end of the file.  The start of the
 	   local variables list should be no more than 3000 characters
 	   from the end of the file, */
-	mio_seek(input, -3000, SEEK_END);
+	if (length > 3000)
+	{
+		tail += length - 3000;
+		length = 3000;
+	}
 
-	mode = determineEmacsModeAtEOF (input);
+	mode = determineEmacsModeAtEOF (tail, length);
 	if (mode && (vStringLength (mode) == 0))
 	{
 		vStringDelete (mode);
@@ -941,31 +1178,29 @@ static vString* extractVimFileType(MIO* input)
 	vString* filetype = NULL;
 #define RING_SIZE 5
 	vString* ring[RING_SIZE];
-	int i, j;
+	unsigned int i, n;
 	unsigned int k;
 	const char* const prefix[] = {
 		"vim:", "vi:", "ex:"
 	};
+	size_t length, offset = 0;
+	const char* const tail = getSampleTail (input, &length);
 
 	for (i = 0; i < RING_SIZE; i++)
 		ring[i] = vStringNew ();
 
-	i = 0;
-	while ((readLineRaw (ring[i++], input)) != NULL)
-		if (i == RING_SIZE)
-			i = 0;
+	n = 0;
+	while (copySampleLine (ring[n % RING_SIZE], tail, length, &offset) != NULL)
+		n++;
 
-	j = i;
-	do
+	/* Look at the last lines from the last one. */
+	for (i = 0; i < RING_SIZE && i < n && !filetype; i++)
 	{
 		const char* p;
-
-		j--;
-		if (j < 0)
-			j = RING_SIZE - 1;
+		vString* const line = ring[(n - 1 - i) % RING_SIZE];
 
 		for (k = 0; k < ARRAY_SIZE(prefix); k++)
-			if ((p = strstr (vStringValue (ring[j]), prefix[k])) != NULL)
+			if ((p = strstr (vStringValue (line), prefix[k])) != NULL)
 			{
 				p += strlen(prefix[k]);
 				for ( ;  isspace ((int) *p)  ;  ++p)
@@ -973,9 +1208,9 @@ static vString* extractVimFileType(MIO* input)
 				filetype = determineVimFileType(p);
 				break;
 			}
-	} while (((i == RING_SIZE)? (j != RING_SIZE - 1): (j != i)) && (!filetype));
+	}
 
-	for (i = RING_SIZE - 1; i >= 0; i--)
+	for (i = 0; i < RING_SIZE; i++)
 		vStringDelete (ring[i]);
 #undef RING_SIZE
 
@@ -994,8 +1229,10 @@ static vString* extractMarkGeneric (MIO* input,
 									vString * (* determiner)(const char *const, void *),
 									void *data)
 {
+	size_t length, offset = 0;
+	const char* const head = getSampleHead (input, &length);
 	vString* const vLine = vStringNew ();
-	const char* const line = readLineRaw (vLine, input);
+	const char* const line = copySampleLine (vLine, head, length, &offset);
 	vString* mode = NULL;
 
 	if (line)
@@ -1348,7 +1585,6 @@ tasteLanguage (struct getLangCtx *glc, const struct taster *const tasters, int n
         langType language;
         vString* spec;
 
-        mio_rewind(glc->input);
 	spec = tasters[i].taste(glc->input);
 
         if (NULL != spec) {
@@ -1420,6 +1656,7 @@ getFileLanguageForRequestInternal (struct GetLanguageRequest *req)
 	fallback [i] = LANG_IGNORE;
 
     verbose ("Get file language for %s\n", fileName);
+    resetInputSample (true);
 
     verbose ("	pattern: %s\n", baseName);
     language = getPatternLanguage (baseName, &glc,
@@ -1475,6 +1712,7 @@ getFileLanguageForRequestInternal (struct GetLanguageRequest *req)
 			req->mtime = fstatus->mtime;
 	}
     GLC_FCLOSE(&glc);
+    resetInputSample (false);
     if (fstatus)
 	    eStatFree (fstatus);
     if (templateBaseName)
@@ -1505,7 +1743,15 @@ static langType getFileLanguageForRequest (struct GetLanguageRequest *req)
 	langType l = Option.language;
 
 	if (l == LANG_AUTO)
-		return getFileLanguageForRequestInternal(req);
+	{
+		if (! TraceEventsEnabled)
+			return getFileLanguageForRequestInternal(req);
+
+		traceEventBegin ("guessLanguage", NULL, NULL);
+		l = getFileLanguageForRequestInternal(req);
+		traceEventEnd ("guessLanguage");
+		return l;
+	}
 	else if (! isLanguageEnabled (l))
 	{
 		error (FATAL,
@@ -1570,6 +1816,7 @@ extern void installLanguageMapDefault (const langType language)
 	parserObject* parser;
 	Assert (0 <= language  &&  language < (int) LanguageCount);
 	parser = LanguageTable + language;
+	invalidateLanguageMapIndex ();
 	if (parser->currentPatterns != NULL)
 		stringListDelete (parser->currentPatterns);
 	if (parser->currentExtensions != NULL)
@@ -1644,6 +1891,7 @@ extern void installLanguageAliasesDefaults (void)
 extern void clearLanguageMap (const langType language)
 {
 	Assert (0 <= language  &&  language < (int) LanguageCount);
+	invalidateLanguageMapIndex ();
 	stringListClear ((LanguageTable + language)->currentPatterns);
 	stringListClear ((LanguageTable + language)->currentExtensions);
 }
@@ -1664,6 +1912,7 @@ static bool removeLanguagePatternMap1(const langType language, const char *const
 
 	if (ptrn != NULL && stringListDeleteItemExtension (ptrn, pattern))
 	{
+		invalidateLanguageMapIndex ();
 		verbose (" (removed from %s)", getLanguageName (language));
 		result = true;
 	}
@@ -1695,6 +1944,7 @@ extern void addLanguagePatternMap (const langType language, const char* ptrn,
 	if (exclusiveInAllLanguages)
 		removeLanguagePatternMap (LANG_AUTO, ptrn);
 	stringListAdd (parser->currentPatterns, str);
+	invalidateLanguageMapIndex ();
 }
 
 static bool removeLanguageExtensionMap1 (const langType language, const char *const extension)
@@ -1704,6 +1954,7 @@ static bool removeLanguageExtensionMap1 (const langType language, const char *co
 
 	if (exts != NULL  &&  stringListDeleteItemExtension (exts, extension))
 	{
+		invalidateLanguageMapIndex ();
 		verbose (" (removed from %s)", getLanguageName (language));
 		result = true;
 	}
@@ -1734,6 +1985,7 @@ extern void addLanguageExtensionMap (
 	if (exclusiveInAllLanguages)
 		removeLanguageExtensionMap (LANG_AUTO, extension);
 	stringListAdd ((LanguageTable + language)->currentExtensions, str);
+	invalidateLanguageMapIndex ();
 }
 
 extern void addLanguageAlias (const langType language, const char* alias)
@@ -1988,6 +2240,8 @@ extern void freeParserResources (void)
 		eFree (parser->def);
 		parser->def = NULL;
 	}
+	freeLanguageMapIndex ();
+	freeInputSample ();
 	if (LanguageTable != NULL)
 		eFree (LanguageTable);
 	LanguageTable = NULL;
@@ -2222,6 +2476,7 @@ extern void processLanguageDefineOption (
 
 	LanguageTable [def->id].currentPatterns = stringListNew ();
 	LanguageTable [def->id].currentExtensions = stringListNew ();
+	invalidateLanguageMapIndex ();
 	LanguageTable [def->id].pretendingAsLanguage = LANG_IGNORE;
 	LanguageTable [def->id].pretendedAsLanguage = LANG_IGNORE;
 
@@ -3723,6 +3978,9 @@ static rescanReason createTagsForFile (const langType language,
 
 	Assert (lang->parser || lang->parser2);
 
+	if (TraceEventsEnabled)
+		traceEventBeginWithNumber (lang->name, "pass", (long) passCount);
+
 	notifyLanguageRegexInputStart (language);
 	notifyInputStart ();
 
@@ -3734,6 +3992,14 @@ static rescanReason createTagsForFile (const langType language,
 	notifyInputEnd ();
 	notifyLanguageRegexInputEnd (language);
 
+	if (TraceEventsEnabled)
+	{
+		traceEventEnd (lang->name);
+		if (rescan != RESCAN_NONE)
+			traceEventInstant ("rescan", "reason",
+							   (rescan == RESCAN_FAILED)? "failed": "append");
+	}
+
 	return rescan;
 }
 
@@ -3798,7 +4064,7 @@ static subparser* teardownLanguageSubparsersInUse (const langType language)
 
 static void	initializeParserStats (parserObject *parser)
 {
-	if (Option.printTotals > 1 && parser->used == 0 && parser->def->initStats)
+	if (Option.printTotals == TOTALS_EXTRA && parser->used == 0 && parser->def->initStats)
 		parser->def->initStats (parser->def->id);
 	parser->used = 1;
 }
@@ -3815,6 +4081,7 @@ extern void printParserStatisticsIfUsed (langType language)
 			fputs("==============================================\n", stderr);
 			parser->def->printStats (language);
 		}
+		printLanguageRegexStatistics (language);
 		printLanguageMultitableStatistics (language);
 	}
 }
@@ -3913,6 +4180,9 @@ extern bool runParserInNarrowedInputStream (const langType language,
 			 startLine, startCharOffset, sourceLineOffset,
 			 endLine, endCharOffset);
 
+	statsPhase phase = switchPhase (PHASE_GUEST);
+	if (TraceEventsEnabled)
+		traceEventBegin ("promise", "language", getLanguageName (language));
 	pushNarrowedInputStream (
 				 startLine, startCharOffset,
 				 endLine, endCharOffset,
@@ -3920,6 +4190,9 @@ extern bool runParserInNarrowedInputStream (const langType language,
 				 promise);
 	tagFileResized = createTagsWithFallback1 (language, NULL);
 	popNarrowedInputStream  ();
+	if (TraceEventsEnabled)
+		traceEventEnd ("promise");
+	switchPhase (phase);
 	return tagFileResized;
 
 }
@@ -3930,14 +4203,18 @@ static bool createTagsWithFallback (
 {
 	langType exclusive_subparser = LANG_IGNORE;
 	bool tagFileResized = false;
+	statsPhase phase;
 
 	Assert (0 <= language  &&  language < (int) LanguageCount);
 
+	phase = switchPhase (PHASE_READING);
 	if (!openInputFile (fileName, language, mio, mtime))
 	{
+		switchPhase (phase);
 		*failureInOpenning = true;
 		return false;
 	}
+	switchPhase (PHASE_PARSING);
 	*failureInOpenning = false;
 
 	tagFileResized = createTagsWithFallback1 (language,
@@ -3949,7 +4226,9 @@ static bool createTagsWithFallback (
 				  : exclusive_subparser);
 	makeFileTag (fileName);
 	popLanguage ();
+	switchPhase (PHASE_READING);
 	closeInputFile ();
+	switchPhase (phase);
 
 	return tagFileResized;
 }
@@ -4040,6 +4319,24 @@ static void addParserPseudoTags (langType language)
 	parserObject *parser = LanguageTable + language;
 	if (!parser->pseudoTagPrinted)
 	{
+		/* The tags of an input file stored in the tag cache must not
+		   include the pseudo tags, which are emitted only once. They
+		   are emitted at the noted place when the tags are used. */
+		if (isTagCacheRecording ())
+		{
+			notePseudoTagsPositionInTagCache (language);
+			return;
+		}
+
+		/* A worker process cannot know whether another worker has
+		   already used this parser. The process merging the outputs
+		   of the workers emits the pseudo tags at the noted place. */
+		if (isJobWorker ())
+		{
+			notePseudoTagsPositionInJob (language);
+			return;
+		}
+
 		for (int i = 0; i < PTAG_COUNT; i++)
 		{
 			if (isPtagParserSpecific (i))
@@ -4049,6 +4346,12 @@ static void addParserPseudoTags (langType language)
 	}
 }
 
+extern void replayParserPseudoTags (const langType language)
+{
+	initializeParser (language);
+	addParserPseudoTags (language);
+}
+
 extern bool doesParserRequireMemoryStream (const langType language)
 {
 	Assert (0 <= language  &&  language < (int) LanguageCount);
@@ -4085,7 +4388,17 @@ extern bool doesParserRequireMemoryStream (const langType language)
 extern bool parseFile (const char *const fileName)
 {
 	TRACE_ENTER_TEXT("Parsing file %s",fileName);
-	bool bRet = parseFileWithMio (fileName, NULL, NULL);
+	if (TraceEventsEnabled)
+		traceEventBegin ("file", "name", fileName);
+	bool bRet = isTagCacheEnabled ()
+		? parseFileWithTagCache (fileName)
+		: parseFileWithMio (fileName, NULL, NULL);
+	streamTagFile ();
+	if (TraceEventsEnabled)
+	{
+		traceEventEnd ("file");
+		traceEventCounter ("tags", numTagsAdded ());
+	}
 	TRACE_LEAVE();
 	return bRet;
 }
@@ -4114,6 +4427,25 @@ static bool parseMio (const char *const fileName, langType language, MIO* mio, t
 		return teardownWriter(fileName);
 }
 
+/*  Write the tags recorded for another input file with the same content
+ *  as FILENAME, instead of parsing it. */
+static bool replayMio (const char *const fileName, langType language, time_t mtime,
+					   void *clientData)
+{
+	vString *tagPath = makeInputFileTagPath (fileName);
+	bool tagFileResized;
+
+	setupWriter (clientData);
+
+	if (isXtagEnabled (XTAG_PSEUDO_TAGS))
+		addParserPseudoTags (language);
+	replayDedupedTags (fileName, vStringValue (tagPath), mtime);
+
+	tagFileResized = teardownWriter (vStringValue (tagPath));
+	vStringDelete (tagPath);
+	return tagFileResized;
+}
+
 extern bool parseFileWithMio (const char *const fileName, MIO *mio,
 							  void *clientData)
 {
@@ -4124,9 +4456,14 @@ extern bool parseFileWithMio (const char *const fileName, MIO *mio,
 		.fileName = fileName,
 		.mio = mio,
 	};
+	fileProfile profile;
+	statsPhase phase;
 	memset (&req.mtime, 0, sizeof (req.mtime));
 
+	beginFileProfile (&profile);
+	phase = switchPhase (PHASE_DETECTION);
 	language = getFileLanguageForRequest (&req);
+	switchPhase (phase);
 	Assert (language != LANG_AUTO);
 
 	if (Option.printLanguage)
@@ -4149,7 +4486,24 @@ extern bool parseFileWithMio (const char *const fileName, MIO *mio,
 		/* TODO: checkUTF8BOM can be used to update the encodings. */
 		openConverter (getLanguageEncoding (language), Option.outputEncoding);
 #endif
-		tagFileResized = parseMio (fileName, language, req.mio, req.mtime, true, clientData);
+		/* The language may be known without opening the input file;
+		   the content is needed for looking up the same content. */
+		if (isInputDedupEnabled () && req.type == GLR_OPEN && req.mio == NULL)
+		{
+			fileStatus *status = eStat (fileName);
+			req.mtime = status->mtime;
+			eStatFree (status);
+			req.mio = getMio (fileName, "rb", false);
+		}
+
+		if (isInputDedupEnabled ()
+			&& lookupDedupedInput (fileName, language, req.mio))
+			tagFileResized = replayMio (fileName, language, req.mtime, clientData);
+		else
+		{
+			tagFileResized = parseMio (fileName, language, req.mio, req.mtime, true, clientData);
+			endDedupRecording (tagFileResized);
+		}
 		if (Option.filter && ! Option.interactive)
 			closeTagFile (tagFileResized);
 		addTotals (1, 0L, 0L);
@@ -4157,6 +4511,7 @@ extern bool parseFileWithMio (const char *const fileName, MIO *mio,
 #ifdef HAVE_ICONV
 		closeConverter ();
 #endif
+		endFileProfile (&profile, fileName, language);
 	}
 
 	if (req.type == GLR_OPEN && req.mio)
@@ -4996,12 +5351,47 @@ extern void printKinddefFlags (bool withListHeader, bool machinable, FILE *fp)
 	colprintTableDelete(table);
 }
 
+extern void printLanguageRegexStatistics (langType language)
+{
+	parserObject* const parser = LanguageTable + language;
+	printRegexStatistics (parser->lregexControlBlock);
+}
+
 extern void printLanguageMultitableStatistics (langType language)
 {
 	parserObject* const parser = LanguageTable + language;
 	printMultitableStatistics (parser->lregexControlBlock);
 }
 
+static int compareRegexProfiles (const void *a, const void *b)
+{
+	const struct regexProfile *pa = a;
+	const struct regexProfile *pb = b;
+
+	if (pa->time < pb->time)
+		return 1;
+	else if (pa->time > pb->time)
+		return -1;
+	else if (pa->calls != pb->calls)
+		return (pa->calls < pb->calls)? 1: -1;
+	return 0;
+}
+
+/*  Return the profiles of the regex patterns of all parsers, sorted by
+ *  the time spent. */
+extern ptrArray *collectLanguageRegexProfiles (void)
+{
+	ptrArray *profiles = ptrArrayNew (eFree);
+
+	for (unsigned int i = 0; i < LanguageCount; i++)
+	{
+		if (LanguageTable [i].lregexControlBlock)
+			collectRegexProfiles (LanguageTable [i].lregexControlBlock, profiles);
+	}
+	ptrArraySort (profiles, compareRegexProfiles);
+	return profiles;
+}
+
 extern void addLanguageRegexTable (const langType language, const char *name)
 {
 	parserObject* const parser = LanguageTable + language;
@@ -65,6 +65,11 @@ extern bool doesLanguageRequestAutomaticFQTag (const langType language);
 
 extern langType getNamedLanguageFull (const char *const name, size_t len, bool noPretending);
 
+/* While the language of a file is guessed, return the first bytes of the
+ * file INPUT, read once for all the tasters and selectors. *WHOLE tells
+ * whether they are all the bytes of the file. Return NULL otherwise. */
+extern const char *getInputSampleHead (MIO *input, size_t *length, bool *whole);
+
 extern kindDefinition* getLanguageKind(const langType language, int kindIndex);
 extern kindDefinition* getLanguageKindForName (const langType language, const char *kindName);
 extern roleDefinition* getLanguageRole(const langType language, int kindIndex, int roleIndex);
@@ -172,8 +177,11 @@ extern bool makeExtraDescriptionsPseudoTags (const langType language,
 					       const ptagDesc *pdesc);
 extern bool makeRoleDescriptionsPseudoTags (const langType language,
 					       const ptagDesc *pdesc);
+extern void replayParserPseudoTags (const langType language);
 
+extern void printLanguageRegexStatistics (langType language);
 extern void printLanguageMultitableStatistics (langType language);
+extern ptrArray *collectLanguageRegexProfiles (void);
 extern void printParserStatisticsIfUsed (langType lang);
 
 #endif	/* CTAGS_MAIN_PARSE_PRIVATE_H */
@@ -391,6 +391,24 @@ static void setOwnerDirectoryOfInputFile (const char *const fileName)
 	}
 }
 
+/*  Make the path of the input file written to the tag file.
+ */
+extern vString *makeInputFileTagPath (const char *const fileName)
+{
+	if (0)
+		;
+	else if (  Option.tagRelative == TREL_ALWAYS )
+		return vStringNewOwn (relativeFilename (fileName,
+							 getTagFileDirectory ()));
+	else if ( Option.tagRelative == TREL_NEVER )
+		return vStringNewOwn (absoluteFilename (fileName));
+	else if ( Option.tagRelative == TREL_NO || isAbsolutePath (fileName) )
+		return vStringNewInit (fileName);
+	else
+		return vStringNewOwn (relativeFilename (fileName,
+							 getTagFileDirectory ()));
+}
+
 static void setInputFileParametersCommon (inputFileInfo *finfo, vString *const fileName,
 					  const langType language,
 					  stringList *holder)
@@ -407,21 +425,7 @@ static void setInputFileParametersCommon (inputFileInfo *finfo, vString *const f
 			vStringDelete (finfo->tagPath);
 	}
 
-	if (0)
-		;
-	else if (  Option.tagRelative == TREL_ALWAYS )
-		finfo->tagPath =
-			vStringNewOwn (relativeFilename (vStringValue (fileName),
-							 getTagFileDirectory ()));
-	else if ( Option.tagRelative == TREL_NEVER )
-		finfo->tagPath =
-			vStringNewOwn (absoluteFilename (vStringValue (fileName)));
-	else if ( Option.tagRelative == TREL_NO || isAbsolutePath (vStringValue (fileName)) )
-		finfo->tagPath = vStringNewCopy (fileName);
-	else
-		finfo->tagPath =
-			vStringNewOwn (relativeFilename (vStringValue (fileName),
-							 getTagFileDirectory ()));
+	finfo->tagPath = makeInputFileTagPath (vStringValue (fileName));
 
 	finfo->isHeader = isIncludeFile (vStringValue (fileName));
 }
@@ -612,12 +616,19 @@ static MIO *getMioFull (const char *const fileName, const char *const openMode,
 	fileStatus *st;
 	unsigned long size;
 	unsigned char *data;
+	MIO *mio;
 
 	st = eStat (fileName);
 	size = st->size;
 	if (mtime)
 		*mtime = st->mtime;
 	eStatFree (st);
+
+	/* Map a regular file of any size if possible; a parser reads the
+	 * bytes of the file directly without copying them. */
+	if (size > 0 && (mio = mio_new_mmap (fileName)) != NULL)
+		return mio;
+
 	if ((!memStreamRequired)
 	    && (size > MAX_IN_MEMORY_FILE_SIZE || size == 0))
 		return mio_new_file (fileName, openMode);
@@ -1045,6 +1056,37 @@ extern char *readLineRaw (vString *const vLine, MIO *const mio)
 	return vStringLength (vLine) > 0 ? vStringValue (vLine) : NULL;
 }
 
+/*  Copies the line at "offset" of the bytes of a memory stream into
+ *  the line buffer as readLine() reads it, without moving the stream
+ *  position. Returns false for a line having a NUL character; readLine()
+ *  reads the line following it, too.
+ */
+static bool copyLineFromMemory (vString *const vLine, const unsigned char *const data,
+								size_t size, size_t offset)
+{
+	const unsigned char *start, *newline;
+	size_t length;
+
+	vStringClear (vLine);
+	if (offset >= size)
+		return true;
+
+	start = data + offset;
+	newline = memchr (start, '\n', size - offset);
+	length = newline? (size_t) (newline - start) + 1: size - offset;
+	if (memchr (start, '\0', length))
+		return false;
+
+	if (newline && length > 1 && start [length - 2] == '\r')
+	{
+		vStringNCatSUnsafe (vLine, (const char *) start, length - 2);
+		vStringPut (vLine, '\n');
+	}
+	else
+		vStringNCatSUnsafe (vLine, (const char *) start, length);
+	return true;
+}
+
 /*  Places into the line buffer the contents of the line referenced by
  *  "location".
  */
@@ -1053,6 +1095,25 @@ extern char *readLineFromBypass (
 {
 	MIOPos orignalPosition;
 	char *result;
+	unsigned char *data;
+	size_t size;
+	long offset;
+
+	/* A mapped or in-memory input has all the lines at hand; no need to
+	 * seek back and read the line again. This is what makes the pattern
+	 * of every tag. */
+	if ((offset = mio_memory_get_offset (File.mio, &location)) != -1
+		&& (data = mio_memory_get_data (File.mio, &size)) != NULL
+		&& copyLineFromMemory (vLine, data, size, (size_t) offset))
+	{
+		if (pSeekValue != NULL)
+			*pSeekValue = offset;
+#ifdef HAVE_ICONV
+		if (isConverting ())
+			convertString (vLine);
+#endif
+		return vStringLength (vLine) > 0 ? vStringValue (vLine) : NULL;
+	}
 
 	mio_getpos (File.mio, &orignalPosition);
 	mio_setpos (File.mio, &location);
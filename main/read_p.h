@@ -62,6 +62,7 @@ extern void *getInputFileUserData(void);
 extern unsigned int getNestedInputBoundaryInfo (unsigned long lineNumber);
 
 extern const char *getSourceFileTagPath (void);
+extern vString *makeInputFileTagPath (const char *const fileName);
 extern langType getSourceLanguage (void);
 
 extern time_t getInputFileMtime (void);
@@ -154,6 +154,8 @@ char *CurrentDirectory;
 static const char *ExecutableProgram;
 static const char *ExecutableName;
 
+static unsigned long HeapAllocationCount;	/* for --totals */
+
 /*
 *   FUNCTION PROTOTYPES
 */
@@ -222,6 +224,7 @@ extern void *eMalloc (const size_t size)
 	if (buffer == NULL && size != 0)
 		error (FATAL, "out of memory");
 
+	HeapAllocationCount++;
 	return buffer;
 }
 
@@ -232,9 +235,15 @@ extern void *eCalloc (const size_t count, const size_t size)
 	if (buffer == NULL && count != 0 && size != 0)
 		error (FATAL, "out of memory");
 
+	HeapAllocationCount++;
 	return buffer;
 }
 
+extern unsigned long countHeapAllocations (void)
+{
+	return HeapAllocationCount;
+}
+
 extern void *eRealloc (void *const ptr, const size_t size)
 {
 	void *buffer;
@@ -451,6 +460,29 @@ extern void setCurrentDirectory (void) /* TODO */
 	canonicalizePath (CurrentDirectory);
 }
 
+static void fillFileStatus (fileStatus *const file, const struct stat *const status)
+{
+	file->exists = true;
+	file->isDirectory = (bool) S_ISDIR (status->st_mode);
+	file->isNormalFile = (bool) (S_ISREG (status->st_mode));
+	file->isExecutable = (bool) ((status->st_mode &
+		(S_IXUSR | S_IXGRP | S_IXOTH)) != 0);
+	file->isSetuid = (bool) ((status->st_mode & S_ISUID) != 0);
+	file->isSetgid = (bool) ((status->st_mode & S_ISGID) != 0);
+	file->size = status->st_size;
+	file->mtime = status->st_mtime;
+#if defined (HAVE_STRUCT_STAT_ST_MTIM_TV_NSEC)
+	file->mtimeNsec = (long) status->st_mtim.tv_nsec;
+#elif defined (HAVE_STRUCT_STAT_ST_MTIMESPEC_TV_NSEC)
+	file->mtimeNsec = (long) status->st_mtimespec.tv_nsec;
+#else
+	file->mtimeNsec = 0;
+#endif
+}
+
+/* The status of a file taken by other means; see setFileStatusHint(). */
+static const fileStatus *StatHint;
+
 /* For caching of stat() calls */
 extern fileStatus *eStat (const char *const fileName)
 {
@@ -459,6 +491,12 @@ extern fileStatus *eStat (const char *const fileName)
 	if (file.name == NULL  ||  strcmp (fileName, file.name) != 0)
 	{
 		eStatFree (&file);
+		if (StatHint != NULL  &&  strcmp (fileName, StatHint->name) == 0)
+		{
+			file = *StatHint;
+			file.name = eStrdup (fileName);
+			return &file;
+		}
 		file.name = eStrdup (fileName);
 		if (lstat (file.name, &status) != 0)
 			file.exists = false;
@@ -468,22 +506,46 @@ extern fileStatus *eStat (const char *const fileName)
 			if (file.isSymbolicLink  &&  stat (file.name, &status) != 0)
 				file.exists = false;
 			else
-			{
-				file.exists = true;
-				file.isDirectory = (bool) S_ISDIR (status.st_mode);
-				file.isNormalFile = (bool) (S_ISREG (status.st_mode));
-				file.isExecutable = (bool) ((status.st_mode &
-					(S_IXUSR | S_IXGRP | S_IXOTH)) != 0);
-				file.isSetuid = (bool) ((status.st_mode & S_ISUID) != 0);
-				file.isSetgid = (bool) ((status.st_mode & S_ISGID) != 0);
-				file.size = status.st_size;
-				file.mtime = status.st_mtime;
-			}
+				fillFileStatus (&file, &status);
 		}
 	}
 	return &file;
 }
 
+/*  Make eStat() for the file of STATUS return STATUS without taking the
+ *  status again, until clearFileStatusHint() is called. STATUS must be
+ *  alive until then. */
+extern void setFileStatusHint (const fileStatus *const status)
+{
+	StatHint = status;
+}
+
+extern void clearFileStatusHint (void)
+{
+	StatHint = NULL;
+}
+
+#ifdef HAVE_FSTATAT
+/*  Take the status of NAME in the directory opened as DIRFD, in the way
+ *  eStat() does. FILE->name is not touched. This function is
+ *  thread-safe. */
+extern void statFileAt (int dirfd, const char *const name, fileStatus *const file)
+{
+	struct stat status;
+
+	if (fstatat (dirfd, name, &status, AT_SYMLINK_NOFOLLOW) != 0)
+		file->exists = false;
+	else
+	{
+		file->isSymbolicLink = (bool) S_ISLNK (status.st_mode);
+		if (file->isSymbolicLink  &&  fstatat (dirfd, name, &status, 0) != 0)
+			file->exists = false;
+		else
+			fillFileStatus (file, &status);
+	}
+}
+#endif
+
 extern void eStatFree (fileStatus *status)
 {
 	if (status->name != NULL)
@@ -71,12 +71,16 @@ typedef struct {
 
 		/* The last modified time */
 	time_t mtime;
+
+		/* The nanoseconds of the last modified time, or 0 if unknown */
+	long mtimeNsec;
 } fileStatus;
 
 /*
 *   FUNCTION PROTOTYPES
 */
 extern void freeRoutineResources (void);
+extern unsigned long countHeapAllocations (void);
 extern void setExecutableName (const char *const path);
 
 /* File system functions */
@@ -85,6 +89,11 @@ extern const char *getExecutablePath (void);
 extern void setCurrentDirectory (void);
 extern fileStatus *eStat (const char *const fileName);
 extern void eStatFree (fileStatus *status);
+extern void setFileStatusHint (const fileStatus *const status);
+extern void clearFileStatusHint (void);
+#ifdef HAVE_FSTATAT
+extern void statFileAt (int dirfd, const char *const name, fileStatus *const file);
+#endif
 extern bool doesFileExist (const char *const fileName);
 extern bool doesExecutableExist (const char *const fileName);
 extern bool isRecursiveLink (const char* const dirName);
@@ -43,6 +43,38 @@ static const char *selectByLines (MIO *input,
 				  void *userData)
 {
     char line[0x800];
+    size_t length, offset = 0;
+    bool whole;
+    const char *head = getInputSampleHead (input, &length, &whole);
+
+    /* Taste the lines in the head of the file read already, splitting
+       them as mio_gets() does. */
+    while (head && offset < length) {
+	const char *start = head + offset;
+	const char *newline = memchr (start, '\n', length - offset);
+	size_t n = newline? (size_t) (newline - start) + 1: length - offset;
+	const char *lang;
+
+	if (n > sizeof(line) - 1)
+	    n = sizeof(line) - 1;
+	else if (newline == NULL && !whole)
+	    break;		/* the rest of the line is not read yet */
+
+	memcpy (line, start, n);
+	line[n] = '\0';
+	offset += n;
+
+	lang = lineTaster (line, userData);
+	if (lang)
+	    return lang;
+    }
+
+    if (head) {
+	if (whole)
+	    return defaultLang;
+	mio_seek (input, (long) offset, SEEK_SET);
+    }
+
     while (mio_gets(input, line, sizeof(line))) {
 	const char *lang = lineTaster (line, userData);
 	if (lang)
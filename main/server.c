@@ -0,0 +1,276 @@
+/*
+*   Copyright (c) 2026, Universal Ctags Team
+*
+*   This source code is released for free distribution under the terms of the
+*   GNU General Public License version 2 or (at your option) any later version.
+*
+*   This module runs ctags as a tagging server (--_server=PATH).
+*
+*   The server listens on a unix domain socket, and speaks the protocol
+*   of the interactive mode on each connection: a line of json for each
+*   request, and lines of json for the tags and the completion of the
+*   request. The parsers are initialized once before serving, so a
+*   request costs only parsing the files in it.
+*
+*   The parsers are not reentrant. Instead of threads, N worker
+*   processes (--jobs=N) are forked from the initialized server, and
+*   each of them serves one connection at a time. The main process
+*   only replaces the workers which die, and removes the socket when
+*   it is terminated with SIGTERM or SIGINT.
+*/
+
+/*
+*   INCLUDE FILES
+*/
+#include "general.h"  /* must always come first */
+
+#include "server_p.h"
+
+#ifdef SERVER_SUPPORTED
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#ifdef HAVE_SYS_TYPES_H
+# include <sys/types.h>
+#endif
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+
+#include "error_p.h"
+#include "interactive_p.h"
+#include "parse_p.h"
+#include "routines.h"
+
+/*
+*   DATA DEFINITIONS
+*/
+static volatile sig_atomic_t ServerStopping;
+
+/*
+*   FUNCTION DEFINITIONS
+*/
+
+static void stopServer (int signum CTAGS_ATTR_UNUSED)
+{
+	ServerStopping = 1;
+}
+
+static bool isSocketListened (const struct sockaddr_un *const addr)
+{
+	int fd = socket (AF_UNIX, SOCK_STREAM, 0);
+	bool r;
+
+	if (fd == -1)
+		error (FATAL | PERROR, "cannot make a socket");
+
+	r = (connect (fd, (const struct sockaddr *) addr, sizeof (*addr)) == 0
+		 || errno != ECONNREFUSED);
+	close (fd);
+	return r;
+}
+
+/*  Remove the socket left at PATH by a server which was killed. Anything
+ *  else at PATH, and a socket some server listens on, are left as they
+ *  are. */
+static void removeStaleSocket (const char *const path,
+							   const struct sockaddr_un *const addr)
+{
+	struct stat st;
+
+	if (lstat (path, &st) == -1)
+	{
+		if (errno == ENOENT)
+			return;
+		error (FATAL | PERROR, "cannot stat %s", path);
+	}
+
+	if (! S_ISSOCK (st.st_mode))
+		error (FATAL, "%s exists and is not a socket", path);
+	if (isSocketListened (addr))
+		error (FATAL, "another server may be listening on %s", path);
+
+	if (unlink (path) == -1)
+		error (FATAL | PERROR, "cannot remove the stale socket %s", path);
+}
+
+static int listenOnSocket (const char *const path)
+{
+	struct sockaddr_un addr;
+	int fd;
+
+	if (strlen (path) >= sizeof (addr.sun_path))
+		error (FATAL, "too long socket path: %s", path);
+
+	memset (&addr, 0, sizeof (addr));
+	addr.sun_family = AF_UNIX;
+	strcpy (addr.sun_path, path);
+
+	fd = socket (AF_UNIX, SOCK_STREAM, 0);
+	if (fd == -1)
+		error (FATAL | PERROR, "cannot make a socket");
+
+	removeStaleSocket (path, &addr);
+
+	if (bind (fd, (struct sockaddr *) &addr, sizeof (addr)) == -1)
+		error (FATAL | PERROR, "cannot bind the socket to %s", path);
+	if (listen (fd, SOMAXCONN) == -1)
+		error (FATAL | PERROR, "cannot listen on %s", path);
+
+	return fd;
+}
+
+/*  Serve the connections accepted on FD, one by one, with the stdin
+ *  and the stdout connected to the client. */
+static void runServerWorker (int fd)
+{
+	int null = open ("/dev/null", O_RDWR);
+
+	signal (SIGTERM, SIG_DFL);
+	signal (SIGINT, SIG_DFL);
+	/* A client closing the connection early is not an error. */
+	signal (SIGPIPE, SIG_IGN);
+	setErrorPrinter (jsonErrorPrinter, NULL);
+
+	while (true)
+	{
+		int conn = accept (fd, NULL, NULL);
+
+		if (conn == -1)
+		{
+			if (errno == EINTR || errno == ECONNABORTED)
+				continue;
+			_exit (1);
+		}
+
+		dup2 (conn, STDIN_FILENO);
+		dup2 (conn, STDOUT_FILENO);
+		close (conn);
+		clearerr (stdin);
+		clearerr (stdout);
+
+		serveInteractiveRequests (false);
+
+		fflush (stdout);
+		dup2 (null, STDIN_FILENO);
+		dup2 (null, STDOUT_FILENO);
+	}
+}
+
+static pid_t forkServerWorker (int fd)
+{
+	pid_t pid = fork ();
+
+	if (pid == 0)
+		runServerWorker (fd);
+
+	return pid;
+}
+
+/*  Fork the workers which are not running. Return false if some of them
+ *  cannot be forked; they are forked again later. */
+static bool forkMissingWorkers (pid_t *workers, unsigned int workerCount,
+								int fd, bool *warned)
+{
+	bool r = true;
+
+	for (unsigned int w = 0; w < workerCount; w++)
+	{
+		if (workers [w] != -1)
+			continue;
+
+		workers [w] = forkServerWorker (fd);
+		if (workers [w] == -1)
+		{
+			if (! *warned)
+				error (WARNING | PERROR,
+					   "cannot fork a server worker process; trying again");
+			*warned = true;
+			r = false;
+		}
+	}
+	if (r)
+		*warned = false;
+	return r;
+}
+
+extern void serverLoop (cookedArgs *args CTAGS_ATTR_UNUSED, void *user)
+{
+	struct serverModeArgs *sargs = user;
+	unsigned int workerCount = (Option.jobs > 1)? Option.jobs: 1;
+	pid_t *workers = xMalloc (workerCount, pid_t);
+	struct sigaction sa;
+	bool warned = false;
+	int fd;
+
+	/* The json error printer is for the clients. The errors of the
+	 * server itself go to stderr, and the fatal ones stop it. */
+	setErrorPrinter (stderrDefaultErrorPrinter, NULL);
+
+	initializeParser (LANG_AUTO);
+	fd = listenOnSocket (sargs->socketPath);
+
+	memset (&sa, 0, sizeof (sa));
+	sa.sa_handler = stopServer;
+	sigemptyset (&sa.sa_mask);
+	sigaction (SIGTERM, &sa, NULL);
+	sigaction (SIGINT, &sa, NULL);
+
+	fflush (stdout);
+	fflush (stderr);
+	for (unsigned int w = 0; w < workerCount; w++)
+		workers [w] = -1;
+
+	verbose ("serving on %s with %u worker processes\n",
+			 sargs->socketPath, workerCount);
+
+	while (! ServerStopping)
+	{
+		int status;
+		bool missing = ! forkMissingWorkers (workers, workerCount, fd, &warned);
+		pid_t pid = waitpid (-1, &status, missing? WNOHANG: 0);
+
+		if (pid == -1 && errno == ECHILD && missing)
+			pid = 0;
+		if (pid == 0)
+		{
+			/* Wait for the resources for forking. */
+			sleep (1);
+			continue;
+		}
+		if (pid == -1)
+		{
+			if (errno == EINTR)
+				continue;
+			break;
+		}
+
+		for (unsigned int w = 0; w < workerCount; w++)
+		{
+			if (workers [w] == pid)
+			{
+				if (! ServerStopping)
+					error (WARNING, "a server worker process died; forking another");
+				workers [w] = -1;
+				break;
+			}
+		}
+	}
+
+	for (unsigned int w = 0; w < workerCount; w++)
+		if (workers [w] > 0)
+			kill (workers [w], SIGTERM);
+	for (unsigned int w = 0; w < workerCount; w++)
+		if (workers [w] > 0)
+			while (waitpid (workers [w], NULL, 0) == -1 && errno == EINTR)
+				;
+
+	close (fd);
+	unlink (sargs->socketPath);
+	eFree (workers);
+}
+#endif
@@ -0,0 +1,41 @@
+/*
+*   Copyright (c) 2026, Universal Ctags Team
+*
+*   This source code is released for free distribution under the terms of the
+*   GNU General Public License version 2 or (at your option) any later version.
+*
+*   main part private interface to server.c
+*/
+#ifndef CTAGS_MAIN_SERVER_PRIVATE_H
+#define CTAGS_MAIN_SERVER_PRIVATE_H
+
+/*
+*   INCLUDE FILES
+*/
+#include "general.h"  /* must always come first */
+#include "options_p.h"
+
+/*
+*   MACROS
+*/
+#if defined (HAVE_JANSSON) && defined (HAVE_FORK) && defined (HAVE_SYS_WAIT_H) \
+	&& defined (HAVE_UNISTD_H) && defined (HAVE_SYS_SOCKET_H) && defined (HAVE_SYS_UN_H)
+# define SERVER_SUPPORTED
+#endif
+
+/*
+*   DATA DECLARATIONS
+*/
+struct serverModeArgs
+{
+	const char *socketPath;
+};
+
+/*
+*   FUNCTION PROTOTYPES
+*/
+#ifdef SERVER_SUPPORTED
+extern void serverLoop (cookedArgs *args, void *user);
+#endif
+
+#endif	/* CTAGS_MAIN_SERVER_PRIVATE_H */
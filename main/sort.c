@@ -21,10 +21,14 @@
 #endif
 #include <string.h>
 #include <stdio.h>
+#if defined (HAVE_PTHREAD) && defined (HAVE_PTHREAD_H) && !defined (EXTERNAL_SORT)
+# include <pthread.h>
+#endif
 
 #include "debug.h"
 #include "entry_p.h"
 #include "options_p.h"
+#include "ptrarray.h"
 #include "read.h"
 #include "routines.h"
 #include "sort_p.h"
@@ -158,11 +162,58 @@ extern void externalSortTags (const bool toStdout, MIO *tagFile)
 #else
 
 /*
- *  These functions provide a basic internal sort. No great memory
- *  optimization is performed (e.g. recursive subdivided sorts),
- *  so have lots of memory if you have large tag files.
+ *  These functions sort the tag file without invoking an external
+ *  program.
+ *
+ *  The lines of the tag file are read into a chunk of memory as large as
+ *  --sort-memory allows. A chunk is split into slices, which are sorted in
+ *  parallel threads, and then the sorted slices are merged. If the tag file
+ *  doesn't fit in one chunk, every chunk but the last one is merged into a
+ *  run in a temporary file. At last, the runs and the slices of the last
+ *  chunk are merged into the tag file.
+ *
+ *  With --update, the old tags left in the tag file are sorted already.
+ *  They are merged with the new tags as one more run.
+ *
+ *  Lines are compared byte by byte, and only ASCII letters are folded with
+ *  --sort=foldcase. The result doesn't depend on the locale.
  */
 
+#define SORT_BLOCK_SIZE (1024 * 1024)
+#define SORT_SLICE_MIN_LINES 16384	/* no thread is used for fewer lines */
+#define SORT_MAX_THREADS 16
+#define SORT_MAX_MERGE_WAYS 64		/* the max number of runs merged at once */
+
+struct sortChunk {
+	ptrArray *blocks;			/* memory holding the lines */
+	char *block;				/* the last block */
+	size_t blockUsed;
+	size_t blockSize;
+	char **lines;
+	size_t count;
+	size_t allocated;
+	size_t memory;				/* compared with Option.sortMemory */
+};
+
+struct sortSlice {
+	char **lines;
+	size_t count;
+};
+
+struct sortRun {
+	MIO *mio;
+	char *name;
+	unsigned int level;			/* how many times the lines have been merged */
+};
+
+struct mergeSource {
+	const char *line;			/* the current line, or NULL at the end */
+	char **next;				/* for a slice in memory */
+	char **end;
+	MIO *mio;					/* for a run in a temporary file */
+	vString *vLine;
+};
+
 extern void failedSort (MIO *const mio, const char* msg)
 {
 	const char* const cannotSort = "cannot sort tag file";
@@ -174,116 +225,522 @@ extern void failedSort (MIO *const mio, const char* msg)
 		error (FATAL, "%s: %s", msg, cannotSort);
 }
 
-static int compareTagsFolded(const void *const one, const void *const two)
+static int compareLines (const char *const line1, const char *const line2)
 {
-	const char *const line1 = *(const char* const*) one;
-	const char *const line2 = *(const char* const*) two;
+	return strcmp (line1, line2);
+}
 
-	return struppercmp (line1, line2);
+static int compareLinesFolded (const char *const line1, const char *const line2)
+{
+	const unsigned char *s1 = (const unsigned char *) line1;
+	const unsigned char *s2 = (const unsigned char *) line2;
+
+	/* Fold to upper case like 'sort -f'. */
+	for (;; s1++, s2++)
+	{
+		int c1 = (*s1 >= 'a' && *s1 <= 'z')? *s1 - 'a' + 'A': *s1;
+		int c2 = (*s2 >= 'a' && *s2 <= 'z')? *s2 - 'a' + 'A': *s2;
+
+		if (c1 != c2)
+			return c1 - c2;
+		else if (c1 == '\0')
+			break;
+	}
+
+	/* Order lines differing only in case, so that the result is
+	 * always the same. */
+	return strcmp (line1, line2);
 }
 
 static int compareTags (const void *const one, const void *const two)
 {
-	const char *const line1 = *(const char* const*) one;
-	const char *const line2 = *(const char* const*) two;
+	return compareLines (*(const char* const*) one, *(const char* const*) two);
+}
 
-	return strcmp (line1, line2);
+static int compareTagsFolded (const void *const one, const void *const two)
+{
+	return compareLinesFolded (*(const char* const*) one, *(const char* const*) two);
 }
 
-static void writeSortedTags (
-		char **const table, const size_t numTags, const bool toStdout, bool newlineReplaced)
+static void initChunk (struct sortChunk *chunk)
 {
-	MIO *mio;
-	size_t i;
+	memset (chunk, 0, sizeof (*chunk));
+	chunk->blocks = ptrArrayNew (eFree);
+}
 
-	/*  Write the sorted lines back into the tag file.
-	 */
-	if (toStdout)
-		mio = mio_new_fp (stdout, NULL);
+static void clearChunk (struct sortChunk *chunk)
+{
+	ptrArrayClear (chunk->blocks);
+	chunk->block = NULL;
+	chunk->blockUsed = 0;
+	chunk->blockSize = 0;
+	chunk->count = 0;
+	chunk->memory = chunk->allocated * sizeof (char *);
+}
+
+static void finiChunk (struct sortChunk *chunk)
+{
+	ptrArrayDelete (chunk->blocks);
+	if (chunk->lines)
+		eFree (chunk->lines);
+}
+
+static void addLinePointerToChunk (struct sortChunk *chunk, char *const line)
+{
+	if (chunk->count == chunk->allocated)
+	{
+		chunk->memory -= chunk->allocated * sizeof (char *);
+		chunk->allocated = chunk->allocated? chunk->allocated * 2: 1024;
+		chunk->lines = xRealloc (chunk->lines, chunk->allocated, char *);
+		chunk->memory += chunk->allocated * sizeof (char *);
+	}
+	chunk->lines [chunk->count++] = line;
+}
+
+static void addLineToChunk (struct sortChunk *chunk, const char *const line, size_t length)
+{
+	char *copy;
+
+	if (chunk->block == NULL || chunk->blockUsed + length + 1 > chunk->blockSize)
+	{
+		chunk->blockSize = (length + 1 > SORT_BLOCK_SIZE)? length + 1: SORT_BLOCK_SIZE;
+		chunk->block = xMalloc (chunk->blockSize, char);
+		chunk->blockUsed = 0;
+		ptrArrayAdd (chunk->blocks, chunk->block);
+	}
+
+	copy = chunk->block + chunk->blockUsed;
+	memcpy (copy, line, length);
+	copy [length] = '\0';
+	chunk->blockUsed += length + 1;
+	chunk->memory += length + 1;
+	addLinePointerToChunk (chunk, copy);
+}
+
+/*  Read lines until the chunk is full. A line that doesn't fit is kept in
+ *  vLine, and *pending is set.  Returns false at the end of the tag file.
+ */
+static bool fillChunk (struct sortChunk *chunk, MIO *mio, vString *vLine,
+					   bool *pending, bool *newlineReplaced)
+{
+	while (true)
+	{
+		size_t length;
+
+		if (! *pending)
+		{
+			const char *line = readLineRaw (vLine, mio);
+			if (line == NULL)
+			{
+				if (! mio_eof (mio))
+					failedSort (mio, NULL);
+				return false;
+			}
+		}
+		*pending = false;
+
+		length = vStringLength (vLine);
+		if (length > 0 && vStringLast (vLine) == '\n')
+		{
+			length--;
+			*newlineReplaced = true;
+		}
+		if (length == 0)
+			continue;  /* ignore blank lines */
+
+		if (chunk->count > 0
+			&& chunk->memory + length + 1 + sizeof (char *) > Option.sortMemory)
+		{
+			*pending = true;
+			return true;
+		}
+		addLineToChunk (chunk, vStringValue (vLine), length);
+	}
+}
+
+static unsigned int getSortThreadCount (void)
+{
+#if defined (HAVE_PTHREAD) && defined (HAVE_PTHREAD_H) && defined (_SC_NPROCESSORS_ONLN)
+	long n = sysconf (_SC_NPROCESSORS_ONLN);
+
+	if (n < 1)
+		return 1;
+	else if (n > SORT_MAX_THREADS)
+		return SORT_MAX_THREADS;
+	return (unsigned int) n;
+#else
+	return 1;
+#endif
+}
+
+static void *sortSlice (void *data)
+{
+	struct sortSlice *slice = data;
+
+	qsort (slice->lines, slice->count, sizeof (char *),
+		   Option.sorted == SO_FOLDSORTED ? compareTagsFolded : compareTags);
+	return NULL;
+}
+
+/*  Sort the lines in the chunk as sliceCount slices, and make merge
+ *  sources for the slices.
+ */
+static void sortChunk (struct sortChunk *chunk, unsigned int sliceCount,
+					   struct mergeSource *sources)
+{
+	struct sortSlice slices [SORT_MAX_THREADS] = { { NULL, 0 } };
+#if defined (HAVE_PTHREAD) && defined (HAVE_PTHREAD_H)
+	pthread_t threads [SORT_MAX_THREADS];
+	bool started [SORT_MAX_THREADS];
+#endif
+
+	for (unsigned int i = 0; i < sliceCount; i++)
+	{
+		size_t start = chunk->count * i / sliceCount;
+		size_t end = chunk->count * (i + 1) / sliceCount;
+
+		slices [i].lines = chunk->lines + start;
+		slices [i].count = end - start;
+	}
+
+#if defined (HAVE_PTHREAD) && defined (HAVE_PTHREAD_H)
+	for (unsigned int i = 1; i < sliceCount; i++)
+		started [i] = (pthread_create (threads + i, NULL, sortSlice, slices + i) == 0);
+	sortSlice (slices + 0);
+	for (unsigned int i = 1; i < sliceCount; i++)
+	{
+		if (started [i])
+			pthread_join (threads [i], NULL);
+		else
+			sortSlice (slices + i);
+	}
+#else
+	for (unsigned int i = 0; i < sliceCount; i++)
+		sortSlice (slices + i);
+#endif
+
+	for (unsigned int i = 0; i < sliceCount; i++)
+	{
+		memset (sources + i, 0, sizeof (*sources));
+		sources [i].next = slices [i].lines;
+		sources [i].end = slices [i].lines + slices [i].count;
+	}
+}
+
+static unsigned int countSlices (struct sortChunk *chunk, unsigned int threadCount)
+{
+	size_t n = chunk->count / SORT_SLICE_MIN_LINES;
+
+	if (n < 1)
+		return 1;
+	else if (n > threadCount)
+		return threadCount;
+	return (unsigned int) n;
+}
+
+static void advanceSource (struct mergeSource *source)
+{
+	if (source->mio)
+	{
+		size_t length;
+
+		if (readLineRaw (source->vLine, source->mio) == NULL)
+		{
+			if (! mio_eof (source->mio))
+				failedSort (NULL, NULL);
+			source->line = NULL;
+			return;
+		}
+		length = vStringLength (source->vLine);
+		if (length > 0 && vStringLast (source->vLine) == '\n')
+			vStringTruncate (source->vLine, length - 1);
+		source->line = vStringValue (source->vLine);
+	}
 	else
+		source->line = (source->next < source->end)? *source->next++: NULL;
+}
+
+static void siftDown (struct mergeSource **heap, unsigned int count, unsigned int i,
+					  int (* compare) (const char *const, const char *const))
+{
+	while (true)
+	{
+		unsigned int min = i;
+		unsigned int left = 2 * i + 1;
+		unsigned int right = left + 1;
+
+		if (left < count && compare (heap [left]->line, heap [min]->line) < 0)
+			min = left;
+		if (right < count && compare (heap [right]->line, heap [min]->line) < 0)
+			min = right;
+		if (min == i)
+			break;
+
+		struct mergeSource *tmp = heap [i];
+		heap [i] = heap [min];
+		heap [min] = tmp;
+		i = min;
+	}
+}
+
+/*  Merge the sorted sources into mio. Identical lines are written only once
+ *  unless making a cross reference.
+ */
+static void mergeSources (struct mergeSource *sources, unsigned int sourceCount,
+						  MIO *mio, bool newline)
+{
+	int (* compare) (const char *const, const char *const) =
+		Option.sorted == SO_FOLDSORTED ? compareLinesFolded : compareLines;
+	struct mergeSource **heap = xMalloc (sourceCount, struct mergeSource *);
+	unsigned int count = 0;
+	vString *last = vStringNew ();
+	bool written = false;
+
+	for (unsigned int i = 0; i < sourceCount; i++)
 	{
-		mio = mio_new_file (tagFileName (), "w");
-		if (mio == NULL)
-			failedSort (mio, NULL);
+		advanceSource (sources + i);
+		if (sources [i].line)
+			heap [count++] = sources + i;
 	}
-	for (i = 0 ; i < numTags ; ++i)
+	for (unsigned int i = count / 2; i > 0; i--)
+		siftDown (heap, count, i - 1, compare);
+
+	while (count > 0)
 	{
+		const char *line = heap [0]->line;
+
 		/*  Here we filter out identical tag *lines* (including search
 		 *  pattern) if this is not an xref file.
 		 */
-		if (i == 0  ||  Option.xref  ||  strcmp (table [i], table [i-1]) != 0)
+		if (! written || Option.xref || strcmp (vStringValue (last), line) != 0)
 		{
-			if (mio_puts (mio, table [i]) == EOF)
-				failedSort (mio, NULL);
-			else if (newlineReplaced)
-				mio_putc (mio, '\n');
+			if (mio_puts (mio, line) == EOF)
+				failedSort (NULL, NULL);
+			if (newline && mio_putc (mio, '\n') == EOF)
+				failedSort (NULL, NULL);
+			vStringCopyS (last, line);
+			written = true;
 		}
+
+		advanceSource (heap [0]);
+		if (heap [0]->line == NULL)
+			heap [0] = heap [--count];
+		siftDown (heap, count, 0, compare);
 	}
-	if (toStdout)
-		mio_flush (mio);
-	mio_unref (mio);
+
+	vStringDelete (last);
+	eFree (heap);
+}
+
+static void openRun (struct sortRun *run, unsigned int level)
+{
+	run->name = NULL;
+	run->mio = tempFile ("w+b", &run->name);
+	run->level = level;
+}
+
+static void closeRun (struct sortRun *run)
+{
+	mio_unref (run->mio);
+	remove (run->name);
+	eFree (run->name);
+}
+
+static void initRunSources (struct sortRun *runs, unsigned int runCount,
+							struct mergeSource *sources)
+{
+	for (unsigned int i = 0; i < runCount; i++)
+	{
+		memset (sources + i, 0, sizeof (*sources));
+		if (mio_seek (runs [i].mio, 0, SEEK_SET) != 0)
+			failedSort (NULL, NULL);
+		sources [i].mio = runs [i].mio;
+		sources [i].vLine = vStringNew ();
+	}
+}
+
+static void finiRunSources (struct mergeSource *sources, unsigned int runCount)
+{
+	for (unsigned int i = 0; i < runCount; i++)
+		vStringDelete (sources [i].vLine);
+}
+
+/*  Merge count runs from first into a new run, which takes the place of
+ *  them.  Returns the number of runs left.
+ */
+static unsigned int mergeRuns (struct sortRun *runs, unsigned int runCount,
+							   unsigned int first, unsigned int count)
+{
+	struct mergeSource sources [SORT_MAX_MERGE_WAYS];
+	struct sortRun merged;
+
+	Assert (count <= SORT_MAX_MERGE_WAYS);
+
+	openRun (&merged, runs [first].level + 1);
+	initRunSources (runs + first, count, sources);
+	mergeSources (sources, count, merged.mio, true);
+	finiRunSources (sources, count);
+
+	for (unsigned int i = first; i < first + count; i++)
+		closeRun (runs + i);
+	runs [first] = merged;
+	memmove (runs + first + 1, runs + first + count,
+			 sizeof (*runs) * (runCount - first - count));
+	return runCount - count + 1;
+}
+
+/*  Merge the last runs if there are SORT_MAX_MERGE_WAYS runs at the same
+ *  level, so that the temporary files open at once are not too many, and
+ *  each line is merged only a few times.
+ */
+static unsigned int cascadeRuns (struct sortRun *runs, unsigned int runCount)
+{
+	while (runCount >= SORT_MAX_MERGE_WAYS
+		   && runs [runCount - SORT_MAX_MERGE_WAYS].level == runs [runCount - 1].level)
+		runCount = mergeRuns (runs, runCount,
+							  runCount - SORT_MAX_MERGE_WAYS, SORT_MAX_MERGE_WAYS);
+	return runCount;
 }
 
-extern void internalSortTags (const bool toStdout, MIO* mio, size_t numTags)
+extern void internalSortTags (const bool toStdout, MIO *const mio, MIO *const presorted)
 {
+	struct sortChunk chunk;
+	struct sortRun *runs = NULL;
+	unsigned int runCount = 0;
+	unsigned int runAllocated = 0;
+	struct mergeSource *sources;
+	unsigned int sliceCount;
+	const unsigned int extraCount = presorted? 1: 0;
+	const unsigned int threadCount = getSortThreadCount ();
 	vString *vLine = vStringNew ();
-	const char *line;
-	size_t i;
-	int (*cmpFunc)(const void *, const void *);
-	bool newlineReplaced = false;
+	bool pending = false;
+	bool newlineReplaced = (presorted != NULL);
+	MIO *out;
+
+	initChunk (&chunk);
 
-	/*  Allocate a table of line pointers to be sorted.
+	/*  Make a sorted run for each chunk but the last one.
 	 */
-	const size_t tableSize = numTags * sizeof (char *);
-	char **table = (char **) malloc (tableSize);  /* line pointers */
-	DebugStatement ( size_t mallocSize = tableSize; )  /* cumulative total */
+	while (fillChunk (&chunk, mio, vLine, &pending, &newlineReplaced))
+	{
+		struct mergeSource slices [SORT_MAX_THREADS];
 
+		if (runCount == runAllocated)
+		{
+			runAllocated = runAllocated? runAllocated * 2: 8;
+			runs = xRealloc (runs, runAllocated, struct sortRun);
+		}
 
-	cmpFunc = Option.sorted == SO_FOLDSORTED ? compareTagsFolded : compareTags;
-	if (table == NULL)
-		failedSort (mio, "out of memory");
+		sliceCount = countSlices (&chunk, threadCount);
+		sortChunk (&chunk, sliceCount, slices);
+		openRun (runs + runCount, 0);
+		mergeSources (slices, sliceCount, runs [runCount].mio, true);
+		verbose ("sort: wrote %lu lines to a temporary file\n",
+				 (unsigned long) chunk.count);
+		runCount = cascadeRuns (runs, runCount + 1);
 
-	for (i = 0  ;  i < numTags  &&  ! mio_eof (mio)  ;  )
+		clearChunk (&chunk);
+	}
+	vStringDelete (vLine);
+
+	/*  Merge the runs and the last chunk into the tag file.
+	 */
+	sliceCount = countSlices (&chunk, threadCount);
+	while (runCount + sliceCount + extraCount > SORT_MAX_MERGE_WAYS)
+	{
+		unsigned int n = runCount + sliceCount + extraCount - SORT_MAX_MERGE_WAYS + 1;
+		runCount = mergeRuns (runs, runCount, 0,
+							  (n < SORT_MAX_MERGE_WAYS)? n: SORT_MAX_MERGE_WAYS);
+	}
+
+	sources = xMalloc (runCount + sliceCount + extraCount, struct mergeSource);
+	sortChunk (&chunk, sliceCount, sources);
+	initRunSources (runs, runCount, sources + sliceCount);
+	if (presorted)
 	{
-		line = readLineRaw (vLine, mio);
-		if (line == NULL)
+		struct mergeSource *source = sources + sliceCount + runCount;
+
+		memset (source, 0, sizeof (*source));
+		source->mio = presorted;
+		source->vLine = vStringNew ();
+	}
+
+	if (toStdout)
+		out = mio_new_fp (stdout, NULL);
+	else
+	{
+		out = mio_new_file (tagFileName (), "w");
+		if (out == NULL)
+			failedSort (out, NULL);
+	}
+	mergeSources (sources, runCount + sliceCount + extraCount, out, newlineReplaced);
+	if (toStdout)
+		mio_flush (out);
+	mio_unref (out);
+
+	finiRunSources (sources + sliceCount, runCount + extraCount);
+	for (unsigned int i = 0; i < runCount; i++)
+		closeRun (runs + i);
+	if (runs)
+		eFree (runs);
+	eFree (sources);
+	finiChunk (&chunk);
+}
+
+/*  The lines are sorted where they are, without reading them again
+ *  through a stream; every newline is replaced with NUL. --sort-memory
+ *  doesn't apply, as all the lines are in memory already.
+ */
+extern void internalSortTagsInMemory (char *const data, const size_t size)
+{
+	struct sortChunk chunk;
+	struct mergeSource sources [SORT_MAX_THREADS];
+	unsigned int sliceCount;
+	bool newlineReplaced = false;
+	char *p = data;
+	char *const end = data + size;
+	MIO *out;
+
+	initChunk (&chunk);
+
+	while (p < end)
+	{
+		char *newline = memchr (p, '\n', end - p);
+		char *line = p;
+		size_t length;
+
+		if (newline)
 		{
-			if (! mio_eof (mio))
-				failedSort (mio, NULL);
-			break;
+			length = newline - p;
+			p = newline + 1;
+			newlineReplaced = true;
+			/* as readLineRaw () does */
+			if (length > 0 && line [length - 1] == '\r')
+				length--;
+			line [length] = '\0';
 		}
-		else if (*line == '\0'  ||  strcmp (line, "\n") == 0)
-			;  /* ignore blank lines */
 		else
 		{
-			const size_t stringSize = strlen (line) + 1;
-
-			table [i] = (char *) malloc (stringSize);
-			if (table [i] == NULL)
-				failedSort (mio, "out of memory");
-			DebugStatement ( mallocSize += stringSize; )
-			strcpy (table [i], line);
-			if (table[i][stringSize - 2] == '\n')
-			{
-				table[i][stringSize - 2] = '\0';
-				newlineReplaced = true;
-			}
-			++i;
+			/* No room for NUL after the last line. */
+			length = end - p;
+			p = end;
+			addLineToChunk (&chunk, line, length);
+			continue;
 		}
+
+		if (length > 0)  /* ignore blank lines */
+			addLinePointerToChunk (&chunk, line);
 	}
-	numTags = i;
-	vStringDelete (vLine);
 
-	/*  Sort the lines.
-	 */
-	qsort (table, numTags, sizeof (*table), cmpFunc);
+	sliceCount = countSlices (&chunk, getSortThreadCount ());
+	sortChunk (&chunk, sliceCount, sources);
 
-	writeSortedTags (table, numTags, toStdout, newlineReplaced);
+	out = mio_new_fp (stdout, NULL);
+	mergeSources (sources, sliceCount, out, newlineReplaced);
+	mio_flush (out);
+	mio_unref (out);
 
-	PrintStatus (("sort memory: %ld bytes\n", (long) mallocSize));
-	for (i = 0 ; i < numTags ; ++i)
-		free (table [i]);
-	free (table);
+	finiChunk (&chunk);
 }
 
 #endif
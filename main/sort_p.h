@@ -26,9 +26,11 @@ extern void catFile (MIO *mio);
 #ifdef EXTERNAL_SORT
 extern void externalSortTags (const bool toStdout, MIO *tagFile);
 #else
-extern void internalSortTags (const bool toStdout,
-			      MIO *mio,
-			      size_t numTags);
+/* The lines in presorted, if not NULL, must be sorted already.
+ * They are merged with the lines in mio without sorting. */
+extern void internalSortTags (const bool toStdout, MIO *const mio, MIO *const presorted);
+/* The lines in data are sorted in place, and written to stdout. */
+extern void internalSortTagsInMemory (char *const data, const size_t size);
 #endif
 
 /* mio is closed in this function. */
@@ -16,9 +16,14 @@
 #include "general.h"  /* must always come first */
 
 #include <stdio.h>
+#include <string.h>
 
+#include "arena_p.h"
 #include "entry_p.h"
 #include "options_p.h"
+#include "parse_p.h"
+#include "routines.h"
+#include "routines_p.h"
 #include "stats_p.h"
 
 /*
@@ -26,10 +31,63 @@
 */
 #define plural(value)  (((unsigned long)(value) == 1L) ? "" : "s")
 
+/* The number of the slowest input files reported by --totals=json */
+#define SLOWEST_FILE_COUNT 20
+
+/*
+*   DATA DECLARATIONS
+*/
+struct parserProfile {
+	unsigned long files;
+	long lines, bytes;
+	unsigned long tags;
+	double wall, cpu;
+};
+
+struct slowFile {
+	char *fileName;
+	fileProfile profile;
+};
+
 /*
 *   DATA DEFINITIONS
 */
 static struct { long files, lines, bytes; } Totals = { 0, 0, 0 };
+static struct { unsigned long hits, misses; } TagCacheTotals = { 0, 0 };
+static struct { unsigned long hits, misses; } DedupTotals = { 0, 0 };
+/* the allocations made in the worker processes of --jobs */
+static struct { unsigned long heap, arena; } AllocationTotals = { 0, 0 };
+
+/* for --totals=json */
+static bool Profiling;
+static double ProfilingStart;
+static statsPhase CurrentPhase = PHASE_OTHER;
+static double LastWall, LastCpu;
+static phaseTimes PhaseTimes;
+static struct parserProfile *ParserProfiles;
+static unsigned int ParserProfileCount;
+static struct slowFile SlowestFiles [SLOWEST_FILE_COUNT];
+static unsigned int SlowestFileCount;
+static fileProfile LastFileProfile;
+static bool HasLastFileProfile;
+
+static const char *const RegexParserTypeNames [] = {
+	[REG_PARSER_SINGLE_LINE] = "single-line",
+	[REG_PARSER_MULTI_LINE]  = "multiline",
+	[REG_PARSER_MULTI_TABLE] = "multitable",
+};
+
+static const char *const PhaseNames [PHASE_COUNT] = {
+	[PHASE_TRAVERSAL] = "traversal",
+	[PHASE_DETECTION] = "detection",
+	[PHASE_READING]   = "reading",
+	[PHASE_PARSING]   = "parsing",
+	[PHASE_GUEST]     = "guest",
+	[PHASE_WRITING]   = "writing",
+	[PHASE_SORTING]   = "sorting",
+	[PHASE_JOBS]      = "jobs",
+	[PHASE_OTHER]     = "other",
+};
 
 
 /*
@@ -44,6 +102,241 @@ extern void addTotals (
 	Totals.bytes += bytes;
 }
 
+extern void getTotals (long *const files, long *const lines, long *const bytes)
+{
+	*files = Totals.files;
+	*lines = Totals.lines;
+	*bytes = Totals.bytes;
+}
+
+extern void addTagCacheTotals (const unsigned long hits, const unsigned long misses)
+{
+	TagCacheTotals.hits += hits;
+	TagCacheTotals.misses += misses;
+}
+
+extern void getTagCacheTotals (unsigned long *const hits, unsigned long *const misses)
+{
+	*hits = TagCacheTotals.hits;
+	*misses = TagCacheTotals.misses;
+}
+
+extern void addDedupTotals (const unsigned long hits, const unsigned long misses)
+{
+	DedupTotals.hits += hits;
+	DedupTotals.misses += misses;
+}
+
+extern void getDedupTotals (unsigned long *const hits, unsigned long *const misses)
+{
+	*hits = DedupTotals.hits;
+	*misses = DedupTotals.misses;
+}
+
+extern void addAllocationTotals (const unsigned long heap, const unsigned long arena)
+{
+	AllocationTotals.heap += heap;
+	AllocationTotals.arena += arena;
+}
+
+extern void getAllocationTotals (unsigned long *const heap, unsigned long *const arena)
+{
+	*heap = AllocationTotals.heap + countHeapAllocations ();
+	*arena = AllocationTotals.arena + arenaCountAllocations ();
+}
+
+/*
+ *  Profiling for --totals=json
+ */
+
+static void sampleTime (double *const wall, double *const cpu)
+{
+#ifdef HAVE_CLOCK_GETTIME
+	struct timespec ts;
+
+	clock_gettime (CLOCK_MONOTONIC, &ts);
+	*wall = (double) ts.tv_sec + (double) ts.tv_nsec / 1e9;
+# ifdef CLOCK_PROCESS_CPUTIME_ID
+	clock_gettime (CLOCK_PROCESS_CPUTIME_ID, &ts);
+	*cpu = (double) ts.tv_sec + (double) ts.tv_nsec / 1e9;
+# else
+	*cpu = (double) clock () / CLOCKS_PER_SEC;
+# endif
+#else
+	*wall = (double) time (NULL);
+	*cpu = (double) clock () / CLOCKS_PER_SEC;
+#endif
+}
+
+extern double getMonotonicTime (void)
+{
+#ifdef HAVE_CLOCK_GETTIME
+	struct timespec ts;
+
+	clock_gettime (CLOCK_MONOTONIC, &ts);
+	return (double) ts.tv_sec + (double) ts.tv_nsec / 1e9;
+#else
+	return (double) clock () / CLOCKS_PER_SEC;
+#endif
+}
+
+/*  Add the time elapsed since the last call to the current phase. */
+static void accountPhase (void)
+{
+	double wall, cpu;
+
+	sampleTime (&wall, &cpu);
+	PhaseTimes.wall [CurrentPhase] += wall - LastWall;
+	PhaseTimes.cpu [CurrentPhase] += cpu - LastCpu;
+	LastWall = wall;
+	LastCpu = cpu;
+}
+
+extern void startProfiling (void)
+{
+	Profiling = true;
+	CurrentPhase = PHASE_OTHER;
+	sampleTime (&LastWall, &LastCpu);
+	ProfilingStart = LastWall;
+}
+
+/*  Enter PHASE, and return the phase left. Pass the returned value to
+ *  this function again when leaving PHASE. */
+extern statsPhase switchPhase (statsPhase phase)
+{
+	statsPhase previous = CurrentPhase;
+
+	if (Profiling)
+	{
+		accountPhase ();
+		CurrentPhase = phase;
+	}
+	return previous;
+}
+
+extern void getPhaseTimes (phaseTimes *times)
+{
+	if (Profiling)
+		accountPhase ();
+	*times = PhaseTimes;
+}
+
+extern void addPhaseTimes (const phaseTimes *times)
+{
+	for (unsigned int i = 0; i < PHASE_COUNT; i++)
+	{
+		PhaseTimes.wall [i] += times->wall [i];
+		PhaseTimes.cpu [i] += times->cpu [i];
+	}
+}
+
+extern void beginFileProfile (fileProfile *profile)
+{
+	if (! Profiling)
+		return;
+
+	long files;
+
+	sampleTime (&profile->wall, &profile->cpu);
+	getTotals (&files, &profile->lines, &profile->bytes);
+	profile->tags = numTagsAdded ();
+}
+
+extern void endFileProfile (fileProfile *profile, const char *const fileName,
+							langType language)
+{
+	double wall, cpu;
+	long files, lines, bytes;
+
+	if (! Profiling)
+		return;
+
+	sampleTime (&wall, &cpu);
+	getTotals (&files, &lines, &bytes);
+	profile->language = language;
+	profile->wall = wall - profile->wall;
+	profile->cpu = cpu - profile->cpu;
+	profile->lines = lines - profile->lines;
+	profile->bytes = bytes - profile->bytes;
+	profile->tags = numTagsAdded () - profile->tags;
+
+	LastFileProfile = *profile;
+	HasLastFileProfile = true;
+	addFileProfile (fileName, profile);
+}
+
+/*  Get the profile of the input file parsed last, if it is not taken yet. */
+extern bool takeLastFileProfile (fileProfile *profile)
+{
+	if (! HasLastFileProfile)
+		return false;
+
+	*profile = LastFileProfile;
+	HasLastFileProfile = false;
+	return true;
+}
+
+extern void addFileProfile (const char *const fileName, const fileProfile *profile)
+{
+	if ((unsigned int) profile->language >= ParserProfileCount)
+	{
+		unsigned int count = countParsers ();
+		if ((unsigned int) profile->language >= count)
+			count = profile->language + 1;
+		ParserProfiles = xRealloc (ParserProfiles, count, struct parserProfile);
+		memset (ParserProfiles + ParserProfileCount, 0,
+				(count - ParserProfileCount) * sizeof (*ParserProfiles));
+		ParserProfileCount = count;
+	}
+
+	struct parserProfile *p = ParserProfiles + profile->language;
+	p->files++;
+	p->lines += profile->lines;
+	p->bytes += profile->bytes;
+	p->tags += profile->tags;
+	p->wall += profile->wall;
+	p->cpu += profile->cpu;
+
+	/* Keep the slowest files sorted by the wall clock time. */
+	unsigned int i = SlowestFileCount;
+	if (i == SLOWEST_FILE_COUNT)
+	{
+		if (SlowestFiles [i - 1].profile.wall >= profile->wall)
+			return;
+		eFree (SlowestFiles [--i].fileName);
+	}
+	else
+		SlowestFileCount++;
+	for (; i > 0 && SlowestFiles [i - 1].profile.wall < profile->wall; i--)
+		SlowestFiles [i] = SlowestFiles [i - 1];
+	SlowestFiles [i].fileName = eStrdup (fileName);
+	SlowestFiles [i].profile = *profile;
+}
+
+/*  Return the peak resident set size of this process in kB, or 0 if it is
+ *  unknown. getrusage() is not used; ru_maxrss includes the high-water mark
+ *  of the process that exec'ed ctags. */
+static unsigned long peakResidentSetSize (void)
+{
+	unsigned long kb = 0;
+	char line [128];
+	FILE *fp = fopen ("/proc/self/status", "r");
+
+	if (fp == NULL)
+		return 0;
+	while (fgets (line, sizeof (line), fp) != NULL)
+	{
+		if (strncmp (line, "VmHWM:", 6) == 0)
+		{
+			if (sscanf (line + 6, "%lu", &kb) != 1)
+				kb = 0;
+			break;
+		}
+	}
+	fclose (fp);
+	return kb;
+}
+
 extern void printTotals (const clock_t *const timeStamps, bool append, sortType sorted)
 {
 	const unsigned long totalTags = numTagsTotal();
@@ -64,6 +357,24 @@ extern void printTotals (const clock_t *const timeStamps, bool append, sortType
 
 	fputc ('\n', stderr);
 
+	if (Option.cacheDir)
+		fprintf (stderr, "%lu file%s read from tag cache, %lu file%s parsed\n",
+				TagCacheTotals.hits, plural (TagCacheTotals.hits),
+				TagCacheTotals.misses, plural (TagCacheTotals.misses));
+
+	if (Option.dedupInputs)
+	{
+		const unsigned long dedupFiles = DedupTotals.hits + DedupTotals.misses;
+
+		fprintf (stderr, "%lu file%s deduplicated, %lu file%s parsed",
+				DedupTotals.hits, plural (DedupTotals.hits),
+				DedupTotals.misses, plural (DedupTotals.misses));
+		if (dedupFiles > 0)
+			fprintf (stderr, " (%.1f%% hit rate)",
+					 100.0 * DedupTotals.hits / dedupFiles);
+		fputc ('\n', stderr);
+	}
+
 	fprintf (stderr, "%lu tag%s added to tag file",
 			addedTags, plural(addedTags));
 	if (append)
@@ -78,8 +389,181 @@ extern void printTotals (const clock_t *const timeStamps, bool append, sortType
 		fputc ('\n', stderr);
 	}
 
+	unsigned long heapAllocations, arenaAllocations;
+	getAllocationTotals (&heapAllocations, &arenaAllocations);
+	fprintf (stderr, "%lu heap allocation%s, %lu arena allocation%s\n",
+			heapAllocations, plural (heapAllocations),
+			arenaAllocations, plural (arenaAllocations));
+
+	const unsigned long peakRss = peakResidentSetSize ();
+	if (peakRss > 0)
+		fprintf (stderr, "%lu kB peak resident set size\n", peakRss);
+
 #ifdef DEBUG
 	fprintf (stderr, "longest tag line = %lu\n",
 		 (unsigned long) maxTagsLine ());
 #endif
 }
+
+/*  Print S as a JSON string, quoting it and escaping the characters
+ *  JSON does not allow in a string as is. */
+extern void printJsonString (const char *s, FILE *fp)
+{
+	fputc ('"', fp);
+	for (; *s; s++)
+	{
+		unsigned char c = (unsigned char) *s;
+		if (c == '"' || c == '\\')
+			fprintf (fp, "\\%c", c);
+		else if (c < 0x20)
+			fprintf (fp, "\\u%04x", c);
+		else
+			fputc (c, fp);
+	}
+	fputc ('"', fp);
+}
+
+static int compareParserProfiles (const void *a, const void *b)
+{
+	const struct parserProfile *pa = ParserProfiles + *(const langType *) a;
+	const struct parserProfile *pb = ParserProfiles + *(const langType *) b;
+
+	if (pa->wall < pb->wall)
+		return 1;
+	else if (pa->wall > pb->wall)
+		return -1;
+	return *(const langType *) a - *(const langType *) b;
+}
+
+/*  Print the totals and the profile as a JSON object to stderr.
+ *  The times are in seconds. With --jobs, the times spent in the worker
+ *  processes are added to the phases; "wall" at the top level is the
+ *  elapsed time of the main process. */
+extern void printTotalsAsJson (bool append, sortType sorted)
+{
+	phaseTimes times;
+	double wall, cpu, totalCpu = 0.0;
+	unsigned long heapAllocations, arenaAllocations;
+	langType *languages;
+	unsigned int count = 0;
+
+	getPhaseTimes (&times);
+	sampleTime (&wall, &cpu);
+	for (unsigned int i = 0; i < PHASE_COUNT; i++)
+		totalCpu += times.cpu [i];
+	getAllocationTotals (&heapAllocations, &arenaAllocations);
+
+	fprintf (stderr, "{\"files\": %ld, \"lines\": %ld, \"bytes\": %ld,",
+			 Totals.files, Totals.lines, Totals.bytes);
+	fprintf (stderr, " \"tags\": %lu,", numTagsAdded ());
+	if (append)
+		fprintf (stderr, " \"totalTags\": %lu,", numTagsTotal ());
+	fprintf (stderr, " \"sorted\": %s,", (sorted != SO_UNSORTED)? "true": "false");
+	if (Option.cacheDir)
+		fprintf (stderr, " \"cacheHits\": %lu, \"cacheMisses\": %lu,",
+				 TagCacheTotals.hits, TagCacheTotals.misses);
+	if (Option.dedupInputs)
+		fprintf (stderr, " \"dedupHits\": %lu, \"dedupMisses\": %lu,",
+				 DedupTotals.hits, DedupTotals.misses);
+	fprintf (stderr, " \"heapAllocations\": %lu, \"arenaAllocations\": %lu,",
+			 heapAllocations, arenaAllocations);
+	const unsigned long peakRss = peakResidentSetSize ();
+	if (peakRss > 0)
+		fprintf (stderr, " \"peakResidentSetSize\": %lu,", peakRss);
+	fprintf (stderr, "\n \"wall\": %.6f, \"cpu\": %.6f,\n",
+			 wall - ProfilingStart, totalCpu);
+
+	fputs (" \"phases\": {", stderr);
+	for (unsigned int i = 0; i < PHASE_COUNT; i++)
+		fprintf (stderr, "%s\n  \"%s\": {\"wall\": %.6f, \"cpu\": %.6f}",
+				 i? ",": "", PhaseNames [i], times.wall [i], times.cpu [i]);
+	fputs ("\n },\n", stderr);
+
+	/* Parsers sorted by the wall clock time */
+	languages = xMalloc (ParserProfileCount? ParserProfileCount: 1, langType);
+	for (unsigned int i = 0; i < ParserProfileCount; i++)
+		if (ParserProfiles [i].files > 0)
+			languages [count++] = (langType) i;
+	qsort (languages, count, sizeof (*languages), compareParserProfiles);
+
+	fputs (" \"parsers\": [", stderr);
+	for (unsigned int i = 0; i < count; i++)
+	{
+		const struct parserProfile *p = ParserProfiles + languages [i];
+		fprintf (stderr, "%s\n  {\"name\": ", i? ",": "");
+		printJsonString (getLanguageName (languages [i]), stderr);
+		fprintf (stderr, ", \"files\": %lu, \"lines\": %ld, \"bytes\": %ld, \"tags\": %lu,"
+				 " \"wall\": %.6f, \"cpu\": %.6f}",
+				 p->files, p->lines, p->bytes, p->tags, p->wall, p->cpu);
+	}
+	fputs (count? "\n ],\n": "],\n", stderr);
+	eFree (languages);
+
+	fputs (" \"slowestFiles\": [", stderr);
+	for (unsigned int i = 0; i < SlowestFileCount; i++)
+	{
+		const fileProfile *p = &SlowestFiles [i].profile;
+		fprintf (stderr, "%s\n  {\"name\": ", i? ",": "");
+		printJsonString (SlowestFiles [i].fileName, stderr);
+		fputs (", \"language\": ", stderr);
+		printJsonString (getLanguageName (p->language), stderr);
+		fprintf (stderr, ", \"lines\": %ld, \"bytes\": %ld, \"tags\": %lu,"
+				 " \"wall\": %.6f, \"cpu\": %.6f}",
+				 p->lines, p->bytes, p->tags, p->wall, p->cpu);
+	}
+	fputs (SlowestFileCount? "\n ]": "]", stderr);
+
+	if (Option.profileRegex)
+	{
+		ptrArray *profiles = collectLanguageRegexProfiles ();
+
+		fputs (",\n \"regexPatterns\": [", stderr);
+		for (unsigned int i = 0; i < ptrArrayCount (profiles) && i < Option.profileRegex; i++)
+		{
+			const struct regexProfile *p = ptrArrayItem (profiles, i);
+			fprintf (stderr, "%s\n  {\"language\": ", i? ",": "");
+			printJsonString (getLanguageName (p->language), stderr);
+			fprintf (stderr, ", \"type\": \"%s\"", RegexParserTypeNames [p->regptype]);
+			if (p->table)
+			{
+				fputs (", \"table\": ", stderr);
+				printJsonString (p->table, stderr);
+			}
+			fputs (", \"pattern\": ", stderr);
+			printJsonString (p->pattern, stderr);
+			fprintf (stderr, ", \"calls\": %u, \"matches\": %u, \"time\": %.6f}",
+					 p->calls, p->matches, p->time);
+		}
+		fputs (ptrArrayCount (profiles)? "\n ]": "]", stderr);
+		ptrArrayDelete (profiles);
+	}
+	fputs ("\n}\n", stderr);
+}
+
+/*  Print the regex patterns taking the most time in regexec (). */
+extern void printRegexProfile (void)
+{
+	ptrArray *profiles = collectLanguageRegexProfiles ();
+	double total = 0.0;
+
+	for (unsigned int i = 0; i < ptrArrayCount (profiles); i++)
+		total += ((struct regexProfile *) ptrArrayItem (profiles, i))->time;
+
+	fprintf (stderr, "\nREGEX PROFILE (%u of %u patterns, %.6f seconds in total)\n",
+			 (ptrArrayCount (profiles) < Option.profileRegex)
+			 ? ptrArrayCount (profiles): Option.profileRegex,
+			 ptrArrayCount (profiles), total);
+	fputs ("==============================================\n", stderr);
+	fprintf (stderr, "%10s %10s %10s  %-16s %-16s %s\n",
+			 "seconds", "calls", "matches", "language", "table", "pattern");
+	for (unsigned int i = 0; i < ptrArrayCount (profiles) && i < Option.profileRegex; i++)
+	{
+		const struct regexProfile *p = ptrArrayItem (profiles, i);
+		fprintf (stderr, "%10.6f %10u %10u  %-16s %-16s %s\n",
+				 p->time, p->calls, p->matches,
+				 getLanguageName (p->language),
+				 p->table? p->table: RegexParserTypeNames [p->regptype],
+				 p->pattern);
+	}
+	ptrArrayDelete (profiles);
+}
@@ -17,12 +17,67 @@
 *   INCLUDE FILES
 */
 #include "general.h"  /* must always come first */
+#include <stdio.h>
+
 #include "options_p.h"
+#include "types.h"
+
+/*
+*   DATA DECLARATIONS
+*/
+
+/* Phases of the time spent by ctags, reported by --totals=json.
+ * The time spent in a phase excludes the time spent in the phases
+ * entered during it. */
+typedef enum {
+	PHASE_TRAVERSAL,		/* walking directories for --recurse */
+	PHASE_DETECTION,		/* guessing the languages of input files */
+	PHASE_READING,			/* opening and closing input files */
+	PHASE_PARSING,			/* running parsers, including writing uncorked tags */
+	PHASE_GUEST,			/* running parsers for promises (guest parsers) */
+	PHASE_WRITING,			/* flushing the cork queue, closing the tag file */
+	PHASE_SORTING,
+	PHASE_JOBS,				/* waiting for the worker processes of --jobs */
+	PHASE_OTHER,			/* everything else: options, initialization... */
+	PHASE_COUNT
+} statsPhase;
+
+typedef struct sPhaseTimes {
+	double wall [PHASE_COUNT];
+	double cpu [PHASE_COUNT];
+} phaseTimes;
+
+typedef struct sFileProfile {
+	langType language;
+	long lines, bytes;
+	unsigned long tags;
+	double wall, cpu;
+} fileProfile;
 
 /*
 *   FUNCTION PROTOTYPES
 */
 extern void addTotals (const unsigned int files, const long unsigned int lines, const long unsigned int bytes);
+extern void getTotals (long *const files, long *const lines, long *const bytes);
+extern void addTagCacheTotals (const unsigned long hits, const unsigned long misses);
+extern void getTagCacheTotals (unsigned long *const hits, unsigned long *const misses);
+extern void addDedupTotals (const unsigned long hits, const unsigned long misses);
+extern void getDedupTotals (unsigned long *const hits, unsigned long *const misses);
+extern void addAllocationTotals (const unsigned long heap, const unsigned long arena);
+extern void getAllocationTotals (unsigned long *const heap, unsigned long *const arena);
 extern void printTotals (const clock_t *const timeStamps, bool append, sortType sorted);
 
+extern double getMonotonicTime (void);
+extern void startProfiling (void);
+extern statsPhase switchPhase (statsPhase phase);
+extern void getPhaseTimes (phaseTimes *times);
+extern void addPhaseTimes (const phaseTimes *times);
+extern void beginFileProfile (fileProfile *profile);
+extern void endFileProfile (fileProfile *profile, const char *const fileName, langType language);
+extern bool takeLastFileProfile (fileProfile *profile);
+extern void addFileProfile (const char *const fileName, const fileProfile *profile);
+extern void printTotalsAsJson (bool append, sortType sorted);
+extern void printJsonString (const char *s, FILE *fp);
+extern void printRegexProfile (void);
+
 #endif  /* CTAGS_MAIN_STATS_PRIVATE_H */
@@ -0,0 +1,415 @@
+/*
+*   Copyright (c) 2026, Universal Ctags Team
+*
+*   This source code is released for free distribution under the terms of the
+*   GNU General Public License version 2 or (at your option) any later version.
+*
+*   This module writes the index of a tag file (--tag-index), which
+*   libreadtags uses for looking up tags by name without reading the tag
+*   file with binary search.
+*
+*   The index is written to a file named after the tag file with ".idx"
+*   appended. All the integers in it are big endian:
+*
+*     "ctagsIX2"               magic (8 bytes)
+*     size                     size of the tag file (8 bytes)
+*     mtime                    last modified time of the tag file (8 bytes)
+*     mtimeNsec                the nanoseconds of mtime, or 0 (4 bytes)
+*     count                    the number of indexed lines (4 bytes)
+*     blockSize                see below (4 bytes)
+*     entries [count]          in the order of names
+*     entries [count]          in the order of names with case folded
+*     fences [fenceCount]      every blockSize-th entry of the former
+*     fences [fenceCount]      every blockSize-th entry of the latter
+*
+*   where fenceCount is count / blockSize rounded up. An entry is the
+*   offset of a line in the tag file (8 bytes) followed by the first 8
+*   bytes of the name in the line (8 bytes, padded with NUL). The name is
+*   unescaped as libreadtags does, and its case is folded to upper case
+*   in the latter order. Lines with the same name are in the order in the
+*   tag file. Every line with a non-empty name is indexed, including the
+*   ones for pseudo tags.
+*
+*   A reader first does binary search in the fences, then reads one
+*   block of blockSize entries, and reads the tag file only when the
+*   first 8 bytes are not enough for comparing names. The index is used
+*   only if the size and the last modified time of the tag file are the
+*   same as the ones recorded in it. The nanoseconds tell a tag file
+*   rewritten with the same size in the same second.
+*/
+
+/*
+*   INCLUDE FILES
+*/
+#include "general.h"  /* must always come first */
+
+#include <ctype.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "debug.h"
+#include "error_p.h"
+#include "mio.h"
+#include "options.h"
+#include "routines.h"
+#include "routines_p.h"
+#include "tagindex_p.h"
+#include "vstring.h"
+
+/*
+*   MACROS
+*/
+#define TAG_INDEX_SUFFIX ".idx"
+#define TAG_INDEX_MAGIC "ctagsIX2"
+#define TAG_INDEX_MAGIC_LENGTH 8
+#define TAG_INDEX_KEY_LENGTH 8
+#define TAG_INDEX_ENTRY_SIZE (8 + TAG_INDEX_KEY_LENGTH)
+#define TAG_INDEX_BLOCK_SIZE 256
+
+/*
+*   DATA DECLARATIONS
+*/
+typedef struct sIndexedLine {
+	long offset;
+	const char *name;
+	const char *end;			/* the end of the (escaped) name */
+} indexedLine;
+
+/*
+*   FUNCTION DEFINITIONS
+*/
+
+static vString *makeIndexFileName (const char *const tagFileName)
+{
+	vString *indexFileName = vStringNewInit (tagFileName);
+
+	vStringCatS (indexFileName, TAG_INDEX_SUFFIX);
+	return indexFileName;
+}
+
+static int hexValue (const char digit)
+{
+	if ('0' <= digit && digit <= '9')
+		return digit - '0';
+	else if ('a' <= digit && digit <= 'f')
+		return 10 + digit - 'a';
+	else
+		return 10 + digit - 'A';
+}
+
+/* Same as readTagCharacter () in libreadtags/readtags.c, but never
+ * reads past END. */
+static int readNameCharacter (const char **s, const char *const end)
+{
+	const char *p = *s;
+	int c = (p < end)? (unsigned char) *p: '\0';
+
+	p++;
+	if (c == '\\' && p < end)
+	{
+		switch (*p)
+		{
+			case 't': c = '\t'; p++; break;
+			case 'r': c = '\r'; p++; break;
+			case 'n': c = '\n'; p++; break;
+			case '\\': c = '\\'; p++; break;
+			case 'a': c = '\a'; p++; break;
+			case 'b': c = '\b'; p++; break;
+			case 'v': c = '\v'; p++; break;
+			case 'f': c = '\f'; p++; break;
+			case 'x':
+				if (p + 2 < end
+					&& isxdigit ((unsigned char) p [1])
+					&& isxdigit ((unsigned char) p [2]))
+				{
+					int val = (hexValue (p [1]) << 4) | hexValue (p [2]);
+					if (val < 0x80)
+					{
+						p += 3;
+						c = val;
+					}
+				}
+				break;
+		}
+	}
+	*s = p;
+	return c;
+}
+
+static int foldCase (int c)
+{
+	return ('a' <= c && c <= 'z')? c - 'a' + 'A': c;
+}
+
+static int compareLines (const indexedLine *const a, const indexedLine *const b,
+						 const bool folding)
+{
+	const char *s1 = a->name;
+	const char *s2 = b->name;
+	int c1, c2;
+
+	do
+	{
+		c1 = readNameCharacter (&s1, a->end);
+		c2 = readNameCharacter (&s2, b->end);
+		if (folding)
+		{
+			c1 = foldCase (c1);
+			c2 = foldCase (c2);
+		}
+	} while (c1 == c2 && c1 != '\0');
+
+	if (c1 != c2)
+		return c1 - c2;
+	else if (a->offset != b->offset)
+		return (a->offset < b->offset)? -1: 1;
+	return 0;
+}
+
+static int compareLinesInOrder (const void *a, const void *b)
+{
+	return compareLines (a, b, false);
+}
+
+static int compareLinesFolded (const void *a, const void *b)
+{
+	return compareLines (a, b, true);
+}
+
+static void sortLines (indexedLine *const lines, const size_t count, const bool folding)
+{
+	int (* compare) (const void *, const void *)
+		= folding? compareLinesFolded: compareLinesInOrder;
+
+	/* A sorted tag file needs no sorting here. */
+	for (size_t i = 1; i < count; i++)
+	{
+		if (compare (lines + i - 1, lines + i) > 0)
+		{
+			qsort (lines, count, sizeof (*lines), compare);
+			break;
+		}
+	}
+}
+
+static size_t collectLines (const char *const data, const size_t size,
+							indexedLine **const pLines)
+{
+	size_t count = 0, allocated = 0;
+	indexedLine *lines = NULL;
+	const char *p = data;
+	const char *const end = data + size;
+
+	while (p < end)
+	{
+		const char *eol = memchr (p, '\n', end - p);
+		const char *nameEnd;
+
+		if (eol == NULL)
+			eol = end;
+		nameEnd = memchr (p, '\t', eol - p);
+		if (nameEnd == NULL)
+		{
+			nameEnd = eol;
+			while (nameEnd > p && nameEnd [-1] == '\r')
+				nameEnd--;
+		}
+
+		/* libreadtags skips lines with an empty name. */
+		if (nameEnd > p)
+		{
+			if (count == allocated)
+			{
+				allocated = allocated? allocated * 2: 1024;
+				lines = xRealloc (lines, allocated, indexedLine);
+			}
+			lines [count].offset = (long) (p - data);
+			lines [count].name = p;
+			lines [count].end = nameEnd;
+			count++;
+		}
+		p = eol + 1;
+	}
+
+	*pLines = lines;
+	return count;
+}
+
+static void putNumber (unsigned char *const buffer, uint64_t n, const size_t length)
+{
+	for (size_t i = length; i > 0; i--)
+	{
+		buffer [i - 1] = (unsigned char) (n & 0xff);
+		n >>= 8;
+	}
+}
+
+static bool writeEntry (MIO *const mio, const indexedLine *const line, const bool folding)
+{
+	unsigned char entry [TAG_INDEX_ENTRY_SIZE];
+	const char *s = line->name;
+
+	putNumber (entry, (uint64_t) line->offset, 8);
+	memset (entry + 8, 0, TAG_INDEX_KEY_LENGTH);
+	for (size_t i = 0; i < TAG_INDEX_KEY_LENGTH; i++)
+	{
+		int c = readNameCharacter (&s, line->end);
+		if (c == '\0')
+			break;
+		entry [8 + i] = (unsigned char) (folding? foldCase (c): c);
+	}
+	return mio_write (mio, entry, sizeof (entry), 1) == 1;
+}
+
+static bool writeEntries (MIO *const mio, const indexedLine *const lines,
+						  const size_t count, const size_t step, const bool folding)
+{
+	for (size_t i = 0; i < count; i += step)
+	{
+		if (! writeEntry (mio, lines + i, folding))
+			return false;
+	}
+	return true;
+}
+
+static bool writeIndex (MIO *const mio, const fileStatus *const status,
+						indexedLine *const lines, const size_t count)
+{
+	unsigned char header [TAG_INDEX_MAGIC_LENGTH + 8 + 8 + 4 + 4 + 4];
+	indexedLine *folded = xMalloc (count? count: 1, indexedLine);
+	bool ok;
+
+	memcpy (header, TAG_INDEX_MAGIC, TAG_INDEX_MAGIC_LENGTH);
+	putNumber (header + 8, (uint64_t) status->size, 8);
+	putNumber (header + 16, (uint64_t) status->mtime, 8);
+	putNumber (header + 24, (uint64_t) status->mtimeNsec, 4);
+	putNumber (header + 28, (uint64_t) count, 4);
+	putNumber (header + 32, TAG_INDEX_BLOCK_SIZE, 4);
+
+	sortLines (lines, count, false);
+	memcpy (folded, lines, count * sizeof (*lines));
+	sortLines (folded, count, true);
+
+	ok = (mio_write (mio, header, sizeof (header), 1) == 1
+		  && writeEntries (mio, lines, count, 1, false)
+		  && writeEntries (mio, folded, count, 1, true)
+		  && writeEntries (mio, lines, count, TAG_INDEX_BLOCK_SIZE, false)
+		  && writeEntries (mio, folded, count, TAG_INDEX_BLOCK_SIZE, true));
+
+	eFree (folded);
+	return ok;
+}
+
+static MIO *loadTagFile (const char *const tagFileName)
+{
+	MIO *mio = mio_new_mmap (tagFileName);
+
+	if (mio == NULL)
+	{
+		MIO *src = mio_new_file (tagFileName, "rb");
+		if (src == NULL)
+			return NULL;
+
+		char buffer [BUFSIZ];
+		size_t length;
+
+		mio = mio_new_memory (NULL, 0, eRealloc, eFreeNoNullCheck);
+		while ((length = mio_read (src, buffer, 1, sizeof (buffer))) > 0)
+			mio_write (mio, buffer, 1, length);
+		mio_unref (src);
+	}
+	return mio;
+}
+
+extern void writeTagIndex (const char *const tagFileName)
+{
+	vString *indexFileName = makeIndexFileName (tagFileName);
+	vString *tmpName = vStringNewCopy (indexFileName);
+	fileStatus *status;
+	indexedLine *lines = NULL;
+	size_t size, count;
+	MIO *tags, *mio;
+	bool ok;
+
+	vStringCatS (tmpName, ".tmp");
+
+	/* Refresh the status of the tag file just written. */
+	status = eStat (tagFileName);
+	eStatFree (status);
+	status = eStat (tagFileName);
+
+	tags = loadTagFile (tagFileName);
+	if (tags == NULL || ! status->exists)
+	{
+		error (WARNING | PERROR, "cannot read \"%s\" to index it", tagFileName);
+		goto out;
+	}
+
+	const char *data = (const char *) mio_memory_get_data (tags, &size);
+	count = collectLines (data? data: "", data? size: 0, &lines);
+	if (count > UINT32_MAX)
+	{
+		error (WARNING, "too many tags to index: %s", tagFileName);
+		goto out;
+	}
+	verbose ("writing the index of %lu lines to %s\n",
+			 (unsigned long) count, vStringValue (indexFileName));
+
+	mio = mio_new_file (vStringValue (tmpName), "wb");
+	if (mio == NULL)
+	{
+		error (WARNING | PERROR, "cannot write the tag index: %s", vStringValue (tmpName));
+		goto out;
+	}
+	ok = writeIndex (mio, status, lines, count);
+	if (mio_unref (mio) != 0)
+		ok = false;
+
+	if (ok)
+	{
+		remove (vStringValue (indexFileName));
+		ok = (rename (vStringValue (tmpName), vStringValue (indexFileName)) == 0);
+	}
+	if (! ok)
+	{
+		error (WARNING | PERROR, "cannot write the tag index: %s", vStringValue (indexFileName));
+		remove (vStringValue (tmpName));
+	}
+
+ out:
+	if (lines)
+		eFree (lines);
+	if (tags)
+		mio_unref (tags);
+	eStatFree (status);
+	vStringDelete (tmpName);
+	vStringDelete (indexFileName);
+}
+
+/* An index left by an earlier run may be stale. libreadtags detects
+ * staleness with the size and the last modified time of the tag file,
+ * which may be unchanged on a file system with coarse timestamps. An
+ * index in an older format is removed too. */
+extern void removeTagIndex (const char *const tagFileName)
+{
+	vString *indexFileName = makeIndexFileName (tagFileName);
+	FILE *fp = fopen (vStringValue (indexFileName), "rb");
+
+	if (fp)
+	{
+		char magic [TAG_INDEX_MAGIC_LENGTH];
+		/* "ctagsIX" followed by the version */
+		bool ours = (fread (magic, sizeof (magic), 1, fp) == 1
+					 && memcmp (magic, TAG_INDEX_MAGIC, TAG_INDEX_MAGIC_LENGTH - 1) == 0);
+
+		fclose (fp);
+		if (ours)
+		{
+			verbose ("removing the stale tag index: %s\n", vStringValue (indexFileName));
+			remove (vStringValue (indexFileName));
+		}
+	}
+	vStringDelete (indexFileName);
+}
@@ -0,0 +1,128 @@
+/*
+*   Copyright (c) 2026, Universal Ctags Team
+*
+*   This source code is released for free distribution under the terms of the
+*   GNU General Public License version 2 or (at your option) any later version.
+*
+*   This module writes a trace of a ctags run in the Trace Event Format
+*   of Chrome (--_trace-events=FILE). The trace can be opened with
+*   Perfetto (https://ui.perfetto.dev) or chrome://tracing.
+*
+*   The events are written in the JSON array format as they happen.
+*   The closing bracket is written at exit, but the viewers accept a
+*   trace without it; a trace of a run killed halfway can be opened.
+*/
+
+/*
+*   INCLUDE FILES
+*/
+#include "general.h"  /* must always come first */
+
+#include <stdio.h>
+
+#include "error_p.h"
+#include "routines.h"
+#include "stats_p.h"
+#include "traceevent_p.h"
+
+/*
+*   DATA DEFINITIONS
+*/
+bool TraceEventsEnabled;
+
+static FILE *TraceEventsFile;
+static double TraceEventsStart;
+static bool TraceEventsWritten;
+
+/*
+*   FUNCTION DEFINITIONS
+*/
+extern void openTraceEvents (const char *const fileName)
+{
+	TraceEventsFile = fopen (fileName, "w");
+	if (TraceEventsFile == NULL)
+		error (FATAL | PERROR, "cannot open \"%s\" for the trace events", fileName);
+
+	fputs ("[", TraceEventsFile);
+	TraceEventsStart = getMonotonicTime ();
+	TraceEventsWritten = false;
+	TraceEventsEnabled = true;
+}
+
+extern void closeTraceEvents (void)
+{
+	if (TraceEventsFile == NULL)
+		return;
+
+	fputs ("\n]\n", TraceEventsFile);
+	if (fclose (TraceEventsFile) != 0)
+		error (WARNING | PERROR, "cannot close the trace events");
+	TraceEventsFile = NULL;
+	TraceEventsEnabled = false;
+}
+
+/*  Write the fields common to all events, leaving the object open. */
+static void writeEventHead (const char *const name, char phase)
+{
+	const double ts = (getMonotonicTime () - TraceEventsStart) * 1e6;
+
+	fputs (TraceEventsWritten? ",\n": "\n", TraceEventsFile);
+	TraceEventsWritten = true;
+
+	fputs ("{\"name\":", TraceEventsFile);
+	printJsonString (name, TraceEventsFile);
+	fprintf (TraceEventsFile, ",\"cat\":\"ctags\",\"ph\":\"%c\",\"ts\":%.3f,\"pid\":1,\"tid\":1",
+			 phase, ts);
+}
+
+static void writeEventArgs (const char *const argName, const char *const argValue)
+{
+	if (argName == NULL || argValue == NULL)
+		return;
+
+	fputs (",\"args\":{", TraceEventsFile);
+	printJsonString (argName, TraceEventsFile);
+	fputc (':', TraceEventsFile);
+	printJsonString (argValue, TraceEventsFile);
+	fputc ('}', TraceEventsFile);
+}
+
+extern void traceEventBegin (const char *const name,
+							 const char *const argName, const char *const argValue)
+{
+	writeEventHead (name, 'B');
+	writeEventArgs (argName, argValue);
+	fputc ('}', TraceEventsFile);
+}
+
+extern void traceEventBeginWithNumber (const char *const name,
+									   const char *const argName, long argValue)
+{
+	writeEventHead (name, 'B');
+	fputs (",\"args\":{", TraceEventsFile);
+	printJsonString (argName, TraceEventsFile);
+	fprintf (TraceEventsFile, ":%ld}}", argValue);
+}
+
+extern void traceEventEnd (const char *const name)
+{
+	writeEventHead (name, 'E');
+	fputc ('}', TraceEventsFile);
+}
+
+extern void traceEventInstant (const char *const name,
+							   const char *const argName, const char *const argValue)
+{
+	writeEventHead (name, 'i');
+	fputs (",\"s\":\"t\"", TraceEventsFile);
+	writeEventArgs (argName, argValue);
+	fputc ('}', TraceEventsFile);
+}
+
+extern void traceEventCounter (const char *const name, unsigned long value)
+{
+	writeEventHead (name, 'C');
+	fputs (",\"args\":{", TraceEventsFile);
+	printJsonString (name, TraceEventsFile);
+	fprintf (TraceEventsFile, ":%lu}}", value);
+}
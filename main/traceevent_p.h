@@ -0,0 +1,41 @@
+/*
+*   Copyright (c) 2026, Universal Ctags Team
+*
+*   This source code is released for free distribution under the terms of the
+*   GNU General Public License version 2 or (at your option) any later version.
+*
+*   main part private interface to traceevent.c
+*/
+#ifndef CTAGS_MAIN_TRACEEVENT_PRIVATE_H
+#define CTAGS_MAIN_TRACEEVENT_PRIVATE_H
+
+/*
+*   INCLUDE FILES
+*/
+#include "general.h"  /* must always come first */
+
+/*
+*   GLOBAL VARIABLES
+*/
+
+/* true while --_trace-events=FILE is writing. Check this before calling
+ * the functions below, so that a disabled trace costs only the test. */
+extern bool TraceEventsEnabled;
+
+/*
+*   FUNCTION PROTOTYPES
+*/
+extern void openTraceEvents (const char *const fileName);
+extern void closeTraceEvents (void);
+
+/* ARGNAME and ARGVALUE may be NULL. */
+extern void traceEventBegin (const char *const name,
+							 const char *const argName, const char *const argValue);
+extern void traceEventBeginWithNumber (const char *const name,
+									   const char *const argName, long argValue);
+extern void traceEventEnd (const char *const name);
+extern void traceEventInstant (const char *const name,
+							   const char *const argName, const char *const argValue);
+extern void traceEventCounter (const char *const name, unsigned long value);
+
+#endif	/* CTAGS_MAIN_TRACEEVENT_PRIVATE_H */
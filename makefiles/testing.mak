@@ -1,12 +1,12 @@
 # -*- makefile -*-
-.PHONY: check units fuzz noise tmain tinst tlib clean-units clean-tlib clean-tmain clean-gcov run-gcov codecheck cppcheck dicts validate-input
+.PHONY: check units fuzz noise tmain tinst tlib clean-units clean-tlib clean-tmain clean-gcov run-gcov codecheck cppcheck dicts validate-input bench clean-bench
 
-EXTRA_DIST += misc/units misc/units.py
+EXTRA_DIST += misc/units misc/units.py misc/bench
 EXTRA_DIST += misc/tlib misc/mini-geany.expected
 
 check: tmain units tlib
 
-clean-local: clean-units clean-tmain
+clean-local: clean-units clean-tmain clean-bench
 
 CTAGS_TEST = ./ctags$(EXEEXT)
 READ_TEST = ./readtags$(EXEEXT)
@@ -246,6 +246,53 @@ else
 roundtrip:
 endif
 
+#
+# BENCH Target
+#
+# The corpora are made from Units once, and reused until clean-bench.
+# Set BENCH_BASELINE to a file saved with BENCH_SAVE for finding
+# regressions.
+#
+BENCH_SIZE = 2000000
+BENCH_SEED = 1
+BENCH_REPEAT = 3
+BENCH_THRESHOLD = 10
+BENCH_BASELINE =
+BENCH_SAVE =
+
+bench: $(CTAGS_TEST)
+	$(V_RUN) \
+	if test -z "$(PYTHON)"; then \
+		echo "python3 is needed to run bench target" 1>&2; \
+		exit 1; \
+	fi; \
+	builddir=$$(pwd); \
+	if ! test -d $${builddir}/Bench/corpus; then \
+		$(PYTHON) $(srcdir)/misc/bench corpus \
+			--ctags=$(CTAGS_TEST) \
+			--languages=$(LANGUAGES) \
+			--size=$(BENCH_SIZE) \
+			--seed=$(BENCH_SEED) \
+			$(srcdir)/Units $${builddir}/Bench/corpus || exit 1; \
+	fi; \
+	if test -n "$(BENCH_BASELINE)"; then \
+		BASELINE="--baseline=$(BENCH_BASELINE)"; \
+	fi; \
+	if test -n "$(BENCH_SAVE)"; then \
+		SAVE="--save=$(BENCH_SAVE)"; \
+	fi; \
+	$(PYTHON) $(srcdir)/misc/bench run \
+		--ctags=$(CTAGS_TEST) \
+		--languages=$(LANGUAGES) \
+		--repeat=$(BENCH_REPEAT) \
+		--threshold=$(BENCH_THRESHOLD) \
+		$${BASELINE} $${SAVE} \
+		$${builddir}/Bench/corpus
+
+clean-bench:
+	$(SILENT) echo Cleaning bench corpora
+	$(SILENT) rm -rf Bench
+
 #
 # Checking code in ctags own rules
 #
@@ -2142,8 +2142,8 @@ static void freeMacroInfo(cppMacroInfo * info)
 
 static hashTable *makeMacroTable (void)
 {
-	return hashTableNew(
-		1024,
+	return hashTableGrowableNew(
+		64,
 		hashCstrhash,
 		hashCstreq,
 		eFree,
@@ -295,8 +295,7 @@ static bool findExtendsClass (const char *line,
 	if (moose->notContinuousExtendsLines == true
 		&& vStringLength (str) > 0)
 	{
-		if (e->extensionFields.inheritance)
-			eFree ((void *)e->extensionFields.inheritance);
+		freeCorkEntryField (e->extensionFields.inheritance);
 		e->extensionFields.inheritance = vStringStrdup (str);
 	}
 
@@ -324,8 +323,7 @@ static bool findExtendsClassContinuation (const char *line,
 	if (moose->notContinuousExtendsLines == true
 		&& vStringLength (str) > 0)
 	{
-		if (e->extensionFields.inheritance)
-			eFree ((void *)e->extensionFields.inheritance);
+		freeCorkEntryField (e->extensionFields.inheritance);
 		e->extensionFields.inheritance = vStringStrdup (str);
 	}
 
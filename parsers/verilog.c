@@ -1933,7 +1933,10 @@ static int findTag (tokenInfo *const token, int c)
 static void findVerilogTags (void)
 {
 	tokenInfo *const token = newToken ();
-	int c = skipWhite (vGetc ());
+	int c;
+
+	Ungetc = '\0';
+	c = skipWhite (vGetc ());
 	currentContext = newToken ();
 	fieldTable = isInputLanguage (Lang_verilog) ? VerilogFields : SystemVerilogFields;
 	ptrArrayClear (tagContents);
@@ -49,15 +49,24 @@ MAIN_PUBLIC_HEADS =		\
 	$(NULL)
 
 LIB_PRIVATE_HEADS =		\
+	main/arena_p.h		\
 	main/args_p.h		\
+	main/cache_p.h		\
+	main/bench_p.h		\
 	main/colprint_p.h	\
+	main/dedup_p.h		\
 	main/dependency_p.h	\
+	main/dirscan_p.h	\
 	main/entry_p.h		\
 	main/error_p.h		\
 	main/field_p.h		\
 	main/flags_p.h		\
 	main/fmt_p.h		\
+	main/globset_p.h	\
+	main/htable_p.h		\
 	main/interactive_p.h	\
+	main/intern_p.h		\
+	main/jobs_p.h		\
 	main/keyword_p.h	\
 	main/kind_p.h		\
 	main/lregex_p.h		\
@@ -73,9 +82,12 @@ LIB_PRIVATE_HEADS =		\
 	main/ptag_p.h		\
 	main/read_p.h		\
 	main/routines_p.h	\
+	main/server_p.h		\
 	main/sort_p.h		\
 	main/stats_p.h		\
 	main/subparser_p.h	\
+	main/tagindex_p.h	\
+	main/traceevent_p.h	\
 	main/trashbox_p.h	\
 	main/writer_p.h		\
 	main/xtag_p.h		\
@@ -92,16 +104,24 @@ LIB_HEADS =			\
 	$(MIO_HEADS)
 
 LIB_SRCS =			\
+	main/arena.c		\
 	main/args.c			\
+	main/bench.c			\
+	main/cache.c			\
 	main/colprint.c			\
+	main/dedup.c			\
 	main/dependency.c		\
+	main/dirscan.c			\
 	main/entry.c			\
 	main/entry_private.c		\
 	main/error.c			\
 	main/field.c			\
 	main/flags.c			\
 	main/fmt.c			\
+	main/globset.c			\
 	main/htable.c			\
+	main/intern.c			\
+	main/jobs.c			\
 	main/keyword.c			\
 	main/kind.c			\
 	main/lregex.c			\
@@ -123,10 +143,13 @@ LIB_SRCS =			\
 	main/routines.c			\
 	main/seccomp.c			\
 	main/selectors.c		\
+	main/server.c			\
 	main/sort.c			\
 	main/stats.c			\
 	main/strlist.c			\
+	main/tagindex.c		\
 	main/trace.c			\
+	main/traceevent.c	\
 	main/trashbox.c			\
 	main/tokeninfo.c		\
 	main/unwindi.c			\